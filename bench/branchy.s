@@ -0,0 +1,161 @@
+# Benchmark de desvios: lê N e soma os passos de Collatz de 1 a N. O desvio par/ímpar
+# depende dos dados e não tem padrão. Imprime o total de passos.
+.section .text
+.globl _start
+
+.equ UART_BASE, 0x10000000
+
+_start:
+    li sp, 0x80100000
+
+    jal ra, read_int
+    mv s1, a0
+
+    mv s2, zero
+    li s3, 1
+    li s4, 1
+
+outer_loop:
+    bgt s3, s1, end_outer
+    mv t0, s3
+
+step_loop:
+    beq t0, s4, end_step
+    andi t2, t0, 1
+    beqz t2, even
+    slli t3, t0, 1
+    add t0, t0, t3
+    addi t0, t0, 1
+    addi s2, s2, 1
+    j step_loop
+even:
+    srli t0, t0, 1
+    addi s2, s2, 1
+    j step_loop
+end_step:
+
+    addi s3, s3, 1
+    j outer_loop
+end_outer:
+
+    mv a0, s2
+    jal ra, print_int
+
+end_program:
+    li t0, UART_BASE
+    li t1, 10
+    sb t1, 0(t0)
+    ebreak
+
+put_char:
+    li t0, UART_BASE
+    sb a0, 0(t0)
+    ret
+
+get_char:
+    li t0, UART_BASE
+    lb a0, 0(t0)
+    ret
+
+read_int:
+    addi sp, sp, -4
+    sw ra, 0(sp)
+    
+    mv t3, zero
+    li t4, 0
+
+skip_whitespace:
+    jal ra, get_char
+    li t1, 32
+    beq a0, t1, skip_whitespace
+    li t1, 10
+    beq a0, t1, skip_whitespace
+    li t1, 13
+    beq a0, t1, skip_whitespace
+    
+    li t1, 45
+    bne a0, t1, check_digit
+    li t4, 1
+    j parse_loop_next_char
+
+check_digit:
+    j process_digit
+
+parse_loop:
+    jal ra, get_char
+process_digit:
+    li t1, 48
+    li t2, 57
+    blt a0, t1, end_parse
+    bgt a0, t2, end_parse
+
+    addi a0, a0, -48
+    li t5, 10
+    mul t3, t3, t5
+    add t3, t3, a0
+    
+parse_loop_next_char:
+    j parse_loop
+
+end_parse:
+    beqz t4, return_val
+    sub t3, zero, t3
+
+return_val:
+    mv a0, t3
+    lw ra, 0(sp)
+    addi sp, sp, 4
+    ret
+
+print_int:
+    addi sp, sp, -8
+    sw ra, 0(sp)
+    sw s0, 4(sp)
+
+    mv t0, a0
+    
+    bnez t0, check_neg_print
+    li a0, 48
+    jal ra, put_char
+    j end_print_int
+
+check_neg_print:
+    bge t0, zero, positive_print
+    
+    li a0, 45
+    addi sp, sp, -4 
+    sw t0, 0(sp)
+    jal ra, put_char
+    lw t0, 0(sp)
+    addi sp, sp, 4
+    
+    sub t0, zero, t0
+
+positive_print:
+    li s0, 0
+    li t1, 10
+
+convert_loop:
+    beqz t0, print_stack_loop
+    rem t2, t0, t1
+    div t0, t0, t1
+    
+    addi t2, t2, 48
+    addi sp, sp, -4
+    sw t2, 0(sp)
+    addi s0, s0, 1
+    j convert_loop
+
+print_stack_loop:
+    beqz s0, end_print_int
+    lw a0, 0(sp)
+    addi sp, sp, 4
+    jal ra, put_char
+    addi s0, s0, -1
+    j print_stack_loop
+
+end_print_int:
+    lw s0, 4(sp)
+    lw ra, 0(sp)
+    addi sp, sp, 8
+    ret
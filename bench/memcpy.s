@@ -0,0 +1,192 @@
+# Benchmark de cópia de memória: lê N e copia um buffer de 64 KiB N vezes, quatro palavras
+# por iteração; a cada passada a origem muda. Imprime a soma das palavras do destino.
+.section .text
+.globl _start
+
+.equ UART_BASE, 0x10000000
+.equ BUF_BYTES, 65536
+
+_start:
+    li sp, 0x80100000
+
+    jal ra, read_int
+    mv s1, a0
+
+    la s2, src
+    la s3, dst
+    li s5, BUF_BYTES
+
+    mv t0, zero
+    mv t2, s2
+fill_loop:
+    bge t0, s5, end_fill
+    slli t3, t0, 3
+    xor t3, t3, t0
+    sw t3, 0(t2)
+    addi t2, t2, 4
+    addi t0, t0, 4
+    j fill_loop
+end_fill:
+
+    mv s4, zero
+copy_pass:
+    bge s4, s1, end_copy
+    mv t0, s2
+    mv t1, s3
+    add t2, s2, s5
+copy_loop:
+    lw t3, 0(t0)
+    lw t4, 4(t0)
+    lw t5, 8(t0)
+    lw t6, 12(t0)
+    sw t3, 0(t1)
+    sw t4, 4(t1)
+    sw t5, 8(t1)
+    sw t6, 12(t1)
+    addi t0, t0, 16
+    addi t1, t1, 16
+    bltu t0, t2, copy_loop
+
+    lw t3, 0(s2)
+    addi t3, t3, 1
+    sw t3, 0(s2)
+    addi s4, s4, 1
+    j copy_pass
+end_copy:
+
+    mv a0, zero
+    mv t0, s3
+    add t2, s3, s5
+sum_loop:
+    lw t3, 0(t0)
+    add a0, a0, t3
+    addi t0, t0, 4
+    bltu t0, t2, sum_loop
+
+    jal ra, print_int
+
+end_program:
+    li t0, UART_BASE
+    li t1, 10
+    sb t1, 0(t0)
+    ebreak
+
+put_char:
+    li t0, UART_BASE
+    sb a0, 0(t0)
+    ret
+
+get_char:
+    li t0, UART_BASE
+    lb a0, 0(t0)
+    ret
+
+read_int:
+    addi sp, sp, -4
+    sw ra, 0(sp)
+    
+    mv t3, zero
+    li t4, 0
+
+skip_whitespace:
+    jal ra, get_char
+    li t1, 32
+    beq a0, t1, skip_whitespace
+    li t1, 10
+    beq a0, t1, skip_whitespace
+    li t1, 13
+    beq a0, t1, skip_whitespace
+    
+    li t1, 45
+    bne a0, t1, check_digit
+    li t4, 1
+    j parse_loop_next_char
+
+check_digit:
+    j process_digit
+
+parse_loop:
+    jal ra, get_char
+process_digit:
+    li t1, 48
+    li t2, 57
+    blt a0, t1, end_parse
+    bgt a0, t2, end_parse
+
+    addi a0, a0, -48
+    li t5, 10
+    mul t3, t3, t5
+    add t3, t3, a0
+    
+parse_loop_next_char:
+    j parse_loop
+
+end_parse:
+    beqz t4, return_val
+    sub t3, zero, t3
+
+return_val:
+    mv a0, t3
+    lw ra, 0(sp)
+    addi sp, sp, 4
+    ret
+
+print_int:
+    addi sp, sp, -8
+    sw ra, 0(sp)
+    sw s0, 4(sp)
+
+    mv t0, a0
+    
+    bnez t0, check_neg_print
+    li a0, 48
+    jal ra, put_char
+    j end_print_int
+
+check_neg_print:
+    bge t0, zero, positive_print
+    
+    li a0, 45
+    addi sp, sp, -4 
+    sw t0, 0(sp)
+    jal ra, put_char
+    lw t0, 0(sp)
+    addi sp, sp, 4
+    
+    sub t0, zero, t0
+
+positive_print:
+    li s0, 0
+    li t1, 10
+
+convert_loop:
+    beqz t0, print_stack_loop
+    rem t2, t0, t1
+    div t0, t0, t1
+    
+    addi t2, t2, 48
+    addi sp, sp, -4
+    sw t2, 0(sp)
+    addi s0, s0, 1
+    j convert_loop
+
+print_stack_loop:
+    beqz s0, end_print_int
+    lw a0, 0(sp)
+    addi sp, sp, 4
+    jal ra, put_char
+    addi s0, s0, -1
+    j print_stack_loop
+
+end_print_int:
+    lw s0, 4(sp)
+    lw ra, 0(sp)
+    addi sp, sp, 8
+    ret
+
+.section .bss
+.align 4
+src:
+    .space 65536
+dst:
+    .space 65536
@@ -0,0 +1,278 @@
+// poxim-bench: mede o desempenho do POXIMV1 e do poximv2 nos programas de bench/ e grava o
+// resultado em JSON para comparar commits. Executar a partir da raiz do repositório:
+//
+//   gcc -O2 -pthread -o poxim-bench bench/sidneijunior_202400018369_bench.c sidneijunior_202400018369_libpoxim.c
+//   ./poxim-bench --v1 ./poximv1 --v2 ./poximv2 --out bench.json [--compare anterior.json]
+//
+// O número de instruções de cada carga vem de uma execução pela libpoxim (que também dá a saída
+// de referência do terminal); os simuladores são executados como processos, com o trace em
+// /dev/null, e o tempo é o menor entre --repeat execuções.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../sidneijunior_202400018369_libpoxim.h"
+
+// --- Cargas ---
+// Cada carga gera a sua entrada (LCG de semente fixa, então a entrada é a mesma em todo commit).
+typedef struct {
+    const char *name, *program;
+    void (*generate)(FILE *f, uint64_t param);
+    uint64_t param;
+    int v1;   // o POXIMV1 não tem interrupção da UART
+} workload_t;
+
+static uint32_t lcg_state;
+static uint32_t lcg(void) { lcg_state = lcg_state * 1103515245u + 12345u; return (lcg_state >> 16) | (lcg_state << 16); }
+
+static void gen_sort(FILE *f, uint64_t n) { lcg_state = 2024; fprintf(f, "%llu\n", (unsigned long long)n); for (uint64_t i = 0; i < n; i++) fprintf(f, "%d\n", (int32_t)lcg()); }
+static void gen_count(FILE *f, uint64_t n) { fprintf(f, "%llu\n", (unsigned long long)n); }
+static void gen_text(FILE *f, uint64_t bytes) {
+    static const char *words[] = { "poxim", "risc-v", "uart", "trap", "mret", "plic", "hart", "echo", "interrupt", "wfi" };
+    lcg_state = 7;
+    fprintf(f, "%llu\n", (unsigned long long)bytes);
+    for (uint64_t n = 0; n < bytes; ) {
+        const char *w = words[lcg() % 10]; char c = (lcg() % 8) ? ' ' : '\n';
+        for (; *w && n < bytes; w++, n++) fputc(*w, f);
+        if (n < bytes) { fputc(c, f); n++; }
+    }
+}
+
+// sort.s guarda o vetor logo depois do código e a pilha começa em 0x80100000: até ~250 mil números.
+#define SORT_MAX 250000
+// uart_echo.s lê N e ecoa N bytes por um anel, sem limite de tamanho.
+#define ECHO_BYTES 196608
+#define MAX_WORKLOADS 32
+
+static workload_t workloads[MAX_WORKLOADS];
+static int n_workloads;
+static char names[MAX_WORKLOADS][32];
+
+static void add_workload(const char *name, const char *program, void (*generate)(FILE *, uint64_t), uint64_t param, int v1) {
+    if (n_workloads < MAX_WORKLOADS) workloads[n_workloads++] = (workload_t){ name, program, generate, param, v1 };
+}
+
+static int add_sort_sizes(const char *list) {
+    for (const char *p = list; *p; ) {
+        char *end; unsigned long long n = strtoull(p, &end, 0);
+        if (*end == 'K' || *end == 'k') { n *= 1000; end++; }
+        if (end == p || n == 0 || n > SORT_MAX) { fprintf(stderr, "Tamanho inválido em --sizes: %s (1 a %d)\n", p, SORT_MAX); return 0; }
+        if (n_workloads < MAX_WORKLOADS) {
+            snprintf(names[n_workloads], sizeof names[0], "sort-%llu", n);
+            add_workload(names[n_workloads], "sort.hex", gen_sort, n, 1);
+        }
+        p = (*end == ',') ? end + 1 : end;
+        if (*end && *end != ',') { fprintf(stderr, "Lista inválida em --sizes: %s\n", list); return 0; }
+    }
+    return 1;
+}
+
+// --- Configurações medidas ---
+enum { SIM_V1, SIM_V2 };
+typedef struct { const char *sim, *mode; int which, trace; const char *flags[3]; } config_t;
+
+static const config_t configs[] = {
+    { "poximv1", "trace",    SIM_V1, 1, { NULL } },
+    { "poximv2", "trace",    SIM_V2, 1, { NULL } },
+    { "poximv2", "interp",   SIM_V2, 0, { "--no-trace", "--no-superblocks", NULL } },
+    { "poximv2", "no-trace", SIM_V2, 0, { "--no-trace", NULL } },
+    { "poximv2", "jit",      SIM_V2, 0, { "--no-trace", "--jit", NULL } },
+};
+#define N_CONFIGS (int)(sizeof(configs) / sizeof(configs[0]))
+
+static double now_seconds(void) { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return t.tv_sec + t.tv_nsec * 1e-9; }
+
+// Instruções retiradas e saída do terminal pela libpoxim.
+static int reference_run(const char *program, const char *in_path, uint64_t *instret, char **terminal, size_t *terminal_len) {
+    poxim_config cfg = { .harts = 1, .jit = 1 };
+    poxim_machine *m = poxim_create(&cfg);
+    FILE *in = fopen(in_path, "r"), *term = open_memstream(terminal, terminal_len);
+    int ok = m && in && term && poxim_load(m, program, POXIM_RAM_BASE, 0);
+    if (ok) {
+        poxim_set_file(m, POXIM_INPUT, in); poxim_set_file(m, POXIM_TERMINAL, term);
+        ok = poxim_run(m, UINT64_MAX) == POXIM_EBREAK;
+        *instret = poxim_instret(m, -1);
+    }
+    if (m) poxim_destroy(m);
+    if (in) fclose(in);
+    if (term) fclose(term);
+    return ok;
+}
+
+static int same_file(const char *path, const char *data, size_t len) {
+    FILE *f = fopen(path, "rb"); if (f == NULL) return 0;
+    int same = 1; size_t i = 0;
+    for (int c; (c = fgetc(f)) != EOF; i++) if (i >= len || (char)c != data[i]) { same = 0; break; }
+    fclose(f);
+    return same && i == len;
+}
+
+// Executa o simulador em 'workdir' (onde ele cria terminal.out), com stdout em /dev/null.
+// Devolve o tempo de parede ou -1 se ele falhou ou passou do tempo limite.
+static double timed_run(char *const argv[], const char *workdir, const char *in_path, int timeout) {
+    double start = now_seconds();
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY), in = open(in_path, O_RDONLY);
+        if (null < 0 || in < 0 || chdir(workdir) != 0) _exit(127);
+        dup2(in, 0); dup2(null, 1); dup2(null, 2);
+        alarm(timeout);   // sobrevive ao exec: o simulador travado morre com SIGALRM
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0) return -1;
+    double elapsed = now_seconds() - start;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? elapsed : -1;
+}
+
+// --- Comparação com um JSON anterior ---
+// Cada resultado fica numa linha; só os campos de identificação e ns_per_insn são lidos.
+typedef struct { char workload[32], sim[16], mode[16]; double ns_per_insn; } result_t;
+
+static int parse_result(const char *line, result_t *r) {
+    const char *p = strstr(line, "\"workload\"");
+    if (p == NULL || sscanf(p, "\"workload\": \"%31[^\"]\", \"sim\": \"%15[^\"]\", \"mode\": \"%15[^\"]\"", r->workload, r->sim, r->mode) != 3) return 0;
+    if ((p = strstr(line, "\"ns_per_insn\": ")) == NULL) return 0;
+    r->ns_per_insn = strtod(p + 15, NULL);
+    return strstr(line, "\"ok\": true") != NULL;
+}
+
+static int compare(const char *base_path, const result_t *now, int n_now, double threshold) {
+    FILE *f = fopen(base_path, "r"); if (f == NULL) { perror(base_path); return -1; }
+    printf("\nComparação com %s (regressão: mais de %.0f%% mais lento)\n", base_path, threshold);
+    printf("%-14s %-8s %-9s %12s %12s %8s\n", "carga", "sim", "modo", "antes ns/i", "agora ns/i", "var.");
+    int regressions = 0; char line[512]; result_t base;
+    while (fgets(line, sizeof line, f)) {
+        if (!parse_result(line, &base)) continue;
+        for (int i = 0; i < n_now; i++) {
+            const result_t *r = &now[i];
+            if (strcmp(r->workload, base.workload) || strcmp(r->sim, base.sim) || strcmp(r->mode, base.mode)) continue;
+            double change = base.ns_per_insn > 0 ? 100.0 * (r->ns_per_insn / base.ns_per_insn - 1) : 0;
+            int slower = change > threshold; regressions += slower;
+            printf("%-14s %-8s %-9s %12.3f %12.3f %+7.1f%%%s\n", r->workload, r->sim, r->mode, base.ns_per_insn, r->ns_per_insn, change, slower ? "  REGRESSÃO" : "");
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [--v1 BIN] [--v2 BIN] [--out ARQ.json] [--compare ANTERIOR.json] [--threshold PCT]\n", prog);
+    fprintf(stderr, "     [--repeat N] [--sizes N,N,...] [--scale K] [--trace-max N] [--timeout S]\n");
+    fprintf(stderr, "     --sizes: entradas do sort (padrão 1K,2K,4K; até %d)\n", SORT_MAX);
+    fprintf(stderr, "     --scale: multiplica o trabalho de memcpy, muldiv, branchy e uart_echo\n");
+    fprintf(stderr, "     --trace-max: cargas com mais instruções que isso não rodam com trace (padrão 10000000)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *v1 = "./poximv1", *v2 = "./poximv2", *out_path = "bench.json", *base_path = NULL, *sizes = "1K,2K,4K";
+    int repeat = 3, timeout = 600; uint64_t scale = 1, trace_max = 10000000; double threshold = 10;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--v1") == 0 && i + 1 < argc) v1 = argv[++i];
+        else if (strcmp(argv[i], "--v2") == 0 && i + 1 < argc) v2 = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) base_path = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) sizes = argv[++i];
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) scale = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--trace-max") == 0 && i + 1 < argc) trace_max = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) timeout = atoi(argv[++i]);
+        else { usage(argv[0]); return 1; }
+    }
+    if (repeat < 1 || scale < 1 || timeout < 1) { usage(argv[0]); return 1; }
+    if (!add_sort_sizes(sizes)) return 1;
+    add_workload("memcpy",    "bench/memcpy.hex",    gen_count, 100 * scale,   1);
+    add_workload("muldiv",    "bench/muldiv.hex",    gen_count, 300000 * scale, 1);
+    add_workload("branchy",   "bench/branchy.hex",   gen_count, 10000 * scale, 1);
+    add_workload("uart_echo", "bench/uart_echo.hex", gen_text,  ECHO_BYTES * scale, 0);
+
+    char bins[2][PATH_MAX];
+    if (realpath(v1, bins[SIM_V1]) == NULL) bins[SIM_V1][0] = '\0';
+    if (realpath(v2, bins[SIM_V2]) == NULL) bins[SIM_V2][0] = '\0';
+    if (!bins[SIM_V1][0]) fprintf(stderr, "%s não encontrado: POXIMV1 não será medido\n", v1);
+    if (!bins[SIM_V2][0]) fprintf(stderr, "%s não encontrado: poximv2 não será medido\n", v2);
+
+    char workdir[] = "/tmp/poxim-bench-XXXXXX";
+    if (mkdtemp(workdir) == NULL) { perror("mkdtemp"); return 1; }
+    char in_path[PATH_MAX], term_path[PATH_MAX], program[PATH_MAX];
+    snprintf(in_path, sizeof in_path, "%s/entrada.in", workdir);
+    snprintf(term_path, sizeof term_path, "%s/terminal.out", workdir);
+
+    FILE *out = fopen(out_path, "w"); if (out == NULL) { perror(out_path); return 1; }
+    char commit[64] = "";
+    FILE *git = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+    if (git) { if (fgets(commit, sizeof commit, git)) commit[strcspn(commit, "\n")] = '\0'; pclose(git); }
+    time_t t = time(NULL); char date[32]; strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S", localtime(&t));
+    fprintf(out, "{\"commit\": \"%s\", \"date\": \"%s\", \"repeat\": %d, \"results\": [\n", commit, date, repeat);
+
+    result_t *results = calloc((size_t)n_workloads * N_CONFIGS, sizeof(result_t)); int n_results = 0, failures = 0;
+    if (results == NULL) return 1;
+    printf("%-14s %-8s %-9s %14s %10s %10s %8s\n", "carga", "sim", "modo", "instruções", "segundos", "ns/instr", "MIPS");
+    for (int w = 0; w < n_workloads; w++) {
+        const workload_t *wl = &workloads[w];
+        FILE *in = fopen(in_path, "w"); if (in == NULL) { perror(in_path); return 1; }
+        wl->generate(in, wl->param); fclose(in);
+        if (realpath(wl->program, program) == NULL) { perror(wl->program); failures++; continue; }
+
+        uint64_t instret = 0; char *terminal = NULL; size_t terminal_len = 0;
+        if (!reference_run(program, in_path, &instret, &terminal, &terminal_len)) { fprintf(stderr, "%s: a execução de referência falhou\n", wl->name); free(terminal); failures++; continue; }
+
+        for (int c = 0; c < N_CONFIGS; c++) {
+            const config_t *cfg = &configs[c];
+            if (!bins[cfg->which][0] || (cfg->which == SIM_V1 && !wl->v1)) continue;
+            if (cfg->trace && instret > trace_max) { printf("%-14s %-8s %-9s %14s\n", wl->name, cfg->sim, cfg->mode, "(pulado: --trace-max)"); continue; }
+            // V1: <programa> <trace>, entrada em stdin; V2: [flags] <programa> [trace] <entrada>.
+            char *args[8]; int n = 0;
+            args[n++] = bins[cfg->which];
+            for (int f = 0; cfg->flags[f]; f++) args[n++] = (char *)cfg->flags[f];
+            args[n++] = program;
+            if (cfg->trace) args[n++] = "/dev/null";
+            if (cfg->which == SIM_V2) args[n++] = in_path;
+            args[n] = NULL;
+
+            double best = -1; int ok = 1;
+            for (int r = 0; r < repeat && ok; r++) {
+                unlink(term_path);
+                double s = timed_run(args, workdir, in_path, timeout);
+                ok = s >= 0 && same_file(term_path, terminal, terminal_len);
+                if (ok && (best < 0 || s < best)) best = s;
+            }
+            double ns = ok ? best * 1e9 / instret : 0, mips = ok ? instret / best / 1e6 : 0;
+            if (!ok) failures++;
+            if (ok) printf("%-14s %-8s %-9s %14llu %10.3f %10.3f %8.1f\n", wl->name, cfg->sim, cfg->mode, (unsigned long long)instret, best, ns, mips);
+            else printf("%-14s %-8s %-9s %14llu  falhou (saída diferente, erro ou tempo limite)\n", wl->name, cfg->sim, cfg->mode, (unsigned long long)instret);
+
+            result_t *res = &results[n_results++];
+            snprintf(res->workload, sizeof res->workload, "%s", wl->name); snprintf(res->sim, sizeof res->sim, "%s", cfg->sim); snprintf(res->mode, sizeof res->mode, "%s", cfg->mode); res->ns_per_insn = ns;
+            fprintf(out, "%s    {\"workload\": \"%s\", \"sim\": \"%s\", \"mode\": \"%s\", \"instructions\": %llu, \"seconds\": %.6f, \"ns_per_insn\": %.4f, \"mips\": %.2f, \"ok\": %s}",
+                    n_results > 1 ? ",\n" : "", wl->name, cfg->sim, cfg->mode, (unsigned long long)instret, ok ? best : 0.0, ns, mips, ok ? "true" : "false");
+        }
+        free(terminal);
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    unlink(in_path); unlink(term_path); rmdir(workdir);
+    printf("Resultados gravados em %s\n", out_path);
+
+    int regressions = 0;
+    if (base_path) {
+        // Só entram na comparação os resultados que terminaram com a saída certa.
+        int n_ok = 0;
+        for (int i = 0; i < n_results; i++) if (results[i].ns_per_insn > 0) results[n_ok++] = results[i];
+        if ((regressions = compare(base_path, results, n_ok, threshold)) < 0) regressions = 1;
+    }
+    free(results);
+    return (failures || regressions) ? 1 : 0;
+}
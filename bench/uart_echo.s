@@ -0,0 +1,169 @@
+# Benchmark de interrupções (a partir de terminal.s): lê N (primeira linha, por polling) e
+# devolve os N bytes seguintes pela UART. Recepção e transmissão são feitas no tratador da
+# interrupção externa (IER bit 0: dados recebidos, bit 1: THR vazio) com claim/complete no
+# PLIC, através de um anel de 2 KiB; o laço principal espera em wfi.
+.section .text
+.globl _start
+
+.equ UART_BASE, 0x10000000
+.equ PLIC_PRIORITY, 0x0c000028
+.equ PLIC_ENABLE, 0x0c002000
+.equ PLIC_THRESHOLD, 0x0c200000
+.equ PLIC_CLAIM, 0x0c200004
+.equ RING_MASK, 2047
+
+_start:
+    li sp, 0x80100000
+    la t0, trap_handler
+    csrw mtvec, t0
+
+    jal ra, read_int
+    mv s1, a0
+    la s2, ring
+    mv s3, zero
+    mv s4, zero
+    blez s1, end_program
+
+    li t0, PLIC_PRIORITY
+    li t1, 1
+    sw t1, 0(t0)
+    li t0, PLIC_ENABLE
+    li t1, 0x400
+    sw t1, 0(t0)
+    li t0, PLIC_THRESHOLD
+    sw zero, 0(t0)
+
+    li t0, UART_BASE
+    li t1, 0xC7
+    sb t1, 2(t0)
+    li t1, 1
+    sb t1, 1(t0)
+    li t1, 0x800
+    csrw mie, t1
+    csrsi mstatus, 8
+
+wait_loop:
+    bgeu s4, s1, end_wait
+    wfi
+    j wait_loop
+end_wait:
+    csrci mstatus, 8
+
+end_program:
+    li t0, UART_BASE
+    li t1, 10
+    sb t1, 0(t0)
+    ebreak
+
+# s1: N, s2: anel, s3: bytes recebidos, s4: bytes enviados.
+.align 4
+trap_handler:
+    li t5, PLIC_CLAIM
+    lw t6, 0(t5)
+    li t0, UART_BASE
+
+rx_loop:
+    bgeu s3, s1, tx
+    sub t1, s3, s4
+    li t2, RING_MASK
+    bgtu t1, t2, tx
+    lbu t1, 5(t0)
+    andi t1, t1, 1
+    beqz t1, tx
+    lbu t1, 0(t0)
+    andi t2, s3, RING_MASK
+    add t2, t2, s2
+    sb t1, 0(t2)
+    addi s3, s3, 1
+    j rx_loop
+
+tx:
+    lbu t1, 5(t0)
+    andi t1, t1, 0x20
+    beqz t1, set_ier
+    li t3, 16
+tx_loop:
+    beqz t3, set_ier
+    bgeu s4, s3, set_ier
+    andi t2, s4, RING_MASK
+    add t2, t2, s2
+    lbu t1, 0(t2)
+    sb t1, 0(t0)
+    addi s4, s4, 1
+    addi t3, t3, -1
+    j tx_loop
+
+set_ier:
+    mv t3, zero
+    bgeu s3, s1, check_tx
+    sub t1, s3, s4
+    li t2, RING_MASK
+    bgtu t1, t2, check_tx
+    ori t3, t3, 1
+check_tx:
+    bgeu s4, s3, write_ier
+    ori t3, t3, 2
+write_ier:
+    sb t3, 1(t0)
+    sw t6, 0(t5)
+    mret
+
+get_char:
+    li t0, UART_BASE
+    lb a0, 0(t0)
+    ret
+
+read_int:
+    addi sp, sp, -4
+    sw ra, 0(sp)
+    
+    mv t3, zero
+    li t4, 0
+
+skip_whitespace:
+    jal ra, get_char
+    li t1, 32
+    beq a0, t1, skip_whitespace
+    li t1, 10
+    beq a0, t1, skip_whitespace
+    li t1, 13
+    beq a0, t1, skip_whitespace
+    
+    li t1, 45
+    bne a0, t1, check_digit
+    li t4, 1
+    j parse_loop_next_char
+
+check_digit:
+    j process_digit
+
+parse_loop:
+    jal ra, get_char
+process_digit:
+    li t1, 48
+    li t2, 57
+    blt a0, t1, end_parse
+    bgt a0, t2, end_parse
+
+    addi a0, a0, -48
+    li t5, 10
+    mul t3, t3, t5
+    add t3, t3, a0
+    
+parse_loop_next_char:
+    j parse_loop
+
+end_parse:
+    beqz t4, return_val
+    sub t3, zero, t3
+
+return_val:
+    mv a0, t3
+    lw ra, 0(sp)
+    addi sp, sp, 4
+    ret
+
+.section .bss
+.align 4
+ring:
+    .space 2048
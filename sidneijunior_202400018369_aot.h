@@ -0,0 +1,43 @@
+#ifndef POXIM_AOT_H
+#define POXIM_AOT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sidneijunior_202400018369_libpoxim.h"
+
+// Funções usadas pelo C que o poxim-aot gera. Cada bloco recebe o estado do hart em 'c' e lê e
+// escreve os registradores em x[] (x[0] nunca é escrito). Um acesso só é feito no próprio bloco
+// quando é alinhado e cai na RAM (e, num store, numa palavra sem marca de código nem de reserva
+// do lr.w); senão o bloco sai antes da instrução com AOT_EXIT e o interpretador a executa.
+
+#define AOT_EXIT(n, at) do { *retired = (n); return (at); } while (0)
+
+static inline uint8_t *aot_load(const poxim_aot_ctx *c, uint32_t addr, uint32_t size) {
+    uint32_t idx = addr - POXIM_RAM_BASE;
+    if ((addr & (size - 1)) || idx > c->ram_size - size) return NULL;
+    return c->ram + idx;
+}
+
+static inline uint8_t *aot_store(const poxim_aot_ctx *c, uint32_t addr, uint32_t size) {
+    uint32_t idx = addr - POXIM_RAM_BASE;
+    if ((addr & (size - 1)) || idx > c->ram_size - size || c->code[idx >> 2]) return NULL;
+    if (c->dirty) c->dirty[idx >> 12] = 1;
+    return c->ram + idx;
+}
+
+static inline uint32_t aot_lw(const uint8_t *h) { uint32_t v; memcpy(&v, h, 4); return v; }
+static inline uint32_t aot_lh(const uint8_t *h) { int16_t v; memcpy(&v, h, 2); return (uint32_t)(int32_t)v; }
+static inline uint32_t aot_lhu(const uint8_t *h) { uint16_t v; memcpy(&v, h, 2); return v; }
+static inline void aot_sw(uint8_t *h, uint32_t v) { memcpy(h, &v, 4); }
+static inline void aot_sh(uint8_t *h, uint32_t v) { uint16_t x = (uint16_t)v; memcpy(h, &x, 2); }
+
+static inline uint32_t aot_mulh(uint32_t a, uint32_t b) { return (uint32_t)(((int64_t)(int32_t)a * (int64_t)(int32_t)b) >> 32); }
+static inline uint32_t aot_mulhsu(uint32_t a, uint32_t b) { return (uint32_t)(((int64_t)(int32_t)a * (int64_t)(uint64_t)b) >> 32); }
+static inline uint32_t aot_mulhu(uint32_t a, uint32_t b) { return (uint32_t)(((uint64_t)a * b) >> 32); }
+static inline uint32_t aot_div(uint32_t a, uint32_t b) { return b == 0 ? 0xFFFFFFFF : (a == 0x80000000 && b == 0xFFFFFFFF) ? a : (uint32_t)((int32_t)a / (int32_t)b); }
+static inline uint32_t aot_divu(uint32_t a, uint32_t b) { return b == 0 ? 0xFFFFFFFF : a / b; }
+static inline uint32_t aot_rem(uint32_t a, uint32_t b) { return b == 0 ? a : (a == 0x80000000 && b == 0xFFFFFFFF) ? 0 : (uint32_t)((int32_t)a % (int32_t)b); }
+static inline uint32_t aot_remu(uint32_t a, uint32_t b) { return b == 0 ? a : a % b; }
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef POXIM_CORE_H
+#define POXIM_CORE_H
+
+// Núcleo de execução compartilhado pelo V1 e pelo V2: a entrada em trap e execute_insn_body, que
+// executa uma instrução já decodificada (sidneijunior_202400018369_isa.h) e escreve a linha do
+// trace. O perfil (sidneijunior_202400018369_platform.h) decide em tempo de compilação as
+// extensões e o tratamento de traps; o que a plataforma não tem não aparece no código gerado.
+//
+// Quem inclui define antes: registers, pc, csrs e trap_occurred; CSR_* e CAUSE_*;
+// raise_exception, csr_read e csr_write; read_*_from_memory e write_*_to_memory (o barramento da
+// plataforma) e machine_stop. Conforme o perfil, também amo_word, amo_apply, lr_reserve e
+// sc_conditional (POXIM_EXT_A), icache_flush (POXIM_EXT_ZIFENCEI), wfi_idle (POXIM_WFI),
+// irq_dirty (POXIM_LAZY_IRQ), trace_value/trace_addr (POXIM_BIN_TRACE) e semihost_call
+// (POXIM_SEMIHOSTING: devolve 1 se atendeu o ecall, que então não vira trap).
+#include "sidneijunior_202400018369_selfprof.h"
+
+// Desvia para o tratador em mtvec; raise_exception de cada plataforma decide antes o que registrar.
+static inline void trap_enter(uint32_t cause, uint32_t tval) {
+    csrs[CSR_MEPC] = pc;
+    csrs[CSR_MCAUSE] = cause;
+    csrs[CSR_MTVAL] = tval;
+
+#if POXIM_TRAP_STACK
+    uint32_t mstatus = csrs[CSR_MSTATUS];
+    uint32_t mie_bit = (mstatus & 0x8) ? 1 : 0;
+    mstatus = (mstatus & ~0x80) | (mie_bit << 7);
+    mstatus &= ~0x8;
+    csrs[CSR_MSTATUS] = mstatus;
+#endif
+
+    uint32_t mtvec = csrs[CSR_MTVEC];
+    uint32_t base = mtvec & ~0x3;
+#if POXIM_VECTORED_TRAPS
+    uint32_t mode = mtvec & 0x3;
+    if ((mode == 1) && (cause & 0x80000000)) {
+        uint32_t exception_code = cause & 0x7FFFFFFF;
+        pc = base + (exception_code * 4);
+    } else {
+        pc = base;
+    }
+#else
+    pc = base;
+#endif
+    trap_occurred = 1;
+}
+
+// Registro do trace. 'mode' é constante em cada cópia especializada de execute_insn_body,
+// então a cópia sem trace não contém nenhum sprintf/fprintf. No autoperfil a formatação conta à parte.
+enum { TRACE_NONE = 0, TRACE_TEXT = 1, TRACE_BINARY = 2 };
+#define TRACE(...) do { if (mode == TRACE_TEXT) SELFPROF_TIME_SAMPLED(SELFPROF_TRACE_TEXT, fprintf(out_file, __VA_ARGS__)); } while (0)
+#define TRACE_OPERANDS(...) do { if (mode == TRACE_TEXT) SELFPROF_TIME_SAMPLED(SELFPROF_TRACE_TEXT, sprintf(operand_str, __VA_ARGS__)); } while (0)
+// Valores da última instrução para o trace binário (ver bt_fields).
+#if POXIM_BIN_TRACE
+#define TRACE_VALUE(v) do { if (mode == TRACE_BINARY) trace_value = (v); } while (0)
+#define TRACE_MEM(a, v) do { if (mode == TRACE_BINARY) { trace_addr = (a); trace_value = (v); } } while (0)
+#else
+#define TRACE_VALUE(v) do { (void)(v); } while (0)
+#define TRACE_MEM(a, v) do { (void)(a); (void)(v); } while (0)
+#endif
+// Mnemônico no trace: o da instrução compacta (c.*) quando ela foi expandida.
+#define MNEMONIC(name) (c_name ? c_name : (name))
+
+static inline __attribute__((always_inline)) void execute_insn_body(const decoded_insn_t *d, uint32_t current_pc, FILE *out_file, const int mode) {
+    uint32_t instruction = d->raw;
+    uint32_t rd = d->rd, rs1 = d->rs1, rs2 = d->rs2;
+    int32_t imm = d->imm;
+    int pc_updated = 0;
+    trap_occurred = 0;
+    char operand_str[40];
+    uint32_t next_pc = current_pc + insn_length(instruction);
+    const char *c_name = (POXIM_EXT_C && mode == TRACE_TEXT && insn_length(instruction) == 2) ? rvc_name(d) : NULL;
+
+    switch (d->op) {
+        // I-Type
+        case OP_ADDI: { uint32_t val_rs1 = registers[rs1]; uint32_t res = val_rs1 + imm; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, MNEMONIC("addi"), operand_str, x_label[rd], val_rs1, imm, res); break; }
+        case OP_SLLI: { uint32_t val_rs1 = registers[rs1]; uint32_t shamt = imm; uint32_t res = val_rs1 << shamt; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,%u", x_label[rd], x_label[rs1], shamt); TRACE("0x%08x:%-7s %-16s %s=0x%08x<<%u=0x%08x\n", current_pc, MNEMONIC("slli"), operand_str, x_label[rd], val_rs1, shamt, res); break; }
+        case OP_SLTI: { uint32_t val_rs1 = registers[rs1]; uint32_t res = ((int32_t)val_rs1 < imm) ? 1 : 0; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC("slti"), operand_str, x_label[rd], val_rs1, imm, res); break; }
+        case OP_SLTIU: { uint32_t val_rs1 = registers[rs1]; uint32_t res = (val_rs1 < (uint32_t)imm) ? 1 : 0; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC("sltiu"), operand_str, x_label[rd], val_rs1, imm, res); break; }
+        case OP_XORI: { uint32_t val_rs1 = registers[rs1]; uint32_t res = val_rs1 ^ imm; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s %s=0x%08x^0x%08x=0x%08x\n", current_pc, MNEMONIC("xori"), operand_str, x_label[rd], val_rs1, imm, res); break; }
+        case OP_SRLI: { uint32_t val_rs1 = registers[rs1]; uint32_t shamt = imm; uint32_t res = val_rs1 >> shamt; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,%u", x_label[rd], x_label[rs1], shamt); TRACE("0x%08x:%-7s %-16s %s=0x%08x>>%u=0x%08x\n", current_pc, MNEMONIC("srli"), operand_str, x_label[rd], val_rs1, shamt, res); break; }
+        case OP_SRAI: { uint32_t val_rs1 = registers[rs1]; uint32_t shamt = imm; uint32_t res = (int32_t)val_rs1 >> shamt; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,%u", x_label[rd], x_label[rs1], shamt); TRACE("0x%08x:%-7s %-16s %s=0x%08x>>>%u=0x%08x\n", current_pc, MNEMONIC("srai"), operand_str, x_label[rd], val_rs1, shamt, res); break; }
+        case OP_ORI: { uint32_t val_rs1 = registers[rs1]; uint32_t res = val_rs1 | imm; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s %s=0x%08x|0x%08x=0x%08x\n", current_pc, MNEMONIC("ori"), operand_str, x_label[rd], val_rs1, imm, res); break; }
+        case OP_ANDI: { uint32_t val_rs1 = registers[rs1]; uint32_t res = val_rs1 & imm; if (rd != 0) registers[rd] = res; TRACE_VALUE(res); TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s %s=0x%08x&0x%08x=0x%08x\n", current_pc, MNEMONIC("andi"), operand_str, x_label[rd], val_rs1, imm, res); break; }
+        case OP_NOP: break;
+
+        // R-Type
+        case OP_ADD: case OP_SLL: case OP_SLT: case OP_SLTU: case OP_XOR: case OP_SRL: case OP_OR: case OP_AND: case OP_SUB: case OP_SRA:
+#if POXIM_EXT_M
+        case OP_MUL: case OP_MULH: case OP_MULHSU: case OP_MULHU: case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+#endif
+        {
+            int32_t v_rs1 = registers[rs1]; int32_t v_rs2 = registers[rs2]; uint32_t v_urs1 = registers[rs1]; uint32_t v_urs2 = registers[rs2]; uint32_t shamt = v_urs2 & 0x1F; uint32_t res = 0;
+#if POXIM_EXT_M
+            int64_t s64_rs1 = (int64_t)v_rs1; int64_t s64_rs2 = (int64_t)v_rs2; uint64_t u64_rs1 = (uint64_t)v_urs1; uint64_t u64_rs2 = (uint64_t)v_urs2;
+#endif
+            TRACE_OPERANDS("%s,%s,%s", x_label[rd], x_label[rs1], x_label[rs2]);
+            switch (d->op) {
+                case OP_ADD: res = v_rs1 + v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, MNEMONIC("add"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_SLL: res = v_urs1 << shamt; TRACE("0x%08x:%-7s %-16s %s=0x%08x<<%u=0x%08x\n", current_pc, MNEMONIC("sll"), operand_str, x_label[rd], v_urs1, shamt, res); break;
+                case OP_SLT: res = (v_rs1 < v_rs2) ? 1 : 0; TRACE("0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC("slt"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_SLTU: res = (v_urs1 < v_urs2) ? 1 : 0; TRACE("0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC("sltu"), operand_str, x_label[rd], v_urs1, v_urs2, res); break;
+                case OP_XOR: res = v_rs1 ^ v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x^0x%08x=0x%08x\n", current_pc, MNEMONIC("xor"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_SRL: res = v_urs1 >> shamt; TRACE("0x%08x:%-7s %-16s %s=0x%08x>>%u=0x%08x\n", current_pc, MNEMONIC("srl"), operand_str, x_label[rd], v_urs1, shamt, res); break;
+                case OP_OR: res = v_rs1 | v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x|0x%08x=0x%08x\n", current_pc, MNEMONIC("or"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_AND: res = v_rs1 & v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x&0x%08x=0x%08x\n", current_pc, MNEMONIC("and"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_SUB: res = v_rs1 - v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x-0x%08x=0x%08x\n", current_pc, MNEMONIC("sub"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_SRA: res = v_rs1 >> shamt; TRACE("0x%08x:%-7s %-16s %s=0x%08x>>>%u=0x%08x\n", current_pc, MNEMONIC("sra"), operand_str, x_label[rd], v_rs1, shamt, res); break;
+#if POXIM_EXT_M
+                case OP_MUL: res = v_rs1 * v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, MNEMONIC("mul"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_MULH: res = (uint32_t)((s64_rs1 * s64_rs2) >> 32); TRACE("0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, MNEMONIC("mulh"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_MULHSU: res = (uint32_t)((s64_rs1 * u64_rs2) >> 32); TRACE("0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, MNEMONIC("mulhsu"), operand_str, x_label[rd], v_rs1, v_urs2, res); break;
+                case OP_MULHU: res = (uint32_t)((u64_rs1 * u64_rs2) >> 32); TRACE("0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, MNEMONIC("mulhu"), operand_str, x_label[rd], v_urs1, v_urs2, res); break;
+                case OP_DIV: if(v_rs2==0)res=-1;else if(v_rs1==0x80000000&&v_rs2==-1)res=0x80000000;else res=v_rs1/v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x/0x%08x=0x%08x\n", current_pc, MNEMONIC("div"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_DIVU: if(v_urs2==0)res=-1;else res=v_urs1/v_urs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x/0x%08x=0x%08x\n", current_pc, MNEMONIC("divu"), operand_str, x_label[rd], v_urs1, v_urs2, res); break;
+                case OP_REM: if(v_rs2==0)res=v_rs1;else if(v_rs1==0x80000000&&v_rs2==-1)res=0;else res=v_rs1%v_rs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x%%0x%08x=0x%08x\n", current_pc, MNEMONIC("rem"), operand_str, x_label[rd], v_rs1, v_rs2, res); break;
+                case OP_REMU: if(v_urs2==0)res=v_urs1;else res=v_urs1%v_urs2; TRACE("0x%08x:%-7s %-16s %s=0x%08x%%0x%08x=0x%08x\n", current_pc, MNEMONIC("remu"), operand_str, x_label[rd], v_urs1, v_urs2, res); break;
+#endif
+            }
+            if (rd != 0) registers[rd] = res;
+            TRACE_VALUE(res);
+            break;
+        }
+        case OP_JAL: {
+            int32_t offset = imm; uint32_t return_address = next_pc; uint32_t target_address = current_pc + offset;
+            if (rd != 0) {
+                registers[rd] = return_address;
+            }
+            pc = target_address;
+            pc_updated = 1;
+            TRACE_OPERANDS("%s,0x%05x", x_label[rd], (offset >> 1) & 0xFFFFF); TRACE("0x%08x:%-7s %-16s pc=0x%08x,%s=0x%08x\n", current_pc, MNEMONIC("jal"), operand_str, target_address, x_label[rd], return_address);
+            break;
+        }
+        case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU: {
+            int32_t offset = imm;
+            int32_t val_rs1 = registers[rs1]; int32_t val_rs2 = registers[rs2]; uint32_t u_val_rs1 = registers[rs1]; uint32_t u_val_rs2 = registers[rs2];
+            int condition_met = 0; const char* instr_name = "???"; const char* op_symbol = "??"; int is_unsigned = 0;
+            switch (d->op) {
+                case OP_BEQ: instr_name = "beq"; op_symbol = "=="; if (val_rs1 == val_rs2) condition_met = 1; break;
+                case OP_BNE: instr_name = "bne"; op_symbol = "!="; if (val_rs1 != val_rs2) condition_met = 1; break;
+                case OP_BLT: instr_name = "blt"; op_symbol = "<";  if (val_rs1 < val_rs2) condition_met = 1; break;
+                case OP_BGE: instr_name = "bge"; op_symbol = ">="; if (val_rs1 >= val_rs2) condition_met = 1; break;
+                case OP_BLTU: instr_name = "bltu"; op_symbol = "<";  if (u_val_rs1 < u_val_rs2) condition_met = 1; is_unsigned = 1; break;
+                default: instr_name = "bgeu"; op_symbol = ">="; if (u_val_rs1 >= u_val_rs2) condition_met = 1; is_unsigned = 1; break;
+            }
+            if (is_unsigned) { TRACE("0x%08x:%-7s %s,%s,0x%03x   (0x%08x%s0x%08x)=%d->pc=0x%08x\n", current_pc, MNEMONIC(instr_name), x_label[rs1], x_label[rs2], (offset >> 1) & 0xFFF, u_val_rs1, op_symbol, u_val_rs2, condition_met, (condition_met ? (current_pc + offset) : (next_pc))); }
+            else { TRACE("0x%08x:%-7s %s,%s,0x%03x   (0x%08x%s0x%08x)=%d->pc=0x%08x\n", current_pc, MNEMONIC(instr_name), x_label[rs1], x_label[rs2], (offset >> 1) & 0xFFF, val_rs1, op_symbol, val_rs2, condition_met, (condition_met ? (current_pc + offset) : (next_pc))); }
+            if (condition_met) { pc = current_pc + offset; pc_updated = 1; }
+            break;
+        }
+        case OP_LUI: {
+            uint32_t imm_u = imm;
+            if (rd != 0) registers[rd] = imm_u;
+            TRACE_OPERANDS("%s,0x%05x", x_label[rd], (imm_u >> 12)); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("lui"), operand_str, x_label[rd], imm_u);
+            break;
+        }
+        case OP_AUIPC: {
+            int32_t imm_u = imm; uint32_t res = current_pc + imm_u;
+            if (rd != 0) registers[rd] = res;
+            TRACE_OPERANDS("%s,0x%05x", x_label[rd], (imm_u >> 12) & 0xFFFFF); TRACE("0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, MNEMONIC("auipc"), operand_str, x_label[rd], current_pc, imm_u, res);
+            break;
+        }
+        case OP_JALR: {
+            uint32_t val_rs1 = registers[rs1]; uint32_t return_address = next_pc; uint32_t target_address = (val_rs1 + imm) & ~1;
+            if (rd != 0) {
+                registers[rd] = return_address;
+            }
+            pc = target_address;
+            pc_updated = 1;
+            TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); TRACE("0x%08x:%-7s %-16s pc=0x%08x+0x%08x,%s=0x%08x\n", current_pc, MNEMONIC("jalr"), operand_str, val_rs1, imm, x_label[rd], return_address);
+            break;
+        }
+        case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU: {
+            uint32_t val_rs1 = registers[rs1]; uint32_t address = val_rs1 + imm; uint32_t res = 0; const char* instr_name = "???";
+            TRACE_OPERANDS("%s,0x%03x(%s)", x_label[rd], (imm & 0xFFF), x_label[rs1]);
+            switch (d->op) {
+                case OP_LB: instr_name = "lb";  { int8_t  b = (int8_t) read_byte_from_memory(address); if(!trap_occurred) res = (int32_t)b; } break;
+                case OP_LH: instr_name = "lh";  { int16_t h = (int16_t)read_half_word_from_memory(address); if(!trap_occurred) res = (int32_t)h; } break;
+                case OP_LW: instr_name = "lw";  { res = read_word_from_memory(address); } break;
+                case OP_LBU: instr_name = "lbu"; { uint8_t b = read_byte_from_memory(address); if(!trap_occurred) res = (uint32_t)b; } break;
+                default: instr_name = "lhu"; { uint16_t h = read_half_word_from_memory(address); if(!trap_occurred) res = (uint32_t)h; } break;
+            }
+            if (!trap_occurred) { if(rd != 0) registers[rd] = res; TRACE_MEM(address, res); TRACE("0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC(instr_name), operand_str, x_label[rd], address, res); }
+            break;
+        }
+        case OP_SB: case OP_SH: case OP_SW: {
+            uint32_t val_rs1 = registers[rs1]; uint32_t val_rs2 = registers[rs2]; uint32_t address = val_rs1 + imm; const char* instr_name = "???";
+            TRACE_OPERANDS("%s,0x%03x(%s)", x_label[rs2], (imm & 0xFFF), x_label[rs1]);
+            switch (d->op) {
+                case OP_SB: instr_name = "sb"; write_byte_to_memory(address, (uint8_t)val_rs2); if(!trap_occurred) { TRACE_MEM(address, (uint8_t)val_rs2); TRACE("0x%08x:%-7s %-16s mem[0x%08x]=0x%02x\n", current_pc, MNEMONIC(instr_name), operand_str, address, (uint8_t)val_rs2); } break;
+                case OP_SH: instr_name = "sh"; write_half_word_to_memory(address, (uint16_t)val_rs2); if(!trap_occurred) { TRACE_MEM(address, (uint16_t)val_rs2); TRACE("0x%08x:%-7s %-16s mem[0x%08x]=0x%04x\n", current_pc, MNEMONIC(instr_name), operand_str, address, (uint16_t)val_rs2); } break;
+                default: instr_name = "sw"; write_word_to_memory(address, val_rs2); if(!trap_occurred) { TRACE_MEM(address, val_rs2); TRACE("0x%08x:%-7s %-16s mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC(instr_name), operand_str, address, val_rs2); } break;
+            }
+            break;
+        }
+        case OP_ECALL:
+#if POXIM_SEMIHOSTING
+            if (semihost_call()) { TRACE("0x%08x:ecall\n", current_pc); break; }
+#endif
+            raise_exception(CAUSE_ECALL_MMODE, 0); TRACE("0x%08x:ecall\n", current_pc); break;
+        case OP_EBREAK:
+            TRACE("0x%08x:%s\n", current_pc, MNEMONIC("ebreak"));
+            machine_stop();
+            break;
+        case OP_MRET: {
+            pc = csrs[CSR_MEPC];
+            pc_updated = 1;
+#if POXIM_TRAP_STACK
+            uint32_t mstatus = csrs[CSR_MSTATUS];
+            uint32_t mpie_bit = (mstatus >> 7) & 1;
+            mstatus = (mstatus & ~0x8) | (mpie_bit << 3);
+            mstatus |= 0x80;
+            csrs[CSR_MSTATUS] = mstatus;
+#endif
+#if POXIM_LAZY_IRQ
+            irq_dirty = 1;
+#endif
+            TRACE("0x%08x:mret\n", current_pc);
+            break;
+        }
+#if POXIM_WFI
+        case OP_WFI: wfi_idle(); TRACE("0x%08x:wfi\n", current_pc); break;
+#endif
+        case OP_CSRRW: case OP_CSRRS: case OP_CSRRC: case OP_CSRRWI: case OP_CSRRSI: case OP_CSRRCI: {
+            uint32_t csr_addr = imm; uint32_t uimm = rs1;
+            uint32_t csr_val = csr_read(csr_addr); uint32_t new_val = csr_val;
+            switch (d->op) {
+                case OP_CSRRW: new_val = registers[rs1]; TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], csr_addr); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("csrrw"), operand_str, x_label[rd], csr_val); break;
+                case OP_CSRRS: new_val = csr_val | registers[rs1]; TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], csr_addr); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("csrrs"), operand_str, x_label[rd], csr_val); break;
+                case OP_CSRRC: new_val = csr_val & ~registers[rs1]; TRACE_OPERANDS("%s,%s,0x%03x", x_label[rd], x_label[rs1], csr_addr); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("csrrc"), operand_str, x_label[rd], csr_val); break;
+                case OP_CSRRWI: new_val = uimm; TRACE_OPERANDS("%s,0x%x,0x%03x", x_label[rd], uimm, csr_addr); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("csrrwi"), operand_str, x_label[rd], csr_val); break;
+                case OP_CSRRSI: new_val = csr_val | uimm; TRACE_OPERANDS("%s,0x%x,0x%03x", x_label[rd], uimm, csr_addr); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("csrrsi"), operand_str, x_label[rd], csr_val); break;
+                default: new_val = csr_val & ~uimm; TRACE_OPERANDS("%s,0x%x,0x%03x", x_label[rd], uimm, csr_addr); TRACE("0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("csrrci"), operand_str, x_label[rd], csr_val); break;
+            }
+            // csrrs/csrrc com rs1 = x0 (e as versões imediatas com 0) só leem: não contam como escrita.
+            if (d->op == OP_CSRRW || d->op == OP_CSRRWI || rs1 != 0) csr_write(csr_addr, new_val);
+            if (rd != 0) registers[rd] = csr_val;
+#if POXIM_LAZY_IRQ
+            irq_dirty = 1;
+#endif
+            TRACE_VALUE(csr_val);
+            break;
+        }
+#if POXIM_EXT_ZIFENCEI
+        case OP_FENCE: __atomic_thread_fence(__ATOMIC_SEQ_CST); TRACE("0x%08x:fence\n", current_pc); break;
+        case OP_FENCE_I: icache_flush(); TRACE("0x%08x:fence.i\n", current_pc); break;
+#endif
+#if POXIM_EXT_A
+        case OP_LR_W: {
+            uint32_t address = registers[rs1]; uint32_t *word = amo_word(address, CAUSE_LOAD_ACCESS);
+            if (word) {
+                uint32_t res = lr_reserve(address, word);
+                if (rd != 0) registers[rd] = res;
+                TRACE_MEM(address, res); TRACE_OPERANDS("%s,(%s)", x_label[rd], x_label[rs1]); TRACE("0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC("lr.w"), operand_str, x_label[rd], address, res);
+            }
+            break;
+        }
+        case OP_SC_W: {
+            uint32_t address = registers[rs1]; uint32_t val_rs2 = registers[rs2]; uint32_t *word = amo_word(address, CAUSE_STORE_ACCESS);
+            if (word) {
+                uint32_t res = sc_conditional(address, word, val_rs2);
+                if (rd != 0) registers[rd] = res;
+                TRACE_MEM(address, res); TRACE_OPERANDS("%s,%s,(%s)", x_label[rd], x_label[rs2], x_label[rs1]);
+                if (res == 0) TRACE("0x%08x:%-7s %-16s %s=0,mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC("sc.w"), operand_str, x_label[rd], address, val_rs2);
+                else TRACE("0x%08x:%-7s %-16s %s=1\n", current_pc, MNEMONIC("sc.w"), operand_str, x_label[rd]);
+            }
+            break;
+        }
+        case OP_AMOSWAP_W: case OP_AMOADD_W: case OP_AMOXOR_W: case OP_AMOAND_W: case OP_AMOOR_W: case OP_AMOMIN_W: case OP_AMOMAX_W: case OP_AMOMINU_W: case OP_AMOMAXU_W: {
+            uint32_t address = registers[rs1]; uint32_t val_rs2 = registers[rs2]; uint8_t op = d->op; uint32_t *word = amo_word(address, CAUSE_STORE_ACCESS);
+            if (word) {
+                uint32_t old = amo_apply(op, word, val_rs2);
+                if (rd != 0) registers[rd] = old;
+                TRACE_MEM(address, old); TRACE_OPERANDS("%s,%s,(%s)", x_label[rd], x_label[rs2], x_label[rs1]);
+                TRACE("0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x,mem[0x%08x]=0x%08x\n", current_pc, op_name[op], operand_str, x_label[rd], address, old, address, amo_compute(op, old, val_rs2));
+            }
+            break;
+        }
+#endif
+        case OP_UNKNOWN: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); TRACE("Erro: Opcode 0x%x desconhecido em 0x%08x (Trap)\n", instruction & 0x7F, current_pc); break;
+        default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); break;
+    }
+    if (!pc_updated && !trap_occurred) { pc = next_pc; }
+}
+
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef POXIM_ISA_H
+#define POXIM_ISA_H
+
+#include <stdint.h>
+
+#include "sidneijunior_202400018369_platform.h"
+
+// Decodificação RV32IMAC compartilhada entre o simulador e as ferramentas (poxim-trace). As
+// extensões que o perfil de plataforma desliga decodificam como no V1: opcode desconhecido
+// (fence, atômicas) ou instrução ilegal (mul/div, wfi).
+
+static const char* x_label[32] = { "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6" };
+
+// Índice do handler de cada instrução decodificada.
+enum {
+    OP_INVALID = 0, // entrada ainda não decodificada
+    OP_ADDI, OP_SLLI, OP_SLTI, OP_SLTIU, OP_XORI, OP_SRLI, OP_SRAI, OP_ORI, OP_ANDI, OP_NOP,
+    OP_ADD, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_OR, OP_AND, OP_SUB, OP_SRA,
+    OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU, OP_DIV, OP_DIVU, OP_REM, OP_REMU,
+    OP_JAL, OP_BEQ, OP_BNE, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU,
+    OP_LUI, OP_AUIPC, OP_JALR,
+    OP_LB, OP_LH, OP_LW, OP_LBU, OP_LHU, OP_SB, OP_SH, OP_SW,
+    OP_ECALL, OP_EBREAK, OP_MRET, OP_WFI,
+    OP_CSRRW, OP_CSRRS, OP_CSRRC, OP_CSRRWI, OP_CSRRSI, OP_CSRRCI,
+    OP_FENCE, OP_FENCE_I,
+    OP_LR_W, OP_SC_W, OP_AMOSWAP_W, OP_AMOADD_W, OP_AMOXOR_W, OP_AMOAND_W, OP_AMOOR_W, OP_AMOMIN_W, OP_AMOMAX_W, OP_AMOMINU_W, OP_AMOMAXU_W,
+    OP_ILLEGAL,     // opcode conhecido com campos inválidos (trap sem log)
+    OP_UNKNOWN      // opcode desconhecido (trap com mensagem de erro)
+};
+
+typedef struct {
+    uint8_t op;             // índice do handler em execute_instruction
+    uint8_t rd, rs1, rs2;
+    int32_t imm;            // imediato final (offset, shamt ou endereço do CSR)
+    uint32_t raw;           // palavra original (mtval e detecção de instrução nula); 16 bits nas compactas
+} decoded_insn_t;
+
+// Tamanho em bytes: as instruções compactas (RV32C) têm os bits 1-0 diferentes de 11.
+static inline uint32_t insn_length(uint32_t raw) { return (raw & 3) == 3 ? 4 : 2; }
+
+// Mnemônico de cada op, como aparece no trace.
+static const char *op_name[OP_UNKNOWN + 1] __attribute__((unused)) = {
+    [OP_INVALID] = "?", [OP_ADDI] = "addi", [OP_SLLI] = "slli", [OP_SLTI] = "slti", [OP_SLTIU] = "sltiu", [OP_XORI] = "xori", [OP_SRLI] = "srli", [OP_SRAI] = "srai", [OP_ORI] = "ori", [OP_ANDI] = "andi", [OP_NOP] = "nop",
+    [OP_ADD] = "add", [OP_SLL] = "sll", [OP_SLT] = "slt", [OP_SLTU] = "sltu", [OP_XOR] = "xor", [OP_SRL] = "srl", [OP_OR] = "or", [OP_AND] = "and", [OP_SUB] = "sub", [OP_SRA] = "sra",
+    [OP_MUL] = "mul", [OP_MULH] = "mulh", [OP_MULHSU] = "mulhsu", [OP_MULHU] = "mulhu", [OP_DIV] = "div", [OP_DIVU] = "divu", [OP_REM] = "rem", [OP_REMU] = "remu",
+    [OP_JAL] = "jal", [OP_BEQ] = "beq", [OP_BNE] = "bne", [OP_BLT] = "blt", [OP_BGE] = "bge", [OP_BLTU] = "bltu", [OP_BGEU] = "bgeu",
+    [OP_LUI] = "lui", [OP_AUIPC] = "auipc", [OP_JALR] = "jalr",
+    [OP_LB] = "lb", [OP_LH] = "lh", [OP_LW] = "lw", [OP_LBU] = "lbu", [OP_LHU] = "lhu", [OP_SB] = "sb", [OP_SH] = "sh", [OP_SW] = "sw",
+    [OP_ECALL] = "ecall", [OP_EBREAK] = "ebreak", [OP_MRET] = "mret", [OP_WFI] = "wfi",
+    [OP_CSRRW] = "csrrw", [OP_CSRRS] = "csrrs", [OP_CSRRC] = "csrrc", [OP_CSRRWI] = "csrrwi", [OP_CSRRSI] = "csrrsi", [OP_CSRRCI] = "csrrci",
+    [OP_FENCE] = "fence", [OP_FENCE_I] = "fence.i",
+    [OP_LR_W] = "lr.w", [OP_SC_W] = "sc.w", [OP_AMOSWAP_W] = "amoswap.w", [OP_AMOADD_W] = "amoadd.w", [OP_AMOXOR_W] = "amoxor.w", [OP_AMOAND_W] = "amoand.w", [OP_AMOOR_W] = "amoor.w",
+    [OP_AMOMIN_W] = "amomin.w", [OP_AMOMAX_W] = "amomax.w", [OP_AMOMINU_W] = "amominu.w", [OP_AMOMAXU_W] = "amomaxu.w",
+    [OP_ILLEGAL] = "ilegal", [OP_UNKNOWN] = "desconhecida"
+};
+
+// Classe de cada op para o mix de instruções do perfil.
+enum { CLASS_ALU, CLASS_MULDIV, CLASS_LOAD, CLASS_STORE, CLASS_BRANCH, CLASS_JUMP, CLASS_CSR, CLASS_SYSTEM, CLASS_ATOMIC, CLASS_INVALID, CLASS_COUNT };
+
+static inline int op_class(uint8_t op) {
+    if (op >= OP_ADDI && op <= OP_SRA) return CLASS_ALU;
+    if (op >= OP_MUL && op <= OP_REMU) return CLASS_MULDIV;
+    if (op == OP_JAL || op == OP_JALR) return CLASS_JUMP;
+    if (op >= OP_BEQ && op <= OP_BGEU) return CLASS_BRANCH;
+    if (op == OP_LUI || op == OP_AUIPC) return CLASS_ALU;
+    if (op >= OP_LB && op <= OP_LHU) return CLASS_LOAD;
+    if (op >= OP_SB && op <= OP_SW) return CLASS_STORE;
+    if (op >= OP_CSRRW && op <= OP_CSRRCI) return CLASS_CSR;
+    if ((op >= OP_ECALL && op <= OP_WFI) || op == OP_FENCE || op == OP_FENCE_I) return CLASS_SYSTEM;
+    if (op >= OP_LR_W && op <= OP_AMOMAXU_W) return CLASS_ATOMIC;
+    return CLASS_INVALID;
+}
+
+// Instrução que encerra um bloco básico (desvio, salto, trap ou retorno de trap).
+static inline int op_ends_block(uint8_t op) { int c = op_class(op); return c == CLASS_BRANCH || c == CLASS_JUMP || c == CLASS_SYSTEM || c == CLASS_INVALID; }
+
+// RV32A: valor que cada AMO grava na memória.
+
+static inline uint32_t amo_compute(uint8_t op, uint32_t old, uint32_t v) {
+    switch (op) {
+        case OP_AMOSWAP_W: return v;
+        case OP_AMOADD_W: return old + v;
+        case OP_AMOXOR_W: return old ^ v;
+        case OP_AMOAND_W: return old & v;
+        case OP_AMOOR_W: return old | v;
+        case OP_AMOMIN_W: return ((int32_t)old < (int32_t)v) ? old : v;
+        case OP_AMOMAX_W: return ((int32_t)old > (int32_t)v) ? old : v;
+        case OP_AMOMINU_W: return (old < v) ? old : v;
+        default: return (old > v) ? old : v;
+    }
+}
+
+// Decodifica uma palavra de instrução: o handler (op), os registradores e o imediato
+// já extraído e com sinal estendido. O simulador guarda o resultado em icache[].
+static void decode_instruction(uint32_t instruction, decoded_insn_t *d) {
+    uint32_t opcode = instruction & 0x7F;
+    uint32_t rd = (instruction >> 7) & 0x1F; uint32_t funct3 = (instruction >> 12) & 0x7; uint32_t rs1 = (instruction >> 15) & 0x1F; uint32_t rs2 = (instruction >> 20) & 0x1F; uint32_t funct7 = (instruction >> 25) & 0x7F;
+    int32_t imm_i = (int32_t)(instruction & 0xFFF00000) >> 20;
+    d->raw = instruction; d->rd = rd; d->rs1 = rs1; d->rs2 = rs2; d->imm = 0; d->op = OP_ILLEGAL;
+
+    switch (opcode) {
+        case 0x13: { // I-Type
+            static const uint8_t ops[8] = { OP_ADDI, OP_SLLI, OP_SLTI, OP_SLTIU, OP_XORI, OP_SRLI, OP_ORI, OP_ANDI };
+            d->op = ops[funct3]; d->imm = imm_i;
+            if (funct3 == 0x1 || funct3 == 0x5) d->imm = imm_i & 0x1F;
+            if (funct3 == 0x5) {
+                if (funct7 == 0x20) d->op = OP_SRAI;
+                else if (funct7 != 0x00) d->op = OP_NOP;
+            }
+            break;
+        }
+        case 0x33: { // R-Type
+            static const uint8_t ops_base[8] = { OP_ADD, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_OR, OP_AND };
+            static const uint8_t ops_m[8] = { OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU, OP_DIV, OP_DIVU, OP_REM, OP_REMU };
+            if (funct7 == 0x00) d->op = ops_base[funct3];
+            else if (funct7 == 0x20 && funct3 == 0x0) d->op = OP_SUB;
+            else if (funct7 == 0x20 && funct3 == 0x5) d->op = OP_SRA;
+            else if (POXIM_EXT_M && funct7 == 0x01) d->op = ops_m[funct3];
+            break;
+        }
+        case 0x6F: { // jal
+            uint32_t imm_20 = (instruction >> 31) & 1; uint32_t imm_10_1 = (instruction >> 21) & 0x3FF; uint32_t imm_11 = (instruction >> 20) & 1; uint32_t imm_19_12 = (instruction >> 12) & 0xFF;
+            int32_t offset = (imm_20 << 20) | (imm_19_12 << 12) | (imm_11 << 11) | (imm_10_1 << 1); offset = (int32_t)(offset << 11) >> 11;
+            d->op = OP_JAL; d->imm = offset;
+            break;
+        }
+        case 0x63: { // Branches
+            static const uint8_t ops[8] = { OP_BEQ, OP_BNE, OP_ILLEGAL, OP_ILLEGAL, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU };
+            uint32_t imm_12 = (instruction >> 31) & 1; uint32_t imm_10_5 = (instruction >> 25) & 0x3F; uint32_t imm_4_1 = (instruction >> 8) & 0xF; uint32_t imm_11 = (instruction >> 7) & 1;
+            int32_t offset = (imm_12 << 12) | (imm_11 << 11) | (imm_10_5 << 5) | (imm_4_1 << 1); offset = (int32_t)(offset << 19) >> 19;
+            d->op = ops[funct3]; d->imm = offset;
+            break;
+        }
+        case 0x37: d->op = OP_LUI; d->imm = (int32_t)(instruction & 0xFFFFF000); break;
+        case 0x17: d->op = OP_AUIPC; d->imm = (int32_t)(instruction & 0xFFFFF000); break;
+        case 0x67: d->op = OP_JALR; d->imm = imm_i; break;
+        case 0x03: { // Loads
+            static const uint8_t ops[8] = { OP_LB, OP_LH, OP_LW, OP_ILLEGAL, OP_LBU, OP_LHU, OP_ILLEGAL, OP_ILLEGAL };
+            d->op = ops[funct3]; d->imm = imm_i;
+            break;
+        }
+        case 0x23: { // Stores
+            static const uint8_t ops[8] = { OP_SB, OP_SH, OP_SW, OP_ILLEGAL, OP_ILLEGAL, OP_ILLEGAL, OP_ILLEGAL, OP_ILLEGAL };
+            uint32_t imm_11_5 = (instruction >> 25) & 0x7F; uint32_t imm_4_0  = (instruction >> 7) & 0x1F; int32_t imm = (imm_11_5 << 5) | imm_4_0; imm = (int32_t)(imm << 20) >> 20;
+            d->op = ops[funct3]; d->imm = imm;
+            break;
+        }
+#if POXIM_EXT_ZIFENCEI
+        case 0x0F: d->op = (funct3 == 0) ? OP_FENCE : (funct3 == 1) ? OP_FENCE_I : OP_ILLEGAL; break;
+#endif
+#if POXIM_EXT_A
+        case 0x2F: { // RV32A (aq/rl ignorados: todo acesso atômico é sequencialmente consistente)
+            static const uint8_t ops[32] = { [0x00] = OP_AMOADD_W, [0x01] = OP_AMOSWAP_W, [0x02] = OP_LR_W, [0x03] = OP_SC_W, [0x04] = OP_AMOXOR_W, [0x08] = OP_AMOOR_W,
+                                             [0x0C] = OP_AMOAND_W, [0x10] = OP_AMOMIN_W, [0x14] = OP_AMOMAX_W, [0x18] = OP_AMOMINU_W, [0x1C] = OP_AMOMAXU_W };
+            uint8_t op = ops[funct7 >> 2];
+            if (funct3 == 2 && op != OP_INVALID && (op != OP_LR_W || rs2 == 0)) d->op = op;
+            break;
+        }
+#endif
+        case 0x73: { // SYSTEM / CSR
+            static const uint8_t ops[8] = { OP_ILLEGAL, OP_CSRRW, OP_CSRRS, OP_CSRRC, OP_ILLEGAL, OP_CSRRWI, OP_CSRRSI, OP_CSRRCI };
+            uint32_t csr_addr = (instruction >> 20) & 0xFFF;
+            d->imm = csr_addr;
+            if (funct3 == 0) {
+                if (csr_addr == 0) d->op = OP_ECALL;
+                else if (csr_addr == 1) d->op = OP_EBREAK;
+                else if (csr_addr == 0x302) d->op = OP_MRET;
+                else if (POXIM_WFI && csr_addr == 0x105) d->op = OP_WFI;
+            } else {
+                d->op = ops[funct3];
+            }
+            break;
+        }
+        default: d->op = OP_UNKNOWN; break;
+    }
+}
+
+// RV32C: a instrução compacta é expandida na equivalente de 32 bits (op, registradores e
+// imediato), então o resto do simulador não a distingue; só o tamanho (raw) e o mnemônico
+// do trace mudam. Codificações reservadas e as de ponto flutuante são ilegais; 0x0000
+// continua sendo a instrução nula.
+static void decode_compressed(uint32_t c, decoded_insn_t *d) {
+    uint32_t funct3 = (c >> 13) & 0x7, bit12 = (c >> 12) & 1;
+    uint32_t rd = (c >> 7) & 0x1F, rs2 = (c >> 2) & 0x1F, rd_p = 8 + ((c >> 2) & 0x7), rs1_p = 8 + ((c >> 7) & 0x7);
+    int32_t imm6 = (int32_t)((bit12 << 5 | rs2) << 26) >> 26;
+    uint32_t uimm_lw = ((c >> 7) & 0x38) | ((c >> 4) & 0x4) | ((c << 1) & 0x40);
+    d->raw = c; d->rd = rd; d->rs1 = rd; d->rs2 = rs2; d->imm = 0; d->op = OP_ILLEGAL;
+
+    switch ((c & 3) << 3 | funct3) {
+        case 000: { // c.addi4spn
+            uint32_t imm = ((c >> 7) & 0x30) | ((c >> 1) & 0x3C0) | ((c >> 4) & 0x4) | ((c >> 2) & 0x8);
+            if (imm) { d->op = OP_ADDI; d->rd = rd_p; d->rs1 = 2; d->imm = imm; }
+            break;
+        }
+        case 002: d->op = OP_LW; d->rd = rd_p; d->rs1 = rs1_p; d->imm = uimm_lw; break;                 // c.lw
+        case 006: d->op = OP_SW; d->rs1 = rs1_p; d->rs2 = rd_p; d->imm = uimm_lw; break;                 // c.sw
+        case 010: d->op = OP_ADDI; d->imm = imm6; break;                                                  // c.addi (c.nop)
+        case 011: case 015: { // c.jal, c.j
+            uint32_t off = ((c >> 1) & 0x800) | ((c >> 7) & 0x10) | ((c >> 1) & 0x300) | ((c << 2) & 0x400) | ((c >> 1) & 0x40) | ((c << 1) & 0x80) | ((c >> 2) & 0xE) | ((c << 3) & 0x20);
+            d->op = OP_JAL; d->rd = (funct3 == 1); d->imm = (int32_t)(off << 20) >> 20;
+            break;
+        }
+        case 012: d->op = OP_ADDI; d->rs1 = 0; d->imm = imm6; break;                                      // c.li
+        case 013:
+            if (rd == 2) { // c.addi16sp
+                uint32_t imm = (bit12 << 9) | ((c >> 2) & 0x10) | ((c << 1) & 0x40) | ((c << 4) & 0x180) | ((c << 3) & 0x20);
+                if (imm) { d->op = OP_ADDI; d->imm = (int32_t)(imm << 22) >> 22; }
+            } else if (imm6) { d->op = OP_LUI; d->imm = imm6 << 12; }                                   // c.lui
+            break;
+        case 014: { // c.srli, c.srai, c.andi, c.sub/xor/or/and
+            static const uint8_t alu[4] = { OP_SUB, OP_XOR, OP_OR, OP_AND };
+            uint32_t kind = (c >> 10) & 3;
+            d->rd = d->rs1 = rs1_p; d->rs2 = rd_p;
+            if (kind == 2) { d->op = OP_ANDI; d->imm = imm6; }
+            else if (kind < 2) { if (!bit12) { d->op = kind ? OP_SRAI : OP_SRLI; d->imm = rs2; } }
+            else if (!bit12) d->op = alu[(c >> 5) & 3];
+            break;
+        }
+        case 016: case 017: { // c.beqz, c.bnez
+            uint32_t off = ((c >> 4) & 0x100) | ((c >> 7) & 0x18) | ((c << 1) & 0xC0) | ((c >> 2) & 0x6) | ((c << 3) & 0x20);
+            d->op = (funct3 == 6) ? OP_BEQ : OP_BNE; d->rs1 = rs1_p; d->rs2 = 0; d->imm = (int32_t)(off << 23) >> 23;
+            break;
+        }
+        case 020: if (!bit12) { d->op = OP_SLLI; d->imm = rs2; } break;                                  // c.slli
+        case 022: if (rd) { d->op = OP_LW; d->rs1 = 2; d->imm = (bit12 << 5) | ((c >> 2) & 0x1C) | ((c << 4) & 0xC0); } break; // c.lwsp
+        case 024:
+            if (!bit12) {
+                if (rs2) { d->op = OP_ADD; d->rs1 = 0; }                                                 // c.mv
+                else if (rd) { d->op = OP_JALR; d->rd = 0; }                                             // c.jr
+            } else if (rs2) d->op = OP_ADD;                                                               // c.add
+            else if (rd) { d->op = OP_JALR; d->rd = 1; }                                                 // c.jalr
+            else { d->op = OP_EBREAK; d->rs1 = 0; d->imm = 1; }                                          // c.ebreak
+            break;
+        case 026: d->op = OP_SW; d->rs1 = 2; d->imm = ((c >> 7) & 0x3C) | ((c >> 1) & 0xC0); break;   // c.swsp
+    }
+}
+
+// Decodifica o que estiver em raw: instrução de 32 bits ou compacta (16 bits).
+static inline void decode_any(uint32_t raw, decoded_insn_t *d) {
+    if ((raw & 3) == 3) decode_instruction(raw, d);
+    else decode_compressed(raw & 0xFFFF, d);
+}
+
+// Mnemônico de uma instrução compacta já decodificada, para o trace.
+static inline const char *rvc_name(const decoded_insn_t *d) {
+    uint32_t quadrant = d->raw & 3, funct3 = (d->raw >> 13) & 7;
+    switch (d->op) {
+        case OP_ADDI: return quadrant == 0 ? "c.addi4spn" : funct3 == 2 ? "c.li" : funct3 == 3 ? "c.addi16sp" : d->rd ? "c.addi" : "c.nop";
+        case OP_LUI: return "c.lui";
+        case OP_SRLI: return "c.srli";
+        case OP_SRAI: return "c.srai";
+        case OP_ANDI: return "c.andi";
+        case OP_SLLI: return "c.slli";
+        case OP_SUB: return "c.sub";
+        case OP_XOR: return "c.xor";
+        case OP_OR: return "c.or";
+        case OP_AND: return "c.and";
+        case OP_ADD: return (d->raw >> 12) & 1 ? "c.add" : "c.mv";
+        case OP_JAL: return d->rd ? "c.jal" : "c.j";
+        case OP_JALR: return d->rd ? "c.jalr" : "c.jr";
+        case OP_BEQ: return "c.beqz";
+        case OP_BNE: return "c.bnez";
+        case OP_LW: return quadrant == 0 ? "c.lw" : "c.lwsp";
+        case OP_SW: return quadrant == 0 ? "c.sw" : "c.swsp";
+        case OP_EBREAK: return "c.ebreak";
+        default: return "c.ilegal";
+    }
+}
+
+#endif
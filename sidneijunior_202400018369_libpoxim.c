@@ -0,0 +1,3296 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <elf.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#ifdef SYS_openat2
+#include <linux/openat2.h>
+#endif
+#ifdef SYS_membarrier
+#include <linux/membarrier.h>
+#endif
+
+#include "sidneijunior_202400018369_isa.h"
+#include "sidneijunior_202400018369_trace.h"
+#include "sidneijunior_202400018369_selfprof.h"
+#include "sidneijunior_202400018369_libpoxim.h"
+
+// --- Definições de CSRs ---
+#define CSR_MSTATUS 0x300
+#define CSR_MIE     0x304
+#define CSR_MTVEC   0x305
+#define CSR_MEPC    0x341
+#define CSR_MCAUSE  0x342
+#define CSR_MTVAL   0x343
+#define CSR_MIP     0x344
+#define CSR_MHARTID 0xF14
+#define CSR_MCOUNTINHIBIT 0x320   // mhpmevent3..31 em 0x323..0x33F
+#define CSR_MCYCLE  0xB00         // mcycle, minstret e mhpmcounter3..31 em 0xB00 + i
+#define CSR_MCYCLEH 0xB80         // metades altas
+#define CSR_CYCLE   0xC00         // cycle, time, instret e hpmcounter3..31 (só leitura); altas em 0xC80 + i
+#define CSR_COUNT   4096
+
+// --- Códigos de Exceção e Interrupção ---
+#define CAUSE_INSN_ACCESS      0x1
+#define CAUSE_ILLEGAL_INSTR    0x2
+#define CAUSE_LOAD_ACCESS      0x5
+#define CAUSE_STORE_ACCESS     0x7
+#define CAUSE_ECALL_MMODE      0xb
+#define CAUSE_MSI              0x80000003
+#define CAUSE_MTI              0x80000007
+#define CAUSE_MEI              0x8000000b
+
+// --- Mapeamento de Memória ---
+#define CLINT_BASE  0x02000000
+#define CLINT_SIZE  0x00010000
+#define PLIC_BASE   0x0c000000
+#define PLIC_SIZE   0x00400000
+#define UART_BASE   0x10000000
+#define UART_SIZE   0x100
+#define RAM_BASE    POXIM_RAM_BASE
+#define MEM_SIZE_DEFAULT (1024 * 1024)
+#define MEM_SIZE_MAX     POXIM_MEM_SIZE_MAX   // toda a faixa acima de RAM_BASE
+
+#define TIMER_DIVIDER 100
+#define UART_TX_DELAY 0 
+#define UART_RX_DELAY 160   // instruções entre rajadas de entrada na FIFO de recepção
+#define UART_RX_ARMED (UINT64_MAX - 1)   // rx_ready de uma rajada pedida por outro hart, ainda sem instante
+#define UART_FIFO     16
+#define UART_IRQ      10    // fonte da UART no PLIC
+#define PLIC_SOURCES  32
+#define MAX_HARTS     POXIM_MAX_HARTS
+#define HART_QUANTUM  100   // instruções de cada hart por vez no modo intercalado (sem --threads)
+#define RESV_STRIPES  64    // versões das reservas do lr.w (por palavra, módulo RESV_STRIPES)
+#define RESV_NONE     1u    // resv_addr de um hart sem reserva (endereço que o lr.w não aceita)
+
+// --- Estado da máquina ---
+// Tudo que pertence a uma instância do simulador (RAM, tabelas do barramento, dispositivos,
+// saídas, harts) fica em machine_t (a poxim_machine da API). Durante uma chamada da API a
+// máquina fica associada ao thread que a executa por 'machine' (machine_enter/machine_leave).
+typedef struct hart hart_t;
+typedef struct poxim_machine machine_t;
+typedef struct cache_sim cache_sim_t;
+typedef struct timing_model timing_model_t;
+typedef struct semihost semihost_t;
+typedef struct async_out async_out_t;
+static void machine_stop_with(machine_t *m, int reason);
+
+// UART 16550: registradores, FIFOs circulares de 16 bytes (1 byte sem FCR.0, como o 16450)
+// e o instante (instret + wfi_skipped do hart 0) em que chega a próxima rajada de entrada.
+typedef struct {
+    uint8_t ier, lcr, mcr, scr, fcr, dll, dlm, thre_pending;
+    uint8_t rx[UART_FIFO], tx[UART_FIFO];
+    uint8_t rx_head, rx_count, tx_head, tx_count;
+    int32_t tx_countdown, eof_warned;
+    uint64_t rx_ready;
+} uart_t;
+
+// PLIC: prioridade por fonte, um contexto (modo M) por hart com enable e threshold,
+// pendências e fontes em atendimento (entre o claim e o complete).
+typedef struct {
+    uint32_t priority[PLIC_SOURCES];
+    uint32_t pending, claimed, lines;
+    uint32_t enable[MAX_HARTS], threshold[MAX_HARTS];
+} plic_t;
+
+struct poxim_machine {
+    uint32_t mem_size;
+    uint8_t *memory;
+    uint8_t **page_host;       // página de RAM -> posição em memory[]
+    uint8_t *page_device;      // página de dispositivo -> DEV_*
+    uint8_t *page_dirty;       // páginas de RAM escritas desde o último snapshot (só com --save-snapshot)
+    int running;
+
+    int n_harts, hart_threads, jit, superblocks, huge_pages;
+    hart_t *harts;
+    int cur_hart, stop_reason;
+
+    // icache, superblocos e JIT do thread que executa a máquina (com --threads cada hart tem os seus).
+    decoded_insn_t *icache;
+    int sb_enabled, jit_enabled;
+    uint8_t *sb_arena, *jit_buf;
+    size_t sb_used, jit_used;
+    void *sb_table, *jit_blocks;
+
+    // CLINT: msip/mtimecmp de cada hart. Escritas de outro hart avisam o dono por clint_poke[].
+    uint32_t clint_msip[MAX_HARTS];
+    uint64_t clint_mtimecmp[MAX_HARTS];
+    int clint_poke[MAX_HARTS];
+
+    // UART, PLIC (meip[h]: a saída do contexto do hart h) e a entrada da UART, mapeada
+    // inteira quando é um arquivo comum ou lida em blocos em in_buf.
+    uart_t uart;
+    plic_t plic;
+    int plic_meip[MAX_HARTS];
+    const uint8_t *in_data; size_t in_len, in_pos;
+    void *in_map; size_t in_map_len; uint8_t *in_buf; int in_eof;
+    pthread_mutex_t device_mutex;   // com --threads os dispositivos são acessados sob este mutex
+
+    // Reservas do lr.w (ver --- RV32A ---): a palavra reservada por cada hart (RESV_NONE se
+    // nenhuma), a versão da sua faixa e o valor lidos pelo lr.w. resv_version[] conta os stores
+    // nas palavras marcadas com WORD_RESV. Com --threads, hart_words[] aponta o icache_words de
+    // cada thread e resv_mutex serializa lr.w, sc.w e os stores nessas palavras.
+    uint32_t resv_addr[MAX_HARTS], resv_seen[MAX_HARTS], resv_value[MAX_HARTS];
+    uint32_t resv_version[RESV_STRIPES];
+    uint8_t *hart_words[MAX_HARTS];
+    pthread_mutex_t resv_mutex;
+    int membarrier;
+
+    // Saídas (ver poxim_set_file). output_file/bin_trace_file só apontam para trace_out/bin_out
+    // enquanto a janela de trace está aberta; sinks[] guarda os FILE* criados por poxim_set_sink.
+    FILE *trace_out, *bin_out, *console;
+    FILE *output_file, *terminal_file, *input_file;
+    FILE *sinks[POXIM_STREAMS];
+
+    // Janela de trace e snapshot agendado; o estado persiste entre chamadas de poxim_run.
+    uint64_t trace_start_icount, trace_window, window_end, quantum_end;
+    uint32_t trace_start_pc; int trace_start_at_pc, window_pending, tracing;
+    char *snapshot_path; uint64_t snapshot_icount; uint32_t snapshot_pc; int snapshot_at_pc, snapshot_pending;
+
+    // Trace binário (ver bt_write_*)
+    FILE *bin_trace_file;
+    uint8_t *bt_buf;
+    size_t bt_len;
+    uint32_t bt_expected_pc, bt_last_addr;
+    uint32_t *bt_cache_pc, *bt_cache_raw;
+
+    async_out_t *async;   // trace textual e console pelo thread de escrita (poxim_async_output)
+
+    char snapshot_parent[1024];   // snapshot restaurado (pai dos snapshots salvos nesta execução)
+
+    // Perfil (poxim_profile): execuções por meia palavra da RAM, por op e desvios tomados por op.
+    uint64_t *prof_pc;
+    uint64_t prof_op[OP_UNKNOWN + 1], prof_taken[OP_UNKNOWN + 1];
+
+    cache_sim_t *cache;   // simulador de cache (poxim_cache)
+    timing_model_t *timing;   // modelo de pipeline (poxim_timing)
+    semihost_t *semihost;     // chamadas de sistema por ecall (poxim_semihosting)
+    uint32_t image_end;       // fim da imagem carregada (break inicial do semihosting; 0: desconhecido)
+    int exit_code;            // a0 do exit do semihosting
+
+    // Blocos do poxim-aot (poxim_aot): o bloco que começa em cada meia palavra da RAM, NULL se
+    // não houver ou se o seu código foi sobrescrito. Compartilhada pelos threads.
+    const poxim_aot_program *aot;
+    const poxim_aot_block **aot_table;
+
+#if POXIM_SELF_PROFILE
+    selfprof_t selfprof[MAX_HARTS];   // autoperfil do simulador, por hart (poxim_self_profile_report)
+#endif
+};
+
+_Thread_local machine_t *machine;
+
+// Cópias dos campos de 'machine' usados no caminho rápido (feitas por machine_enter).
+_Thread_local uint32_t mem_size;
+_Thread_local uint8_t *memory;
+_Thread_local uint8_t **page_host;
+_Thread_local uint8_t *page_dirty;
+
+// --- Estado do hart ---
+// Com --threads cada hart roda numa thread do host, então o estado do hart é _Thread_local;
+// sem threads, hart_load() troca o hart corrente salvando/carregando machine->harts[].
+_Thread_local uint32_t *registers;
+_Thread_local uint32_t pc = 0x80000000;
+_Thread_local uint32_t *csrs;
+
+_Thread_local uint64_t mtime = 0;
+_Thread_local uint64_t instret = 0;       // instruções retiradas desde o início (pelo hart)
+_Thread_local uint64_t wfi_skipped = 0;   // ciclos além de um por instrução (pulados em wfi e bolhas do modelo de pipeline): o timer conta instret + wfi_skipped
+_Thread_local int hart_id = 0;
+_Thread_local int *hart_poke;             // &machine->clint_poke[hart_id]
+
+// Eventos que os mhpmevent podem selecionar. Traps e acessos à UART são contados sempre
+// (caminhos raros); loads, stores e desvios tomados só enquanto algum contador ativo os
+// seleciona (hpm_active), e nesse intervalo o JIT e os superblocos ficam desligados.
+enum { HPM_NONE = 0, HPM_LOADS, HPM_STORES, HPM_BRANCHES_TAKEN, HPM_TRAPS, HPM_UART, HPM_EVENTS };
+_Thread_local uint64_t *hpm_events;       // machine->harts[hart_id].hpm_events
+_Thread_local int hpm_active = 0;
+
+// mtime avança uma unidade a cada TIMER_DIVIDER ciclos do hart e só é materializado quando lido.
+static inline void timer_sync(void) { mtime = (instret + wfi_skipped) / TIMER_DIVIDER; }
+
+_Thread_local int trap_occurred = 0;
+_Thread_local int irq_dirty = 1;   // mip/interrupções precisam ser reavaliados na próxima instrução retirada
+
+static inline void device_lock(void) { if (machine->hart_threads) pthread_mutex_lock(&machine->device_mutex); }
+static inline void device_unlock(void) { if (machine->hart_threads) pthread_mutex_unlock(&machine->device_mutex); }
+static inline void resv_lock(void) { if (machine->hart_threads) pthread_mutex_lock(&machine->resv_mutex); }
+static inline void resv_unlock(void) { if (machine->hart_threads) pthread_mutex_unlock(&machine->resv_mutex); }
+
+static inline void machine_stop(void) { __atomic_store_n(&machine->running, 0, __ATOMIC_RELAXED); }
+static inline int machine_running(void) { return __atomic_load_n(&machine->running, __ATOMIC_RELAXED); }
+
+// --- Cache de instruções pré-decodificadas ---
+// Uma entrada por meia palavra da RAM (com RV32C uma instrução começa em qualquer endereço
+// par). A decodificação (campos e imediatos) é feita apenas na primeira busca. icache_words[]
+// (logo depois das entradas, na mesma alocação) marca as palavras cobertas por alguma
+// instrução decodificada (WORD_CODE) ou reservadas por um lr.w (WORD_RESV): todo caminho de
+// store consulta uma marca por palavra escrita e, se há alguma, passa por invalidate_decoded.
+// Com --threads cada thread tem o seu (código escrito por outro hart exige fence.i) e as
+// marcas são alteradas com operações atômicas, porque o lr.w de outro thread marca WORD_RESV.
+_Thread_local decoded_insn_t *icache;
+_Thread_local uint8_t *icache_words;
+enum { WORD_CODE = 1, WORD_RESV = 2 };
+
+static inline void word_mark(uint8_t *words, uint32_t w, uint8_t bit) { if (!(words[w] & bit)) __atomic_fetch_or(&words[w], bit, __ATOMIC_RELAXED); }
+
+static inline size_t icache_bytes(void) { return (size_t)(mem_size / 2) * sizeof(decoded_insn_t) + mem_size / 4; }
+
+// Memória do guest e tabelas indexadas por palavra: mapeamento anônimo MAP_NORESERVE,
+// então só as páginas tocadas ocupam memória e a inicialização não depende do tamanho.
+void *alloc_guest(size_t bytes, int huge_pages) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) madvise(p, bytes, MADV_HUGEPAGE);
+#else
+    (void)huge_pages;
+#endif
+    return p;
+}
+
+uint32_t memory_word(uint32_t idx) { return memory[idx] | (memory[idx+1] << 8) | (memory[idx+2] << 16) | (memory[idx+3] << 24); }
+
+// Decodifica a instrução em RAM_BASE + idx (idx par) em *d. Devolve 0 se ela é de 32 bits e
+// passa do fim da RAM; uma instrução que cruza palavras ou páginas marca as duas palavras.
+static inline int decode_at(uint32_t idx, decoded_insn_t *d) {
+    uint32_t parcel = memory[idx] | (memory[idx + 1] << 8);
+    if ((parcel & 3) != 3) decode_compressed(parcel, d);
+    else if (idx > mem_size - 4) return 0;
+    else decode_instruction(memory_word(idx), d);
+    word_mark(icache_words, idx >> 2, WORD_CODE); word_mark(icache_words, (idx + insn_length(d->raw) - 1) >> 2, WORD_CODE);
+    return 1;
+}
+
+extern _Thread_local int jit_enabled, sb_enabled;
+void jit_invalidate_word(uint32_t word);
+void jit_flush(void);
+void sb_invalidate_word(uint32_t word);
+void sb_flush(void);
+void aot_invalidate_word(uint32_t word);
+void aot_mark_words(void);
+
+// --- Trace binário ---
+// Registros compactos (ver sidneijunior_202400018369_trace.h) acumulados em um buffer
+// grande; poxim-trace reconstrói o .out textual a partir deles.
+#define BT_BUFFER_SIZE (1 << 20)
+
+_Thread_local uint32_t trace_value = 0, trace_addr = 0;
+
+// O buffer e a tabela bt_cache são alocados só quando o trace binário é pedido.
+int bt_init(machine_t *m) {
+    m->bt_buf = malloc(BT_BUFFER_SIZE);
+    m->bt_cache_pc = calloc(BT_CACHE_SIZE, sizeof(uint32_t)); m->bt_cache_raw = calloc(BT_CACHE_SIZE, sizeof(uint32_t));
+    return m->bt_buf && m->bt_cache_pc && m->bt_cache_raw;
+}
+
+void bt_flush(void) {
+    machine_t *m = machine;
+    if (m->bt_len) fwrite(m->bt_buf, 1, m->bt_len, m->bin_trace_file);
+    m->bt_len = 0;
+}
+
+static inline uint8_t *bt_reserve(size_t n) {
+    if (machine->bt_len + n > BT_BUFFER_SIZE) bt_flush();
+    return machine->bt_buf + machine->bt_len;
+}
+
+void bt_write_header(void) {
+    uint8_t *p = bt_reserve(BT_HEADER_SIZE);
+    memcpy(p, BT_MAGIC, 4); p[4] = BT_VERSION; p[5] = p[6] = p[7] = 0;
+    machine->bt_len += BT_HEADER_SIZE;
+}
+
+void bt_write_regs(void) {
+    uint8_t *p = bt_reserve(1 + 32 * 4), *start = p;
+    *p++ = BT_REGS;
+    for (int i = 0; i < 32; i++) p = bt_put_u32(p, registers[i]);
+    machine->bt_len += p - start;
+}
+
+void bt_write_irq(uint32_t cause, uint32_t epc, uint32_t tval) {
+    uint8_t *p = bt_reserve(16), *start = p;
+    *p++ = BT_IRQ;
+    p = bt_put_varint(p, cause); p = bt_put_u32(p, epc); p = bt_put_varint(p, tval);
+    machine->bt_len += p - start;
+}
+
+// Grava a instrução recém-executada se ela gerou uma linha no trace textual.
+void bt_write_insn(const decoded_insn_t *d, uint32_t insn_pc) {
+    if (d->op == OP_NOP || d->op == OP_ILLEGAL) return;
+    if (trap_occurred && d->op != OP_ECALL && d->op != OP_UNKNOWN) return;
+    machine_t *m = machine;
+    uint8_t *p = bt_reserve(32), *start = p;
+    uint8_t tag = BT_INSN;
+    p++;
+    if (insn_pc != m->bt_expected_pc) { tag |= BT_F_JUMP; p = bt_put_varint(p, bt_zigzag((int32_t)(insn_pc - m->bt_expected_pc))); }
+    uint32_t slot = bt_cache_slot(insn_pc);
+    if (m->bt_cache_pc[slot] == insn_pc && m->bt_cache_raw[slot] == d->raw) tag |= BT_F_RAW_CACHED;
+    else { p = bt_put_u32(p, d->raw); m->bt_cache_pc[slot] = insn_pc; m->bt_cache_raw[slot] = d->raw; }
+    int fields = bt_fields(d->op);
+    if (fields & BT_HAS_ADDR) { p = bt_put_varint(p, bt_zigzag((int32_t)(trace_addr - m->bt_last_addr))); m->bt_last_addr = trace_addr; }
+    if (fields & BT_HAS_VALUE) p = bt_put_varint(p, trace_value);
+    *start = tag;
+    m->bt_len += p - start;
+    m->bt_expected_pc = insn_pc + insn_length(d->raw);
+    if (d->op == OP_ECALL && !trap_occurred) bt_write_regs();   // semihosting: a0 mudou sem registro
+}
+
+// --- Saída assíncrona ---
+// Com poxim_async_output a execução não formata nem escreve nada: cada linha do trace textual vira
+// um registro com o conteúdo do trace binário (pc, instrução, valor e endereço) e o console vira
+// registros de texto, numa fila circular sem trava com um produtor (o thread que executa) e um
+// consumidor (o thread de escrita). Este formata as linhas com bt_format_insn sobre a sua cópia
+// dos registradores, junta cada saída em um buffer de ASYNC_BUFFER bytes e o entrega de uma vez
+// ao FILE (um bloco maior que o buffer do FILE vira um write direto). Com a fila cheia a execução
+// espera. async_sync esvazia a fila onde o console já era esvaziado (fim de machine_run, leitura
+// da entrada) e antes de o simulador escrever no stdout ou trocar as saídas, então o conteúdo e a
+// ordem de cada saída são os do modo síncrono.
+#define ASYNC_RING   (1 << 16)   // registros
+#define ASYNC_BUFFER (1 << 20)   // bytes por saída
+#define ASYNC_WAKE   1024        // o produtor acorda o consumidor a cada tantos registros
+enum { ASYNC_INSN, ASYNC_IRQ, ASYNC_REG, ASYNC_TEXT, ASYNC_SYNC, ASYNC_STOP };
+typedef struct {
+    uint8_t kind, len;   // len: bytes de text (ASYNC_TEXT) ou índice do registrador (ASYNC_REG)
+    union { struct { uint32_t pc, raw, value, addr; }; uint8_t text[16]; };
+} async_rec_t;
+
+struct async_out {
+    machine_t *m;
+    async_rec_t *ring;
+    _Alignas(64) uint32_t head;   // próximo registro do produtor
+    _Alignas(64) uint32_t tail;   // próximo registro do consumidor
+    _Alignas(64) int sleeping;
+    uint32_t sync_seq, synced;
+    pthread_t thread; pthread_mutex_t lock; pthread_cond_t wake, done;
+    uint32_t x[32];               // registradores como o trace os vê
+    char *trace_buf, *console_buf; size_t trace_len, console_len;
+};
+
+static void async_wake(async_out_t *a) {
+    if (!__atomic_load_n(&a->sleeping, __ATOMIC_RELAXED)) return;
+    pthread_mutex_lock(&a->lock); pthread_cond_signal(&a->wake); pthread_mutex_unlock(&a->lock);
+}
+
+static inline async_rec_t *async_slot(async_out_t *a) {
+    if (a->head - __atomic_load_n(&a->tail, __ATOMIC_ACQUIRE) == ASYNC_RING) {
+        async_wake(a);
+        while (a->head - __atomic_load_n(&a->tail, __ATOMIC_ACQUIRE) == ASYNC_RING) sched_yield();
+    }
+    return &a->ring[a->head & (ASYNC_RING - 1)];
+}
+
+static inline void async_push(async_out_t *a) {
+    __atomic_store_n(&a->head, a->head + 1, __ATOMIC_RELEASE);
+    if ((a->head & (ASYNC_WAKE - 1)) == 0) async_wake(a);
+}
+
+static void async_flush_trace(async_out_t *a) {
+    if (a->trace_len && a->m->trace_out) fwrite(a->trace_buf, 1, a->trace_len, a->m->trace_out);
+    a->trace_len = 0;
+}
+
+static void async_flush_console(async_out_t *a) {
+    if (a->console_len && a->m->console) fwrite(a->console_buf, 1, a->console_len, a->m->console);
+    if (a->console_len && a->m->terminal_file) fwrite(a->console_buf, 1, a->console_len, a->m->terminal_file);
+    a->console_len = 0;
+}
+
+// O consumidor: dorme no máximo 1 ms com a fila vazia (o produtor só acorda a cada ASYNC_WAKE).
+static void *async_writer(void *arg) {
+    async_out_t *a = arg;
+    for (;;) {
+        uint32_t tail = a->tail;
+        if (tail == __atomic_load_n(&a->head, __ATOMIC_ACQUIRE)) {
+            pthread_mutex_lock(&a->lock);
+            __atomic_store_n(&a->sleeping, 1, __ATOMIC_SEQ_CST);
+            if (tail == __atomic_load_n(&a->head, __ATOMIC_SEQ_CST)) {
+                struct timespec t; clock_gettime(CLOCK_REALTIME, &t);
+                if ((t.tv_nsec += 1000000) >= 1000000000) { t.tv_sec++; t.tv_nsec -= 1000000000; }
+                pthread_cond_timedwait(&a->wake, &a->lock, &t);
+            }
+            __atomic_store_n(&a->sleeping, 0, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&a->lock);
+            continue;
+        }
+        const async_rec_t *r = &a->ring[tail & (ASYNC_RING - 1)];
+        switch (r->kind) {
+            case ASYNC_INSN: {
+                decoded_insn_t d; decode_any(r->raw, &d);
+                if (a->trace_len > ASYNC_BUFFER - BT_LINE_MAX) async_flush_trace(a);
+                a->trace_len += bt_format_insn(a->trace_buf + a->trace_len, a->x, r->pc, &d, r->value, r->addr);
+                bt_update_registers(a->x, r->pc, &d, r->value);
+                break;
+            }
+            case ASYNC_IRQ:
+                if (a->trace_len > ASYNC_BUFFER - BT_LINE_MAX) async_flush_trace(a);
+                a->trace_len += bt_format_irq(a->trace_buf + a->trace_len, r->pc, r->raw, r->value);
+                break;
+            case ASYNC_REG: a->x[r->len] = r->value; break;
+            case ASYNC_TEXT:
+                if (a->console_len > ASYNC_BUFFER - sizeof(r->text)) async_flush_console(a);
+                memcpy(a->console_buf + a->console_len, r->text, r->len); a->console_len += r->len;
+                break;
+            case ASYNC_SYNC: case ASYNC_STOP:
+                async_flush_trace(a); async_flush_console(a);
+                if (a->m->console) fflush(a->m->console);
+                break;
+        }
+        int kind = r->kind; uint32_t seq = r->value;
+        __atomic_store_n(&a->tail, tail + 1, __ATOMIC_RELEASE);
+        if (kind == ASYNC_SYNC) { pthread_mutex_lock(&a->lock); a->synced = seq; pthread_cond_broadcast(&a->done); pthread_mutex_unlock(&a->lock); }
+        if (kind == ASYNC_STOP) return NULL;
+    }
+}
+
+// Espera o thread de escrita entregar tudo o que já foi registrado (e esvaziar o console).
+static void async_sync(async_out_t *a) {
+    async_rec_t *r = async_slot(a);
+    r->kind = ASYNC_SYNC; r->value = ++a->sync_seq;
+    __atomic_store_n(&a->head, a->head + 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&a->lock);
+    pthread_cond_signal(&a->wake);
+    while (a->synced != a->sync_seq) pthread_cond_wait(&a->done, &a->lock);
+    pthread_mutex_unlock(&a->lock);
+}
+
+// Saídas vazias no modo síncrono: o console é esvaziado; no assíncrono, a fila.
+static void output_sync(machine_t *m) {
+    if (m->async) async_sync(m->async);
+    else if (m->console) fflush(m->console);
+}
+
+static void async_write_regs(async_out_t *a) {
+    for (int i = 0; i < 32; i++) { async_rec_t *r = async_slot(a); r->kind = ASYNC_REG; r->len = i; r->value = registers[i]; async_push(a); }
+}
+
+// Como bt_write_insn: só as instruções que gerariam uma linha. O ecall atendido pelo semihosting
+// muda a0 sem registro, então os registradores vão em seguida.
+static inline void async_write_insn(async_out_t *a, const decoded_insn_t *d, uint32_t insn_pc) {
+    if (d->op == OP_NOP || d->op == OP_ILLEGAL) return;
+    if (trap_occurred && d->op != OP_ECALL && d->op != OP_UNKNOWN) return;
+    async_rec_t *r = async_slot(a);
+    r->kind = ASYNC_INSN; r->pc = insn_pc; r->raw = d->raw; r->value = trace_value; r->addr = trace_addr;
+    async_push(a);
+    if (d->op == OP_ECALL && !trap_occurred) async_write_regs(a);
+}
+
+static void async_write_irq(async_out_t *a, uint32_t cause, uint32_t epc, uint32_t tval) {
+    async_rec_t *r = async_slot(a);
+    r->kind = ASYNC_IRQ; r->pc = cause; r->raw = epc; r->value = tval;
+    async_push(a);
+}
+
+static void async_write_text(async_out_t *a, const uint8_t *buf, size_t len) {
+    while (len) {
+        async_rec_t *r = async_slot(a);
+        size_t n = len < sizeof(r->text) ? len : sizeof(r->text);
+        r->kind = ASYNC_TEXT; r->len = n; memcpy(r->text, buf, n);
+        async_push(a); buf += n; len -= n;
+    }
+}
+
+static void async_stop(machine_t *m) {
+    async_out_t *a = m->async;
+    if (a == NULL) return;
+    async_rec_t *r = async_slot(a); r->kind = ASYNC_STOP;
+    __atomic_store_n(&a->head, a->head + 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&a->lock); pthread_cond_signal(&a->wake); pthread_mutex_unlock(&a->lock);
+    pthread_join(a->thread, NULL);
+    pthread_mutex_destroy(&a->lock); pthread_cond_destroy(&a->wake); pthread_cond_destroy(&a->done);
+    free(a->ring); free(a->trace_buf); free(a->console_buf); free(a);
+    m->async = NULL;
+}
+
+void raise_exception(uint32_t cause, uint32_t tval);   // depois do núcleo (trap_enter)
+int semihost_call(void);                               // ecall com semihosting (depois do núcleo)
+
+// --- Dispositivos ---
+// msip do hart h em 0x02000000 + 4*h, mtimecmp em 0x02004000 + 8*h. mtime é o do hart que lê.
+uint32_t clint_load(uint32_t addr) {
+    machine_t *m = machine;
+    timer_sync();
+    uint32_t off = addr - CLINT_BASE;
+    if (off % 4 != 0) return 0;
+    if (off < 4u * m->n_harts) return __atomic_load_n(&m->clint_msip[off / 4], __ATOMIC_RELAXED);
+    if (off - 0x4000 < 8u * m->n_harts) { uint64_t cmp = __atomic_load_n(&m->clint_mtimecmp[(off - 0x4000) / 8], __ATOMIC_RELAXED); return (off & 4) ? (uint32_t)(cmp >> 32) : (uint32_t)cmp; }
+    if (addr == 0x0200bff8) return (uint32_t)(mtime);
+    if (addr == 0x0200bffc) return (uint32_t)(mtime >> 32);
+    return 0;
+}
+
+// O hart h reavalia suas interrupções na próxima instrução retirada.
+static void clint_notify(uint32_t h) {
+    if (h == (uint32_t)hart_id) irq_dirty = 1;
+    else __atomic_store_n(&machine->clint_poke[h], 1, __ATOMIC_RELEASE);
+}
+
+void clint_store(uint32_t addr, uint32_t value) {
+    machine_t *m = machine;
+    irq_dirty = 1;
+    uint32_t off = addr - CLINT_BASE;
+    if (off % 4 != 0) return;
+    if (off < 4u * m->n_harts) { __atomic_store_n(&m->clint_msip[off / 4], value & 0x1, __ATOMIC_RELAXED); clint_notify(off / 4); }
+    else if (off - 0x4000 < 8u * m->n_harts) {
+        uint32_t h = (off - 0x4000) / 8; uint64_t cmp = m->clint_mtimecmp[h];
+        cmp = (off & 4) ? ((cmp & 0x00000000FFFFFFFF) | ((uint64_t)value << 32)) : ((cmp & 0xFFFFFFFF00000000) | value);
+        __atomic_store_n(&m->clint_mtimecmp[h], cmp, __ATOMIC_RELAXED); clint_notify(h);
+    }
+}
+
+// PLIC: prioridades em 0x0c000000 + 4*fonte, pendências em 0x0c001000, enables do contexto c
+// em 0x0c002000 + 0x80*c, threshold e claim/complete em 0x0c200000 + 0x1000*c (+4).
+// O gateway é sensível a nível: a linha do dispositivo em 1 marca a fonte como pendente (e ela
+// continua pendente até o claim); depois do claim a fonte só volta a pender após o complete.
+static void plic_update(machine_t *m) {
+    plic_t *p = &m->plic;
+    for (int h = 0; h < m->n_harts; h++) {
+        int meip = 0;
+        for (uint32_t bits = p->pending & p->enable[h]; bits && !meip; bits &= bits - 1) meip = p->priority[__builtin_ctz(bits)] > p->threshold[h];
+        if (meip != m->plic_meip[h]) { m->plic_meip[h] = meip; clint_notify(h); }
+    }
+}
+
+static void plic_set_line(machine_t *m, int source, int level) {
+    uint32_t bit = 1u << source;
+    if (!!(m->plic.lines & bit) == !!level) return;
+    m->plic.lines = level ? (m->plic.lines | bit) : (m->plic.lines & ~bit);
+    if (level && !(m->plic.claimed & bit)) m->plic.pending |= bit;
+    plic_update(m);
+}
+
+static uint32_t plic_claim(machine_t *m, uint32_t ctx) {
+    plic_t *p = &m->plic; uint32_t best = 0, best_priority = p->threshold[ctx];
+    for (uint32_t bits = p->pending & p->enable[ctx]; bits; bits &= bits - 1) {
+        uint32_t src = __builtin_ctz(bits);
+        if (p->priority[src] > best_priority) { best = src; best_priority = p->priority[src]; }
+    }
+    if (best) { p->claimed |= 1u << best; p->pending &= ~(1u << best); plic_update(m); }
+    return best;
+}
+
+uint32_t plic_load(uint32_t addr) {
+    machine_t *m = machine; plic_t *p = &m->plic;
+    uint32_t off = addr - PLIC_BASE;
+    if (off % 4 != 0) return 0;
+    if (off < 4 * PLIC_SOURCES) return p->priority[off / 4];
+    if (off == 0x1000) return p->pending;
+    if (off - 0x2000 < 0x80u * m->n_harts && off % 0x80 == 0) return p->enable[(off - 0x2000) / 0x80];
+    if (off - 0x200000 < 0x1000u * m->n_harts) {
+        uint32_t ctx = (off - 0x200000) / 0x1000;
+        if (off % 0x1000 == 0) return p->threshold[ctx];
+        if (off % 0x1000 == 4) return plic_claim(m, ctx);
+    }
+    return 0;
+}
+
+void plic_store(uint32_t addr, uint32_t value) {
+    machine_t *m = machine; plic_t *p = &m->plic;
+    uint32_t off = addr - PLIC_BASE;
+    if (off % 4 != 0) return;
+    if (off < 4 * PLIC_SOURCES) { if (off) p->priority[off / 4] = value & 7; }   // a fonte 0 não existe
+    else if (off - 0x2000 < 0x80u * m->n_harts && off % 0x80 == 0) p->enable[(off - 0x2000) / 0x80] = value & ~1u;
+    else if (off - 0x200000 < 0x1000u * m->n_harts) {
+        uint32_t ctx = (off - 0x200000) / 0x1000;
+        if (off % 0x1000 == 0) p->threshold[ctx] = value & 7;
+        else if (off % 0x1000 == 4 && value < PLIC_SOURCES && (p->enable[ctx] & (1u << value))) {
+            p->claimed &= ~(1u << value); p->pending |= p->lines & (1u << value);
+        } else return;
+    } else return;
+    plic_update(m);
+}
+
+// UART: RBR/THR (0), IER (1), IIR/FCR (2), LCR (3), MCR (4), LSR (5), MSR (6), SCR (7); com
+// LCR.7 (DLAB) os offsets 0 e 1 são o divisor. Sem FIFO cheia de entrada, ler RBR busca o
+// próximo byte direto da entrada (guests que leem sem consultar LSR), e no fim da entrada
+// devolve 10 uma vez e depois 0xFFFFFFFF.
+static int uart_input_fill(machine_t *m) {
+    FILE *f = m->input_file;
+    if (f == NULL || m->in_eof) return 0;
+    if (m->in_data == NULL) {
+        struct stat st; off_t start = ftello(f); int fd = fileno(f);
+        if (fd >= 0 && start >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            m->in_eof = 1;
+            if (st.st_size <= start) return 0;
+            m->in_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m->in_map == MAP_FAILED) { m->in_map = NULL; return 0; }
+            m->in_map_len = st.st_size; m->in_data = (const uint8_t *)m->in_map + start; m->in_len = st.st_size - start; m->in_pos = 0;
+            return 1;
+        }
+    }
+    if (m->in_buf == NULL && (m->in_buf = malloc(4096)) == NULL) return 0;
+    output_sync(m);   // a entrada pode ser interativa
+    size_t n = fread(m->in_buf, 1, 4096, f);
+    if (n == 0) { m->in_eof = 1; return 0; }
+    m->in_data = m->in_buf; m->in_len = n; m->in_pos = 0;
+    return 1;
+}
+
+static void uart_input_reset(machine_t *m) {
+    if (m->in_map) munmap(m->in_map, m->in_map_len);
+    free(m->in_buf);
+    m->in_map = NULL; m->in_map_len = 0; m->in_buf = NULL; m->in_data = NULL; m->in_len = m->in_pos = 0; m->in_eof = 0;
+}
+
+static inline int uart_input_available(machine_t *m) { return m->in_pos < m->in_len || uart_input_fill(m); }
+static inline int uart_fifo_depth(const uart_t *u) { return (u->fcr & 1) ? UART_FIFO : 1; }
+
+// Linha de interrupção: dados recebidos (IER.0) ou THR vazio (IER.1).
+static void uart_update_irq(machine_t *m) {
+    uart_t *u = &m->uart;
+    plic_set_line(m, UART_IRQ, ((u->ier & 1) && u->rx_count) || ((u->ier & 2) && u->thre_pending));
+}
+
+// Com a FIFO de recepção vazia e entrada restante, a próxima rajada chega UART_RX_DELAY instruções
+// do hart 0 depois; ele a entrega em update_interrupts. Se outro hart leu a UART, o instante só é
+// fixado pelo hart 0 (uart_tick), no seu relógio, quando ele atende o aviso.
+static void uart_rx_arm(machine_t *m) {
+    uart_t *u = &m->uart;
+    if (u->rx_count || u->rx_ready != UINT64_MAX || !uart_input_available(m)) return;
+    u->rx_ready = (hart_id == 0) ? instret + wfi_skipped + UART_RX_DELAY : UART_RX_ARMED;
+    clint_notify(0);
+}
+
+static void uart_rx_burst(machine_t *m) {
+    uart_t *u = &m->uart; int depth = uart_fifo_depth(u);
+    u->rx_ready = UINT64_MAX;
+    while (u->rx_count < depth && uart_input_available(m)) u->rx[(u->rx_head + u->rx_count++) % UART_FIFO] = m->in_data[m->in_pos++];
+    uart_update_irq(m);
+}
+
+// Transmite o que estiver na FIFO; sem UART_TX_DELAY cada byte sai na hora. O console não é
+// mais esvaziado a cada byte: machine_run o esvazia ao retornar.
+static void uart_transmit(machine_t *m) {
+    uart_t *u = &m->uart;
+    while (u->tx_count && u->tx_countdown == 0) {
+        uint8_t c = u->tx[u->tx_head]; u->tx_head = (u->tx_head + 1) % UART_FIFO; u->tx_count--;
+        if (m->async) async_write_text(m->async, &c, 1);
+        else {
+            if (m->console) fputc(c, m->console);
+            if (m->terminal_file) fputc(c, m->terminal_file);
+        }
+        u->tx_countdown = UART_TX_DELAY;
+        if (u->tx_count == 0) u->thre_pending = 1;
+    }
+    uart_update_irq(m);
+}
+
+// Chamada pelo hart 0 a cada reavaliação de interrupções; devolve 1 enquanto a UART transmite.
+static int uart_tick(machine_t *m) {
+    uart_t *u = &m->uart;
+    if (u->tx_countdown > 0 && --u->tx_countdown == 0) uart_transmit(m);
+    if (u->rx_ready == UART_RX_ARMED) u->rx_ready = instret + wfi_skipped + UART_RX_DELAY;
+    if (u->rx_ready != UINT64_MAX && instret + wfi_skipped >= u->rx_ready) uart_rx_burst(m);
+    return u->tx_countdown > 0;
+}
+
+static uint8_t uart_iir(machine_t *m) {
+    uart_t *u = &m->uart; uint8_t fifo = (u->fcr & 1) ? 0xC0 : 0;
+    if ((u->ier & 1) && u->rx_count) return fifo | ((u->rx_count >= (uint8_t[]){ 1, 4, 8, 14 }[u->fcr >> 6] || !(u->fcr & 1)) ? 0x04 : 0x0C);
+    if ((u->ier & 2) && u->thre_pending) { u->thre_pending = 0; uart_update_irq(m); return fifo | 0x02; }   // ler o IIR reconhece o THRE
+    return fifo | 0x01;
+}
+
+uint32_t uart_load(uint32_t addr) {
+    machine_t *m = machine; uart_t *u = &m->uart;
+    hpm_events[HPM_UART]++;
+    switch (addr - UART_BASE) {
+        case 0: {
+            if (u->lcr & 0x80) return u->dll;
+            if (u->rx_count) {
+                uint8_t c = u->rx[u->rx_head]; u->rx_head = (u->rx_head + 1) % UART_FIFO; u->rx_count--;
+                if (!u->rx_count) { uart_update_irq(m); if (u->ier & 1) uart_rx_arm(m); }
+                return c;
+            }
+            if (uart_input_available(m)) return m->in_data[m->in_pos++];
+            if (!u->eof_warned) { u->eof_warned = 1; return 10; }
+            return 0xFFFFFFFF;
+        }
+        case 1: return (u->lcr & 0x80) ? u->dlm : u->ier;
+        case 2: return uart_iir(m);
+        case 3: return u->lcr;
+        case 4: return u->mcr;
+        case 5:
+            if (!u->rx_count) uart_rx_arm(m);
+            return (u->rx_count ? 0x01 : 0) | (u->tx_count ? 0 : 0x20) | (u->tx_count || u->tx_countdown ? 0 : 0x40);
+        case 7: return u->scr;
+    }
+    return 0;
+}
+
+void uart_store(uint32_t addr, uint32_t value) {
+    machine_t *m = machine; uart_t *u = &m->uart;
+    irq_dirty = 1; hpm_events[HPM_UART]++;
+    switch (addr - UART_BASE) {
+        case 0:
+            if (u->lcr & 0x80) { u->dll = value; break; }
+            if (u->tx_count < uart_fifo_depth(u)) { u->tx[(u->tx_head + u->tx_count++) % UART_FIFO] = value; u->thre_pending = 0; }
+            uart_transmit(m);
+            break;
+        case 1:
+            if (u->lcr & 0x80) { u->dlm = value; break; }
+            // Habilitar o THRE com o transmissor vazio já gera a interrupção, como no 16550.
+            if ((value & 2) && !(u->ier & 2) && !u->tx_count) u->thre_pending = 1;
+            u->ier = value & 0x0F;
+            if (u->ier & 1) uart_rx_arm(m);
+            uart_update_irq(m);
+            break;
+        case 2:   // FCR: ligar/desligar as FIFOs ou limpá-las descarta o conteúdo
+            if ((value ^ u->fcr) & 1) value |= 0x06;
+            if (value & 2) { u->rx_count = 0; u->rx_head = 0; }
+            if (value & 4) { u->tx_count = 0; u->tx_head = 0; u->thre_pending = 1; }
+            u->fcr = value & 0xC1;
+            if (u->ier & 1) uart_rx_arm(m);
+            uart_update_irq(m);
+            break;
+        case 3: u->lcr = value; break;
+        case 4: u->mcr = value; break;
+        case 7: u->scr = value; break;
+    }
+}
+
+// --- Tabela de regiões ---
+// Cada página de 4 KiB do espaço de endereços aponta direto para memory[] (RAM) ou
+// para um dispositivo. Páginas sem nada mapeado geram access fault.
+#define PAGE_SHIFT 12
+#define PAGE_COUNT (1u << (32 - PAGE_SHIFT))
+
+typedef struct {
+    uint32_t base, size;
+    uint32_t (*load)(uint32_t addr);
+    void (*store)(uint32_t addr, uint32_t value);
+} bus_device_t;
+
+enum { DEV_NONE = 0, DEV_CLINT, DEV_PLIC, DEV_UART };
+static const bus_device_t bus_devices[] = {
+    [DEV_CLINT] = { CLINT_BASE, CLINT_SIZE, clint_load, clint_store },
+    [DEV_PLIC]  = { PLIC_BASE,  PLIC_SIZE,  plic_load,  plic_store  },
+    [DEV_UART]  = { UART_BASE,  UART_SIZE,  uart_load,  uart_store  },
+};
+
+// As tabelas têm uma entrada por página dos 4 GiB; calloc só materializa as tocadas.
+int bus_init(machine_t *m) {
+    m->page_host = calloc(PAGE_COUNT, sizeof(uint8_t *)); m->page_device = calloc(PAGE_COUNT, 1);
+    if (m->page_host == NULL || m->page_device == NULL) return 0;
+    for (uint32_t off = 0; off < m->mem_size; off += 1u << PAGE_SHIFT) m->page_host[(RAM_BASE + off) >> PAGE_SHIFT] = m->memory + off;
+    for (int dev = DEV_CLINT; dev <= DEV_UART; dev++) {
+        const bus_device_t *d = &bus_devices[dev];
+        for (uint64_t a = d->base; a < (uint64_t)d->base + d->size; a += 1u << PAGE_SHIFT) m->page_device[a >> PAGE_SHIFT] = dev;
+    }
+    return 1;
+}
+
+// Acessos à RAM que cruzam páginas ou passam do fim da memória.
+uint32_t ram_load_slow(uint32_t addr, int size_bytes) {
+    if (addr < RAM_BASE) { raise_exception(CAUSE_LOAD_ACCESS, addr); return 0; }
+    uint32_t index = addr - RAM_BASE;
+    if (index > mem_size - size_bytes) { raise_exception(CAUSE_LOAD_ACCESS, addr); return 0; }
+    uint32_t val = 0;
+    for(int i=0; i<size_bytes; i++) val |= (uint32_t)memory[index + i] << (8*i);
+    return val;
+}
+
+uint32_t bus_load_slow(uint32_t addr, int size_bytes) {
+    uint32_t page = addr >> PAGE_SHIFT;
+    if (page_host[page]) return ram_load_slow(addr, size_bytes);
+    uint8_t dev = machine->page_device[page]; const bus_device_t *d = &bus_devices[dev];
+    if (dev != DEV_NONE && addr - d->base < d->size) { uint32_t v; SELFPROF_TIME(SELFPROF_LOAD + SELFPROF_CLINT + dev - DEV_CLINT, device_lock(); v = d->load(addr); device_unlock()); return v; }
+    raise_exception(CAUSE_LOAD_ACCESS, addr);
+    return 0;
+}
+
+static inline uint32_t bus_load(uint32_t addr, int size_bytes) {
+    uint8_t *host = page_host[addr >> PAGE_SHIFT];
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Acesso alinhado nunca cruza página: um único load do host.
+    if (host && (addr & (size_bytes - 1)) == 0) {
+        host += addr & ((1u << PAGE_SHIFT) - 1);
+        if (size_bytes == 4) { uint32_t v; memcpy(&v, host, 4); return v; }
+        if (size_bytes == 2) { uint16_t v; memcpy(&v, host, 2); return v; }
+        return *host;
+    }
+#endif
+    (void)host;
+    return bus_load_slow(addr, size_bytes);
+}
+
+// As entradas que podem cobrir a palavra w são as das suas duas meias palavras e a de uma
+// instrução de 32 bits que começa 2 bytes antes dela.
+static inline void invalidate_decoded(uint32_t index, int size_bytes) {
+    uint32_t first = index >> 2, last = (index + size_bytes - 1) >> 2;
+    for (uint32_t w = first; w <= last; w++) {
+        uint8_t mark = icache_words[w];
+        if (mark & WORD_RESV) __atomic_fetch_add(&machine->resv_version[w % RESV_STRIPES], 1, __ATOMIC_RELAXED);
+        if (!(mark & WORD_CODE)) continue;
+        __atomic_fetch_and(&icache_words[w], (uint8_t)~WORD_CODE, __ATOMIC_RELAXED);
+        for (uint32_t h = w ? 2 * w - 1 : 0; h <= 2 * w + 1; h++) icache[h].op = OP_INVALID;
+        if (sb_enabled) sb_invalidate_word(w);
+        if (jit_enabled) jit_invalidate_word(w);
+        if (machine->aot_table) aot_invalidate_word(w);
+    }
+}
+
+// Com --threads um store numa palavra reservada fica sob resv_mutex junto com a mudança de versão.
+static inline int resv_lock_words(uint32_t index, int size_bytes) {
+    if (!machine->hart_threads || !((icache_words[index >> 2] | icache_words[(index + size_bytes - 1) >> 2]) & WORD_RESV)) return 0;
+    pthread_mutex_lock(&machine->resv_mutex);
+    return 1;
+}
+
+// Remarca as palavras reservadas no icache_words do thread (ao criá-lo e depois de um fence.i).
+static void resv_remark(void) {
+    machine_t *m = machine;
+    resv_lock();
+    for (int h = 0; h < m->n_harts; h++) if (m->resv_addr[h] != RESV_NONE) word_mark(icache_words, (m->resv_addr[h] - RAM_BASE) >> 2, WORD_RESV);
+    resv_unlock();
+}
+
+void bus_store_slow(uint32_t addr, uint32_t value, int size_bytes) {
+    uint32_t page = addr >> PAGE_SHIFT;
+    if (page_host[page]) {
+        uint32_t index = addr - RAM_BASE;
+        if (addr < RAM_BASE || index > mem_size - size_bytes) { raise_exception(CAUSE_STORE_ACCESS, addr); return; }
+        int locked = resv_lock_words(index, size_bytes);
+        for(int i=0; i<size_bytes; i++) memory[index + i] = (value >> (8*i)) & 0xFF;
+        if (page_dirty) { page_dirty[index >> PAGE_SHIFT] = 1; page_dirty[(index + size_bytes - 1) >> PAGE_SHIFT] = 1; }
+        invalidate_decoded(index, size_bytes);
+        if (locked) resv_unlock();
+        return;
+    }
+    uint8_t dev = machine->page_device[page]; const bus_device_t *d = &bus_devices[dev];
+    if (dev != DEV_NONE && addr - d->base < d->size) { SELFPROF_TIME(SELFPROF_STORE + SELFPROF_CLINT + dev - DEV_CLINT, device_lock(); d->store(addr, value); device_unlock()); return; }
+    raise_exception(CAUSE_STORE_ACCESS, addr);
+}
+
+static inline void bus_store(uint32_t addr, uint32_t value, int size_bytes) {
+    uint8_t *host = page_host[addr >> PAGE_SHIFT];
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (host && (addr & (size_bytes - 1)) == 0) {
+        host += addr & ((1u << PAGE_SHIFT) - 1);
+        uint32_t index = (uint32_t)(host - memory);
+        if (icache_words[index >> 2]) { bus_store_slow(addr, value, size_bytes); return; }   // código ou reserva: a marca é vista antes do store
+        if (size_bytes == 4) { memcpy(host, &value, 4); }
+        else if (size_bytes == 2) { uint16_t v = (uint16_t)value; memcpy(host, &v, 2); }
+        else *host = (uint8_t)value;
+        if (page_dirty) page_dirty[index >> PAGE_SHIFT] = 1;
+        return;
+    }
+#endif
+    (void)host;
+    bus_store_slow(addr, value, size_bytes);
+}
+
+uint32_t read_word_from_memory(uint32_t address) { return bus_load(address, 4); }
+uint16_t read_half_word_from_memory(uint32_t address) { return (uint16_t)bus_load(address, 2); }
+uint8_t read_byte_from_memory(uint32_t address) { return (uint8_t)bus_load(address, 1); }
+void write_word_to_memory(uint32_t address, uint32_t value) { bus_store(address, value, 4); }
+void write_half_word_to_memory(uint32_t address, uint16_t value) { bus_store(address, value, 2); }
+void write_byte_to_memory(uint32_t address, uint8_t value) { bus_store(address, value, 1); }
+
+// --- RV32A ---
+// lr.w/sc.w/AMOs só valem em palavras alinhadas da RAM (o resto gera access fault) e usam
+// operações atômicas seq_cst do host. O lr.w marca a palavra com WORD_RESV no icache_words de
+// todos os threads e guarda a versão da sua faixa em resv_version[]. Todo caminho de store
+// (bus_store, superblocos, JIT e AOT, que saem antes de um store numa palavra marcada, AMOs e
+// escritas do semihosting) passa então por invalidate_decoded, que soma um à versão, e o sc.w
+// só grava se ela não mudou: um store de outro hart entre o lr.w e o sc.w, mesmo A->B->A ou do
+// mesmo valor, faz o sc.w falhar. A marca fica até o próximo fence.i do thread (que remarca as
+// reservas vivas), então um lock usado várias vezes não é remarcado.
+//
+// Com --threads, sc.w, AMOs e stores em palavras marcadas verificam e gravam sob resv_mutex.
+// Quando o lr.w marca uma palavra em algum thread pela primeira vez, ele espera um membarrier
+// antes de ler: o store que um hart decidiu fazer sem ver a marca termina antes da leitura do
+// lr.w, ou é o único daquele hart fora do mutex e o compare-and-swap do sc.w contra o valor
+// lido o pega se gravou outro valor.
+#if POXIM_EXT_A
+static uint32_t *amo_word(uint32_t addr, uint32_t cause) {
+    uint32_t index = addr - RAM_BASE;
+    if (addr % 4 != 0 || addr < RAM_BASE || index > mem_size - 4) { raise_exception(cause, addr); return NULL; }
+    return (uint32_t *)(memory + index);
+}
+
+// Marca a palavra w como reservada em todos os threads; devolve 1 se algum ainda não a tinha.
+static int resv_mark(uint32_t w) {
+    machine_t *m = machine; int fresh = 0;
+    if (!m->hart_threads) { word_mark(icache_words, w, WORD_RESV); return 0; }
+    for (int h = 0; h < m->n_harts; h++) {
+        uint8_t *words = m->hart_words[h];
+        if (words && !(words[w] & WORD_RESV)) { word_mark(words, w, WORD_RESV); fresh = 1; }
+    }
+    return fresh;
+}
+
+static void resv_barrier(void) {
+#ifdef SYS_membarrier
+    if (machine->membarrier) syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    else syscall(SYS_membarrier, MEMBARRIER_CMD_GLOBAL, 0, 0);
+#endif
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static uint32_t lr_reserve(uint32_t addr, uint32_t *word) {
+    machine_t *m = machine; uint32_t w = (addr - RAM_BASE) >> 2;
+    resv_lock();
+    m->resv_addr[hart_id] = addr;
+    int fresh = resv_mark(w);
+    resv_unlock();
+    if (fresh) resv_barrier();
+    resv_lock();
+    uint32_t value = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+    m->resv_seen[hart_id] = m->resv_version[w % RESV_STRIPES]; m->resv_value[hart_id] = value;
+    resv_unlock();
+    return value;
+}
+
+// Devolve 0 se gravou (o rd do sc.w).
+static uint32_t sc_conditional(uint32_t addr, uint32_t *word, uint32_t v) {
+    machine_t *m = machine; uint32_t index = addr - RAM_BASE, expected;
+    resv_lock();
+    expected = m->resv_value[hart_id];
+    int ok = m->resv_addr[hart_id] == addr && m->resv_seen[hart_id] == m->resv_version[(index >> 2) % RESV_STRIPES] &&
+             __atomic_compare_exchange_n(word, &expected, v, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    m->resv_addr[hart_id] = RESV_NONE;
+    if (ok) {
+        if (page_dirty) page_dirty[index >> PAGE_SHIFT] = 1;
+        invalidate_decoded(index, 4);
+    }
+    resv_unlock();
+    return !ok;
+}
+
+static uint32_t amo_host(uint8_t op, uint32_t *word, uint32_t v) {
+    switch (op) {
+        case OP_AMOSWAP_W: return __atomic_exchange_n(word, v, __ATOMIC_SEQ_CST);
+        case OP_AMOADD_W: return __atomic_fetch_add(word, v, __ATOMIC_SEQ_CST);
+        case OP_AMOXOR_W: return __atomic_fetch_xor(word, v, __ATOMIC_SEQ_CST);
+        case OP_AMOAND_W: return __atomic_fetch_and(word, v, __ATOMIC_SEQ_CST);
+        case OP_AMOOR_W: return __atomic_fetch_or(word, v, __ATOMIC_SEQ_CST);
+        default: {
+            uint32_t old = __atomic_load_n(word, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(word, &old, amo_compute(op, old, v), 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {}
+            return old;
+        }
+    }
+}
+
+// Aplica o AMO e registra a escrita como um store (páginas sujas, código e versão da reserva).
+static uint32_t amo_apply(uint8_t op, uint32_t *word, uint32_t v) {
+    uint32_t index = (uint32_t)((uint8_t *)word - memory);
+    int locked = resv_lock_words(index, 4);
+    uint32_t old = amo_host(op, word, v);
+    if (page_dirty) page_dirty[index >> PAGE_SHIFT] = 1;
+    if (icache_words[index >> 2]) invalidate_decoded(index, 4);
+    if (locked) resv_unlock();
+    return old;
+}
+#endif
+
+// fence.i: descarta as instruções pré-decodificadas (e os superblocos e blocos do JIT) deste hart.
+static void icache_flush(void) {
+    madvise(icache, icache_bytes(), MADV_DONTNEED);
+    if (sb_enabled) sb_flush();
+    if (jit_enabled) jit_flush();
+    aot_mark_words();
+    resv_remark();
+}
+
+void wfi_idle(void);
+
+// --- Contadores de desempenho (Zicntr/Zihpm) ---
+// mcycle, minstret e mhpmcounter3..31 não são incrementados: o valor é calculado na leitura a
+// partir da fonte do contador (instret + wfi_skipped, instret ou hpm_events[evento]) mais um
+// deslocamento de 64 bits guardado no csrs[] do próprio contador, então snapshots e a troca de
+// harts não precisam de nada a mais. Escrever um contador, trocar o seu evento ou mudar
+// mcountinhibit só recalcula os deslocamentos; um contador inibido guarda o valor congelado.
+// cycle/time/instret/hpmcounter são cópias só de leitura (escritas ignoradas) e time é o mtime.
+// As funções recebem o estado do hart para servirem também a poxim_get_csr/poxim_set_csr.
+static inline int csr_is_counter(uint32_t a) {
+    return ((a & 0xF60) == CSR_MCYCLE && (a & 0x1F) != 1) || (a & 0xF60) == CSR_CYCLE || (a & ~0x1Fu) == CSR_MCOUNTINHIBIT;
+}
+
+static uint64_t counter_source(const uint32_t *c, uint64_t icount, uint64_t skipped, const uint64_t *events, int i) {
+    if ((c[CSR_MCOUNTINHIBIT] >> i) & 1) return 0;
+    if (i == 0) return icount + skipped;
+    if (i == 2) return icount;
+    uint32_t event = c[CSR_MCOUNTINHIBIT + i];
+    return event < HPM_EVENTS ? events[event] : 0;
+}
+
+static uint64_t counter_get(const uint32_t *c, uint64_t icount, uint64_t skipped, const uint64_t *events, int i) {
+    if (i == 1) return (icount + skipped) / TIMER_DIVIDER;
+    return ((uint64_t)c[CSR_MCYCLEH + i] << 32 | c[CSR_MCYCLE + i]) + counter_source(c, icount, skipped, events, i);
+}
+
+static void counter_set(uint32_t *c, uint64_t icount, uint64_t skipped, const uint64_t *events, int i, uint64_t value) {
+    uint64_t offset = value - counter_source(c, icount, skipped, events, i);
+    c[CSR_MCYCLE + i] = (uint32_t)offset; c[CSR_MCYCLEH + i] = (uint32_t)(offset >> 32);
+}
+
+// Algum contador não inibido conta loads, stores ou desvios tomados?
+static int hpm_selects_insns(const uint32_t *c) {
+    for (int i = 3; i < 32; i++) {
+        uint32_t event = c[CSR_MCOUNTINHIBIT + i];
+        if (!((c[CSR_MCOUNTINHIBIT] >> i) & 1) && event >= HPM_LOADS && event <= HPM_BRANCHES_TAKEN) return 1;
+    }
+    return 0;
+}
+
+static uint32_t counter_csr_get(const uint32_t *c, uint64_t icount, uint64_t skipped, const uint64_t *events, uint32_t a) {
+    if ((a & ~0x1Fu) == CSR_MCOUNTINHIBIT) return c[a];
+    uint64_t v = counter_get(c, icount, skipped, events, a & 0x1F);
+    return (a & 0x80) ? (uint32_t)(v >> 32) : (uint32_t)v;
+}
+
+// Devolve o novo hpm_active do hart.
+static int counter_csr_set(uint32_t *c, uint64_t icount, uint64_t skipped, const uint64_t *events, uint32_t a, uint32_t value) {
+    if ((a & 0xF00) == CSR_CYCLE) return hpm_selects_insns(c);
+    if ((a & ~0x1Fu) == CSR_MCOUNTINHIBIT) {
+        uint64_t values[32];
+        for (int i = 0; i < 32; i++) values[i] = counter_get(c, icount, skipped, events, i);
+        c[a] = (a == CSR_MCOUNTINHIBIT) ? value & ~2u : value;   // o bit 1 (time) não existe
+        for (int i = 0; i < 32; i++) if (i != 1) counter_set(c, icount, skipped, events, i, values[i]);
+        return hpm_selects_insns(c);
+    }
+    int i = a & 0x1F;
+    uint64_t v = counter_get(c, icount, skipped, events, i);
+    v = (a & 0x80) ? (v & 0xFFFFFFFFu) | (uint64_t)value << 32 : (v & ~(uint64_t)0xFFFFFFFFu) | value;
+    counter_set(c, icount, skipped, events, i, v);
+    return hpm_selects_insns(c);
+}
+
+static inline uint32_t csr_read(uint32_t a) { return csr_is_counter(a) ? counter_csr_get(csrs, instret, wfi_skipped, hpm_events, a) : csrs[a]; }
+// A instrução que escreve o contador ainda vai ser retirada: a escrita substitui o incremento dela.
+static inline void csr_write(uint32_t a, uint32_t v) {
+    if (csr_is_counter(a)) hpm_active = counter_csr_set(csrs, instret + 1, wfi_skipped, hpm_events, a, v);
+    else csrs[a] = v;
+}
+
+// Eventos de uma instrução retirada sem trap (só com hpm_active).
+static inline void hpm_count(uint8_t op, int taken) {
+    int c = op_class(op);
+    if (c == CLASS_LOAD) hpm_events[HPM_LOADS]++;
+    else if (c == CLASS_STORE) hpm_events[HPM_STORES]++;
+    else if (c == CLASS_BRANCH && taken) hpm_events[HPM_BRANCHES_TAKEN]++;
+    else if (c == CLASS_ATOMIC) { if (op != OP_SC_W) hpm_events[HPM_LOADS]++; if (op != OP_LR_W) hpm_events[HPM_STORES]++; }
+}
+
+// Execução das instruções e entrada em trap: o núcleo compartilhado com o V1, no perfil V2.
+#include "sidneijunior_202400018369_core.h"
+
+void raise_exception(uint32_t cause, uint32_t tval) {
+    if (trap_occurred) return;
+
+    // Log para igualar o output ideal
+    if (machine->output_file && machine->async) {
+        if (cause & 0x80000000) async_write_irq(machine->async, cause, pc, tval);
+    } else if (machine->output_file) {
+        if (cause & 0x80000000) {
+             fprintf(machine->output_file, ">interrupt:external                   cause=0x%08x,epc=0x%08x,tval=0x%08x\n", cause, pc, tval);
+        }
+    }
+    if (machine->bin_trace_file && (cause & 0x80000000)) bt_write_irq(cause, pc, tval);
+
+    irq_dirty = 1; hpm_events[HPM_TRAPS]++;
+    trap_enter(cause, tval);
+}
+
+void execute_instruction(const decoded_insn_t *d, uint32_t current_pc, FILE *out_file) { execute_insn_body(d, current_pc, out_file, TRACE_TEXT); }
+void execute_instruction_binary(const decoded_insn_t *d, uint32_t current_pc) { execute_insn_body(d, current_pc, NULL, TRACE_BINARY); }
+void execute_instruction_untraced(const decoded_insn_t *d, uint32_t current_pc) { execute_insn_body(d, current_pc, NULL, TRACE_NONE); }
+
+// --- Semihosting ---
+// Com poxim_semihosting, ecall não gera trap: é uma chamada de sistema do newlib/libgloss
+// (número do Linux RISC-V em a7, argumentos em a0..a3, resultado ou -errno do newlib em a0)
+// servida pelo host. Os fds 0 a 2 são a entrada e o console da máquina, os mesmos da UART
+// (write vai inteiro para o console e o terminal.out); open só alcança arquivos abaixo do
+// diretório raiz. O break começa no fim da imagem carregada e não passa do sp.
+#define SEMI_FDS 32
+enum { SEMI_OPENAT = 56, SEMI_CLOSE = 57, SEMI_LSEEK = 62, SEMI_READ = 63, SEMI_WRITE = 64, SEMI_FSTAT = 80,
+       SEMI_EXIT = 93, SEMI_EXIT_GROUP = 94, SEMI_BRK = 214, SEMI_OPEN = 1024 };
+#define SEMI_AT_FDCWD (-100)
+
+struct semihost {
+    int root;              // diretório raiz dos arquivos do guest
+    int fd[SEMI_FDS];      // fd do guest -> fd do host (-1: livre); 0 a 2 não são usados
+    uint32_t brk;          // 0: o guest ainda não consultou
+};
+
+// errno do host -> errno do newlib (iguais até ERANGE).
+static int semi_errno(int e) { return e <= ERANGE ? e : e == ENOSYS ? 88 : e == ENAMETOOLONG ? 91 : e == ELOOP ? 92 : EIO; }
+
+// Trecho [addr, addr + len) da RAM do guest, NULL se sair dela.
+static uint8_t *semi_ram(uint32_t addr, uint32_t len) {
+    uint32_t idx = addr - RAM_BASE;
+    return (addr >= RAM_BASE && idx <= mem_size && len <= mem_size - idx) ? memory + idx : NULL;
+}
+
+// O host escreveu na RAM: páginas sujas e código decodificado, como num store.
+static void semi_written(uint32_t addr, uint32_t len) {
+    if (len == 0) return;
+    uint32_t idx = addr - RAM_BASE;
+    if (page_dirty) memset(page_dirty + (idx >> PAGE_SHIFT), 1, ((idx + len - 1) >> PAGE_SHIFT) - (idx >> PAGE_SHIFT) + 1);
+    resv_lock(); invalidate_decoded(idx, len); resv_unlock();
+}
+
+// Sem openat2 (kernel antigo, ou seccomp que o recusa com EPERM): abre componente por componente a
+// partir da raiz sem seguir nenhum link, já que O_NOFOLLOW sozinho só vale para o último.
+static int semi_open_walk(int root, char *path, int host, int mode) {
+    int dir = root, fd;
+    for (char *c = path; ; ) {
+        size_t len = strcspn(c, "/");
+        if (c[len] == '\0' || c[len + strspn(c + len, "/")] == '\0') {   // último componente (ou "x/")
+            c[len] = '\0';
+            fd = openat(dir, len ? c : ".", host | O_NOFOLLOW, mode & 0777);
+            break;
+        }
+        c[len] = '\0';
+        fd = openat(dir, c, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) break;
+        if (dir != root) close(dir);
+        dir = fd;
+        c += len + 1; c += strspn(c, "/");
+    }
+    int err = errno;
+    if (dir != root) close(dir);
+    return fd < 0 ? -err : fd;
+}
+
+// Caminho relativo sem "..", resolvido sem sair da raiz: RESOLVE_BENEATH ou semi_open_walk.
+static int semi_open(semihost_t *sh, uint32_t path_addr, int32_t flags, int32_t mode) {
+    char path[4096]; size_t n = 0;
+    for (;; n++) {
+        const uint8_t *c = semi_ram(path_addr + n, 1);
+        if (c == NULL) return -EFAULT;
+        if (n == sizeof(path)) return -ENAMETOOLONG;
+        if ((path[n] = *c) == '\0') break;
+    }
+    if (n == 0) return -ENOENT;
+    if (path[0] == '/') return -EACCES;
+    for (const char *c = path; *c; ) {
+        size_t len = strcspn(c, "/");
+        if (len == 2 && c[0] == '.' && c[1] == '.') return -EACCES;
+        c += len; c += strspn(c, "/");
+    }
+    int g = 3;
+    while (g < SEMI_FDS && sh->fd[g] >= 0) g++;
+    if (g == SEMI_FDS) return -EMFILE;
+    // Flags do newlib (sys/_default_fcntl.h).
+    int host = ((flags & 3) == 1 ? O_WRONLY : (flags & 3) == 2 ? O_RDWR : O_RDONLY) | O_CLOEXEC;
+    if (flags & 0x0008) host |= O_APPEND;
+    if (flags & 0x0200) host |= O_CREAT;
+    if (flags & 0x0400) host |= O_TRUNC;
+    if (flags & 0x0800) host |= O_EXCL;
+    int fd = -1;
+#ifdef SYS_openat2
+    struct open_how how = { .flags = host, .mode = (host & O_CREAT) ? (mode & 0777) : 0, .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS };
+    fd = (int)syscall(SYS_openat2, sh->root, path, &how, sizeof(how));
+    if (fd < 0 && errno != ENOSYS && errno != EPERM) return -errno;
+#endif
+    if (fd < 0 && (fd = semi_open_walk(sh->root, path, host, mode)) < 0) return fd;
+    sh->fd[g] = fd;
+    return g;
+}
+
+static int semi_host_fd(semihost_t *sh, int32_t g) { return (g >= 3 && g < SEMI_FDS) ? sh->fd[g] : -1; }
+
+static int64_t semi_read(semihost_t *sh, int32_t g, uint32_t addr, uint32_t len) {
+    uint8_t *buf = semi_ram(addr, len);
+    if (buf == NULL) return -EFAULT;
+    machine_t *m = machine;
+    if (g == 0) {
+        uint32_t done = 0;
+        while (done < len && uart_input_available(m)) {
+            size_t n = m->in_len - m->in_pos; if (n > len - done) n = len - done;
+            memcpy(buf + done, m->in_data + m->in_pos, n); m->in_pos += n; done += n;
+        }
+        semi_written(addr, done);
+        return done;
+    }
+    int fd = semi_host_fd(sh, g);
+    if (fd < 0) return -EBADF;
+    ssize_t n = read(fd, buf, len);
+    if (n < 0) return -errno;
+    semi_written(addr, (uint32_t)n);
+    return n;
+}
+
+static int64_t semi_write(semihost_t *sh, int32_t g, uint32_t addr, uint32_t len) {
+    const uint8_t *buf = semi_ram(addr, len);
+    if (buf == NULL) return -EFAULT;
+    machine_t *m = machine;
+    if (g == 1 || g == 2) {
+        if (m->async) { async_write_text(m->async, buf, len); return len; }
+        if (m->console) fwrite(buf, 1, len, m->console);
+        if (m->terminal_file) fwrite(buf, 1, len, m->terminal_file);
+        return len;
+    }
+    int fd = semi_host_fd(sh, g);
+    if (fd < 0) return -EBADF;
+    ssize_t n = write(fd, buf, len);
+    return n < 0 ? -errno : n;
+}
+
+// struct kernel_stat do libgloss (rv32): dev, ino (8), mode, nlink, uid, gid (4), rdev, pad (8),
+// size (8), blksize, pad (4), blocks (8) e os três timespec, zerados; 128 bytes.
+static int64_t semi_fstat(semihost_t *sh, int32_t g, uint32_t addr) {
+    uint8_t *buf = semi_ram(addr, 128);
+    if (buf == NULL) return -EFAULT;
+    struct stat st;
+    if (g >= 0 && g <= 2) { memset(&st, 0, sizeof(st)); st.st_mode = S_IFCHR | 0620; }
+    else { int fd = semi_host_fd(sh, g); if (fd < 0) return -EBADF; if (fstat(fd, &st) != 0) return -errno; }
+    uint64_t dev = st.st_dev, ino = st.st_ino, rdev = st.st_rdev; int64_t size = st.st_size, blocks = st.st_blocks;
+    uint32_t mode = st.st_mode, nlink = st.st_nlink, uid = st.st_uid, gid = st.st_gid; int32_t blksize = st.st_blksize;
+    memset(buf, 0, 128);
+    memcpy(buf, &dev, 8); memcpy(buf + 8, &ino, 8); memcpy(buf + 16, &mode, 4); memcpy(buf + 20, &nlink, 4);
+    memcpy(buf + 24, &uid, 4); memcpy(buf + 28, &gid, 4); memcpy(buf + 32, &rdev, 8); memcpy(buf + 48, &size, 8);
+    memcpy(buf + 56, &blksize, 4); memcpy(buf + 64, &blocks, 8);
+    semi_written(addr, 128);
+    return 0;
+}
+
+// brk(0) devolve o break; outro valor o move se ficar entre o fim da imagem e o sp (ou o fim da RAM).
+static int64_t semi_brk(semihost_t *sh, uint32_t addr) {
+    machine_t *m = machine;
+    uint32_t start = m->image_end ? (m->image_end + 15) & ~15u : RAM_BASE + mem_size;
+    uint32_t limit = (registers[2] > start && registers[2] - RAM_BASE <= mem_size) ? registers[2] : RAM_BASE + mem_size;
+    if (sh->brk == 0) sh->brk = start;
+    if (addr >= start && addr <= limit) sh->brk = addr;
+    return sh->brk;
+}
+
+int semihost_call(void) {
+    machine_t *m = machine; semihost_t *sh = m->semihost;
+    if (sh == NULL) return 0;
+    uint32_t a0 = registers[10], a1 = registers[11], a2 = registers[12], a3 = registers[13];
+    int64_t r;
+    device_lock();
+    switch (registers[17]) {
+        case SEMI_READ: r = semi_read(sh, (int32_t)a0, a1, a2); break;
+        case SEMI_WRITE: r = semi_write(sh, (int32_t)a0, a1, a2); break;
+        case SEMI_OPEN: r = semi_open(sh, a0, (int32_t)a1, (int32_t)a2); break;
+        case SEMI_OPENAT: r = ((int32_t)a0 == SEMI_AT_FDCWD) ? semi_open(sh, a1, (int32_t)a2, (int32_t)a3) : -EBADF; break;
+        case SEMI_CLOSE: {
+            int fd = semi_host_fd(sh, (int32_t)a0);
+            if (fd >= 0) { close(fd); sh->fd[a0] = -1; r = 0; }
+            else r = ((int32_t)a0 >= 0 && (int32_t)a0 <= 2) ? 0 : -EBADF;
+            break;
+        }
+        case SEMI_LSEEK: {
+            int fd = semi_host_fd(sh, (int32_t)a0);
+            if (fd < 0) { r = ((int32_t)a0 >= 0 && (int32_t)a0 <= 2) ? -ESPIPE : -EBADF; break; }
+            off_t pos = lseek(fd, (int32_t)a1, (int)a2);
+            r = pos < 0 ? -errno : pos > INT32_MAX ? -EOVERFLOW : pos;
+            break;
+        }
+        case SEMI_FSTAT: r = semi_fstat(sh, (int32_t)a0, a1); break;
+        case SEMI_BRK: r = semi_brk(sh, a0); break;
+        case SEMI_EXIT: case SEMI_EXIT_GROUP: m->exit_code = (int32_t)a0; machine_stop_with(m, POXIM_EXIT); r = 0; break;
+        default: r = -ENOSYS; break;
+    }
+    device_unlock();
+    registers[10] = (uint32_t)(r < 0 ? -semi_errno((int)-r) : r);
+    registers[0] = 0;
+    return 1;
+}
+
+static void semihost_free(semihost_t *sh) {
+    if (sh == NULL) return;
+    for (int g = 3; g < SEMI_FDS; g++) if (sh->fd[g] >= 0) close(sh->fd[g]);
+    close(sh->root);
+    free(sh);
+}
+
+int poxim_semihosting(poxim_machine *m, const char *root) {
+    semihost_free(m->semihost); m->semihost = NULL;
+    if (root == NULL) return 1;
+    semihost_t *sh = calloc(1, sizeof(semihost_t));
+    if (sh == NULL) return 0;
+    if ((sh->root = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) { free(sh); return 0; }
+    for (int g = 0; g < SEMI_FDS; g++) sh->fd[g] = -1;
+    m->semihost = sh;
+    return 1;
+}
+
+int poxim_exit_code(const poxim_machine *m) { return m->exit_code; }
+
+// --- Timer e interrupções ---
+// Escalonador por contagem de instruções. mip e a verificação de interrupções só são
+// refeitos quando CSRs, mtimecmp, msip ou a UART mudam (irq_dirty) ou quando instret
+// chega a next_event, o instante em que mtime alcança mtimecmp. Cada hart tem o seu
+// escalonador; escritas no CLINT de outro hart chegam por hart_poke.
+_Thread_local uint64_t next_event = 0;
+
+static void schedule_timer(void) {
+    uint64_t mtimecmp = __atomic_load_n(&machine->clint_mtimecmp[hart_id], __ATOMIC_RELAXED);
+    next_event = (mtime >= mtimecmp || mtimecmp > UINT64_MAX / TIMER_DIVIDER) ? UINT64_MAX : mtimecmp * TIMER_DIVIDER - wfi_skipped;
+    // A chegada de uma rajada na UART também é um evento do hart 0.
+    uint64_t rx_ready = __atomic_load_n(&machine->uart.rx_ready, __ATOMIC_RELAXED);
+    if (hart_id == 0 && rx_ready != UINT64_MAX) {
+        uint64_t at = (rx_ready > instret + wfi_skipped) ? rx_ready - wfi_skipped : instret + 1;
+        if (at < next_event) next_event = at;
+    }
+}
+
+// Mesma lógica que o laço principal executava após cada instrução.
+void update_interrupts(void) {
+    SELFPROF_BEGIN(sp);
+    timer_sync();
+    machine_t *m = machine;
+    __atomic_exchange_n(hart_poke, 0, __ATOMIC_ACQUIRE);
+    int uart_busy = 0;
+
+    if (mtime >= __atomic_load_n(&m->clint_mtimecmp[hart_id], __ATOMIC_RELAXED)) csrs[CSR_MIP] |= 0x80;
+    else csrs[CSR_MIP] &= ~0x80;
+
+    if (__atomic_load_n(&m->clint_msip[hart_id], __ATOMIC_RELAXED) & 0x1) csrs[CSR_MIP] |= 0x08;
+    else csrs[CSR_MIP] &= ~0x08;
+
+    // A UART avança no tempo do hart 0; o meip do PLIC vale para o contexto de cada hart.
+    device_lock();
+    if (hart_id == 0) uart_busy = uart_tick(m);
+    if (m->plic_meip[hart_id]) csrs[CSR_MIP] |= 0x800;
+    else csrs[CSR_MIP] &= ~0x800;
+    device_unlock();
+    
+    uint32_t mstatus = csrs[CSR_MSTATUS];
+    uint32_t mie = csrs[CSR_MIE];
+    uint32_t mip = csrs[CSR_MIP];
+    uint32_t pending = (mstatus & 0x8) ? (mie & mip & 0x888) : 0;
+
+    if (pending) { 
+        if ((mie & 0x800) && (mip & 0x800)) raise_exception(CAUSE_MEI, 0); 
+        else if ((mie & 0x8) && (mip & 0x8)) raise_exception(CAUSE_MSI, 0); 
+        else if ((mie & 0x80) && (mip & 0x80)) raise_exception(CAUSE_MTI, 0); 
+    }
+    // Uma interrupção que não pôde ser tomada (a instrução já gerou trap) fica para a próxima.
+    irq_dirty = uart_busy || pending;
+    schedule_timer();
+    SELFPROF_END(sp, SELFPROF_INTERRUPTS);
+}
+
+// Conta 'retired' instruções. Com retired > 1 (bloco do JIT) o resultado é o mesmo de
+// retirar as instruções uma a uma, pois o bloco só é executado quando nenhuma
+// interrupção pode ficar pendente antes do seu fim.
+static inline void retire_instructions(uint32_t retired) {
+    instret += retired;
+    if (irq_dirty || instret >= next_event || __atomic_load_n(hart_poke, __ATOMIC_RELAXED)) update_interrupts();
+    registers[0] = 0;
+}
+
+// wfi: sem interrupção pendente, o tempo salta direto para o próximo evento agendado
+// (o prazo do timer ou a chegada de entrada na UART). Sem evento que possa acordar o hart,
+// wfi vira nop.
+void wfi_idle(void) {
+    if (irq_dirty || (csrs[CSR_MIE] & csrs[CSR_MIP] & 0x888)) return;
+    uint32_t wake = (csrs[CSR_MIE] & 0x80) || (hart_id == 0 && (csrs[CSR_MIE] & 0x800) && machine->uart.rx_ready != UINT64_MAX);
+    if (!wake || next_event == UINT64_MAX || next_event <= instret + 1) return;
+    wfi_skipped += next_event - (instret + 1);
+    next_event = instret + 1;
+}
+
+// Número de instruções após as quais a próxima interrupção seria tomada, supondo que
+// nenhuma delas acesse CSRs ou MMIO (é o caso dos blocos traduzidos pelo JIT).
+uint64_t instructions_until_interrupt(void) {
+    if (irq_dirty || __atomic_load_n(hart_poke, __ATOMIC_RELAXED)) return 1;
+    if (!(csrs[CSR_MSTATUS] & 0x8)) return UINT64_MAX;
+    uint32_t mie = csrs[CSR_MIE];
+    if (mie & csrs[CSR_MIP] & 0x888) return 1;
+    if (!(mie & 0x880) || next_event == UINT64_MAX) return UINT64_MAX;
+    return next_event - instret;
+}
+
+// --- JIT x86-64 ---
+// Blocos básicos quentes viram código nativo num buffer mmap executável. Os registradores
+// do guest continuam em registers[] (rbx aponta para o vetor), a RAM é acessada direto por
+// r12 e icache_words[] por r13. Os blocos são indexados por meia palavra, como o icache. Tudo que não é ALU, desvio ou acesso alinhado à RAM (CSRs,
+// ecall/ebreak/mret, MMIO, falhas de acesso) sai do bloco e é executado pelo interpretador,
+// então raise_exception/mret e o log de interrupções continuam idênticos.
+// O bloco devolve (instruções retiradas << 32) | próximo pc.
+#if defined(__x86_64__)
+#define JIT_CODE_SIZE  (16 * 1024 * 1024)
+#define JIT_MAX_BLOCK  64
+#define JIT_EXIT_SIZE  16
+#ifndef JIT_HOT_THRESHOLD
+#define JIT_HOT_THRESHOLD 16   // execuções pelo interpretador antes de traduzir o bloco
+#endif
+
+typedef uint64_t (*jit_fn_t)(uint32_t *regs, uint8_t *mem, uint8_t *code_words);
+
+typedef struct {
+    jit_fn_t code;          // NULL: bloco não traduzível (a instrução inicial vai para o interpretador)
+    uint16_t n_insns;       // instruções do bloco; 0 = ainda não traduzido
+    uint16_t hits;          // contador de execuções enquanto não traduzido
+    uint16_t halfwords;     // meias palavras cobertas pelo bloco
+} jit_block_t;
+
+// Com --threads cada thread traduz para o seu próprio buffer (os blocos usam o icache dela).
+_Thread_local int jit_enabled = 0;
+_Thread_local uint8_t *jit_buf = NULL;
+_Thread_local size_t jit_used = 0;
+_Thread_local uint8_t *jit_p;
+_Thread_local jit_block_t *jit_blocks;
+
+enum { EAX = 0, ECX = 1, EDX = 2 };
+
+static void emit8(uint8_t b) { *jit_p++ = b; }
+static void emit32(uint32_t v) { memcpy(jit_p, &v, 4); jit_p += 4; }
+static void emit_bytes(const char *b, int n) { memcpy(jit_p, b, n); jit_p += n; }
+
+// mov r32, [rbx + 4*reg]  /  mov [rbx + 4*reg], r32
+static void emit_load_guest(int host, uint32_t reg) { emit8(0x8B); emit8(0x83 | (host << 3)); emit32(reg * 4); }
+static void emit_store_guest(uint32_t reg, int host) { if (reg == 0) return; emit8(0x89); emit8(0x83 | (host << 3)); emit32(reg * 4); }
+
+// Saída do bloco: rax = (retired << 32) | pc; pop r13; pop r12; pop rbx; ret.
+static void emit_exit(uint32_t retired, uint32_t next_pc) {
+    uint64_t r = ((uint64_t)retired << 32) | next_pc;
+    emit8(0x48); emit8(0xB8); memcpy(jit_p, &r, 8); jit_p += 8;
+    emit_bytes("\x41\x5D\x41\x5C\x5B\xC3", 6);
+}
+
+// Sai do bloco (antes da instrução em 'insn_pc') se a condição 'jcc' NÃO for satisfeita.
+static void emit_guard(uint8_t jcc, uint32_t retired, uint32_t insn_pc) {
+    emit8(0x0F); emit8(jcc); emit32(JIT_EXIT_SIZE);
+    emit_exit(retired, insn_pc);
+}
+
+// eax = endereço - RAM_BASE; sai do bloco se o acesso não couber inteiro na RAM.
+static void emit_ram_index(const decoded_insn_t *d, int size, uint32_t retired, uint32_t insn_pc) {
+    emit_load_guest(EAX, d->rs1);
+    emit8(0x05); emit32((uint32_t)d->imm - RAM_BASE);          // add eax, imm - RAM_BASE
+    emit8(0x3D); emit32(mem_size - size);                       // cmp eax, mem_size - size
+    emit_guard(0x86, retired, insn_pc);                         // jbe ok
+}
+
+// Sai do bloco se a palavra em edx tiver instrução decodificada (escrita em código):
+// o interpretador faz o store e invalida icache[] e os blocos afetados.
+static void emit_code_guard(uint32_t retired, uint32_t insn_pc) {
+    emit_bytes("\xC1\xEA\x02", 3);                              // shr edx, 2
+    emit_bytes("\x41\x80\x7C\x15\x00\x00", 6);                  // cmp byte [r13 + rdx], 0
+    emit_guard(0x84, retired, insn_pc);                         // je ok
+}
+
+// Desvio curto para frente, com o deslocamento corrigido por patch_rel8().
+static uint8_t *emit_jmp8(uint8_t op) { emit8(op); emit8(0); return jit_p - 1; }
+static void patch_rel8(uint8_t *at) { *at = (uint8_t)(jit_p - (at + 1)); }
+
+static void emit_divrem(const decoded_insn_t *d) {
+    int is_rem = (d->op == OP_REM || d->op == OP_REMU);
+    int is_signed = (d->op == OP_DIV || d->op == OP_REM);
+    emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2);
+    emit_bytes("\x85\xC9", 2);                                  // test ecx, ecx
+    uint8_t *nonzero = emit_jmp8(0x75);
+    if (!is_rem) { emit8(0xB8); emit32(0xFFFFFFFF); }           // divisão por zero: -1 (resto: rs1)
+    uint8_t *done1 = emit_jmp8(0xEB);
+    patch_rel8(nonzero);
+    uint8_t *done2 = NULL;
+    if (is_signed) {
+        emit_bytes("\x83\xF9\xFF", 3);                          // cmp ecx, -1
+        uint8_t *normal1 = emit_jmp8(0x75);
+        emit8(0x3D); emit32(0x80000000);                        // cmp eax, INT_MIN
+        uint8_t *normal2 = emit_jmp8(0x75);
+        if (is_rem) emit_bytes("\x31\xC0", 2);                  // overflow: quociente INT_MIN, resto 0
+        done2 = emit_jmp8(0xEB);
+        patch_rel8(normal1); patch_rel8(normal2);
+        emit_bytes("\x99\xF7\xF9", 3);                          // cdq; idiv ecx
+    } else {
+        emit_bytes("\x31\xD2\xF7\xF1", 4);                      // xor edx, edx; div ecx
+    }
+    if (is_rem) emit_bytes("\x89\xD0", 2);                      // mov eax, edx
+    patch_rel8(done1);
+    if (done2) patch_rel8(done2);
+    emit_store_guest(d->rd, EAX);
+}
+
+// Traduz uma instrução. Retorna 0 se ela não é suportada (o bloco termina antes dela),
+// 1 se o bloco continua e 2 se ela encerra o bloco (desvios e saltos).
+static int jit_emit_insn(const decoded_insn_t *d, uint32_t insn_pc, uint32_t k) {
+    static const uint8_t setcc[2] = { 0x9C, 0x92 };             // setl / setb
+    int rd = d->rd;
+    switch (d->op) {
+        case OP_ADDI: case OP_XORI: case OP_ORI: case OP_ANDI: {
+            static const uint8_t alu_imm[] = { [OP_ADDI] = 0x05, [OP_XORI] = 0x35, [OP_ORI] = 0x0D, [OP_ANDI] = 0x25 };
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit8(alu_imm[d->op]); emit32(d->imm); emit_store_guest(rd, EAX);
+            return 1;
+        }
+        case OP_SLLI: case OP_SRLI: case OP_SRAI: {
+            uint8_t ext = (d->op == OP_SLLI) ? 0xE0 : (d->op == OP_SRLI) ? 0xE8 : 0xF8;
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit8(0xC1); emit8(ext); emit8((uint8_t)d->imm); emit_store_guest(rd, EAX);
+            return 1;
+        }
+        case OP_SLTI: case OP_SLTIU:
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit8(0x3D); emit32(d->imm);
+            emit8(0x0F); emit8(setcc[d->op == OP_SLTIU]); emit8(0xC0); emit_bytes("\x0F\xB6\xC0", 3);
+            emit_store_guest(rd, EAX);
+            return 1;
+        case OP_NOP:
+            return 1;
+        case OP_ADD: case OP_SUB: case OP_XOR: case OP_OR: case OP_AND: {
+            static const uint8_t alu[] = { [OP_ADD] = 0x01, [OP_SUB] = 0x29, [OP_XOR] = 0x31, [OP_OR] = 0x09, [OP_AND] = 0x21 };
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2); emit8(alu[d->op]); emit8(0xC8); emit_store_guest(rd, EAX);
+            return 1;
+        }
+        case OP_SLL: case OP_SRL: case OP_SRA: {
+            uint8_t ext = (d->op == OP_SLL) ? 0xE0 : (d->op == OP_SRL) ? 0xE8 : 0xF8;
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2); emit8(0xD3); emit8(ext); emit_store_guest(rd, EAX);
+            return 1;
+        }
+        case OP_SLT: case OP_SLTU:
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2); emit_bytes("\x39\xC8", 2);
+            emit8(0x0F); emit8(setcc[d->op == OP_SLTU]); emit8(0xC0); emit_bytes("\x0F\xB6\xC0", 3);
+            emit_store_guest(rd, EAX);
+            return 1;
+        case OP_MUL:
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2); emit_bytes("\x0F\xAF\xC1", 3); emit_store_guest(rd, EAX);
+            return 1;
+        case OP_MULH: case OP_MULHSU: case OP_MULHU:
+            if (rd == 0) return 1;
+            emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2);
+            if (d->op != OP_MULHU) emit_bytes("\x48\x63\xC0", 3);   // movsxd rax, eax
+            if (d->op == OP_MULH) emit_bytes("\x48\x63\xC9", 3);    // movsxd rcx, ecx
+            emit_bytes("\x48\x0F\xAF\xC1\x48\xC1\xE8\x20", 8);      // imul rax, rcx; shr rax, 32
+            emit_store_guest(rd, EAX);
+            return 1;
+        case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+            if (rd == 0) return 1;
+            emit_divrem(d);
+            return 1;
+        case OP_LUI: case OP_AUIPC:
+            if (rd == 0) return 1;
+            emit8(0xB8); emit32(d->op == OP_LUI ? (uint32_t)d->imm : insn_pc + d->imm); emit_store_guest(rd, EAX);
+            return 1;
+        case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU: {
+            static const char *load_ops[] = { [OP_LB] = "\x41\x0F\xBE\x04\x04", [OP_LH] = "\x41\x0F\xBF\x04\x04", [OP_LW] = "\x41\x8B\x04\x04",
+                                              [OP_LBU] = "\x41\x0F\xB6\x04\x04", [OP_LHU] = "\x41\x0F\xB7\x04\x04" };
+            int size = (d->op == OP_LW) ? 4 : (d->op == OP_LH || d->op == OP_LHU) ? 2 : 1;
+            emit_ram_index(d, size, k, insn_pc);
+            emit_bytes(load_ops[d->op], d->op == OP_LW ? 4 : 5);
+            emit_store_guest(rd, EAX);
+            return 1;
+        }
+        case OP_SB: case OP_SH: case OP_SW: {
+            int size = (d->op == OP_SW) ? 4 : (d->op == OP_SH) ? 2 : 1;
+            emit_ram_index(d, size, k, insn_pc);
+            emit_bytes("\x89\xC2", 2);                              // mov edx, eax
+            emit_code_guard(k, insn_pc);
+            if (size > 1) {
+                emit_bytes("\x89\xC2\x83\xC2", 4); emit8(size - 1); // mov edx, eax; add edx, size-1
+                emit_code_guard(k, insn_pc);
+            }
+            emit_load_guest(ECX, d->rs2);
+            if (size == 4) emit_bytes("\x41\x89\x0C\x04", 4);       // mov [r12 + rax], ecx
+            else if (size == 2) emit_bytes("\x66\x41\x89\x0C\x04", 5);
+            else emit_bytes("\x41\x88\x0C\x04", 4);
+            if (page_dirty) {                                       // marca as páginas do acesso em page_dirty[]
+                emit8(0x48); emit8(0xBA); uint64_t map = (uint64_t)(uintptr_t)page_dirty; memcpy(jit_p, &map, 8); jit_p += 8; // mov rdx, page_dirty
+                emit_bytes("\x8D\x48", 2); emit8(size - 1);       // lea ecx, [rax + size-1]
+                emit_bytes("\xC1\xE8\x0C\xC1\xE9\x0C", 6);      // shr eax, 12; shr ecx, 12
+                emit_bytes("\xC6\x04\x02\x01\xC6\x04\x0A\x01", 8); // mov byte [rdx + rax], 1; mov byte [rdx + rcx], 1
+            }
+            return 1;
+        }
+        case OP_JAL:
+            if (rd != 0) { emit8(0xC7); emit8(0x83); emit32(rd * 4); emit32(insn_pc + insn_length(d->raw)); }
+            emit_exit(k + 1, insn_pc + d->imm);
+            return 2;
+        case OP_JALR:
+            emit_load_guest(EAX, d->rs1); emit8(0x05); emit32(d->imm); emit8(0x25); emit32(~1u);
+            if (rd != 0) { emit8(0xC7); emit8(0x83); emit32(rd * 4); emit32(insn_pc + insn_length(d->raw)); }
+            emit8(0xBA); emit32(k + 1);                             // mov edx, retired
+            emit_bytes("\x48\xC1\xE2\x20\x48\x09\xD0", 7);          // shl rdx, 32; or rax, rdx
+            emit_bytes("\x41\x5D\x41\x5C\x5B\xC3", 6);
+            return 2;
+        case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU: {
+            // jcc para o caso NÃO tomado
+            static const uint8_t not_taken[] = { [OP_BEQ] = 0x85, [OP_BNE] = 0x84, [OP_BLT] = 0x8D, [OP_BGE] = 0x8C, [OP_BLTU] = 0x83, [OP_BGEU] = 0x82 };
+            emit_load_guest(EAX, d->rs1); emit_load_guest(ECX, d->rs2); emit_bytes("\x39\xC8", 2);
+            emit8(0x0F); emit8(not_taken[d->op]); emit32(JIT_EXIT_SIZE);
+            emit_exit(k + 1, insn_pc + d->imm);
+            emit_exit(k + 1, insn_pc + insn_length(d->raw));
+            return 2;
+        }
+        default:
+            return 0;
+    }
+}
+
+void jit_flush(void) {
+    // MADV_DONTNEED devolve as páginas zeradas sem tocar a tabela inteira (até 2 GiB de RAM).
+    madvise(jit_blocks, (size_t)(mem_size / 2) * sizeof(jit_block_t), MADV_DONTNEED);
+    jit_used = 0;
+}
+
+void jit_translate(uint32_t half) {
+    if (jit_used + JIT_MAX_BLOCK * 128 > JIT_CODE_SIZE) jit_flush();
+    jit_p = jit_buf + jit_used;
+    uint8_t *start = jit_p;
+    emit_bytes("\x53\x41\x54\x41\x55", 5);                          // push rbx; push r12; push r13
+    emit_bytes("\x48\x89\xFB\x49\x89\xF4\x49\x89\xD5", 9);          // mov rbx, rdi; mov r12, rsi; mov r13, rdx
+
+    uint32_t k = 0, h = half; int ended = 0;
+    while (k < JIT_MAX_BLOCK && h < mem_size / 2) {
+        decoded_insn_t *d = &icache[h];
+        if (d->op == OP_INVALID && !decode_at(h * 2, d)) break;
+        if (d->raw == 0) break;
+        int r = jit_emit_insn(d, RAM_BASE + h * 2, k);
+        if (r == 0) break;
+        k++; h += insn_length(d->raw) / 2;
+        if (r == 2) { ended = 1; break; }
+    }
+    jit_block_t *b = &jit_blocks[half];
+    if (k == 0) {
+        if (icache[half].op == OP_INVALID) decode_at(half * 2, &icache[half]);
+        b->code = NULL; b->n_insns = 1; b->halfwords = 1;
+        return;
+    }
+    if (!ended) emit_exit(k, RAM_BASE + h * 2);
+    b->code = (jit_fn_t)(void *)start;
+    b->n_insns = k; b->halfwords = h - half;
+    jit_used = (size_t)(jit_p - jit_buf + 15) & ~(size_t)15;
+}
+
+// Descarta os blocos que cobrem alguma meia palavra da palavra 'word' (código sobrescrito).
+void jit_invalidate_word(uint32_t word) {
+    uint32_t last = 2 * word + 1, first = (last >= 2 * JIT_MAX_BLOCK - 1) ? last - (2 * JIT_MAX_BLOCK - 1) : 0;
+    for (uint32_t h = first; h <= last; h++) {
+        if (jit_blocks[h].n_insns != 0 && h + jit_blocks[h].halfwords > 2 * word) {
+            jit_blocks[h].code = NULL; jit_blocks[h].n_insns = 0; jit_blocks[h].hits = 0;
+        }
+    }
+}
+
+int jit_init(void) {
+    jit_buf = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit_buf == MAP_FAILED) { jit_buf = NULL; perror("Erro ao alocar buffer do JIT"); return 0; }
+    jit_blocks = alloc_guest((size_t)(mem_size / 2) * sizeof(jit_block_t), machine->huge_pages);
+    if (jit_blocks == NULL) { perror("Erro ao alocar tabela de blocos do JIT"); return 0; }
+    jit_used = 0;
+    return 1;
+}
+
+void jit_free(void) {
+    if (jit_buf) munmap(jit_buf, JIT_CODE_SIZE);
+    if (jit_blocks) munmap(jit_blocks, (size_t)(mem_size / 2) * sizeof(jit_block_t));
+    jit_buf = NULL; jit_blocks = NULL; jit_enabled = 0;
+}
+
+// Executa o bloco traduzido em pc, se houver um e ele couber antes da próxima interrupção e
+// em 'limit' instruções. Retorna o número de instruções retiradas (0: o interpretador executa
+// a instrução em pc).
+uint32_t jit_run(uint64_t limit) {
+    uint32_t idx = pc - RAM_BASE;
+    if (pc % 2 != 0 || idx > mem_size - 2 || machine->uart.tx_countdown > 0) return 0;
+    jit_block_t *b = &jit_blocks[idx >> 1];
+    if (b->n_insns == 0) {
+        if (++b->hits < JIT_HOT_THRESHOLD) return 0;
+        jit_translate(idx >> 1);
+    }
+    if (b->code == NULL || b->n_insns > limit || b->n_insns > instructions_until_interrupt()) return 0;
+    uint64_t r = b->code(registers, memory, icache_words);
+    pc = (uint32_t)r;
+    return (uint32_t)(r >> 32);
+}
+#else
+_Thread_local int jit_enabled = 0;
+void jit_invalidate_word(uint32_t word) { (void)word; }
+void jit_flush(void) {}
+int jit_init(void) { return 0; }
+void jit_free(void) {}
+#endif
+
+// --- Simulador de cache ---
+// L1I e L1D associativas por conjunto e uma L2 unificada opcional, write-back e write-allocate.
+// Cada conjunto é um vetor de 'ways' entradas de 32 bits com o número da linha e os bits de
+// válida e suja; com LRU e FIFO a via 0 é a mais recente (um acerto em LRU a traz para a frente)
+// e a vítima é a última. O modelo só conta: a execução é a mesma com ou sem ele. A busca de cada
+// instrução e cada acesso de dados à RAM (MMIO não) passam por aqui, no interpretador e nos
+// superblocos; o JIT fica desligado.
+#define CACHE_VALID 1u
+#define CACHE_DIRTY 2u
+enum { CACHE_L1I = 0, CACHE_L1D, CACHE_L2, CACHE_LEVELS };
+enum { CACHE_HIT = 0, CACHE_MISS, CACHE_EVICT };   // CACHE_EVICT: miss que descartou uma linha válida
+
+typedef struct {
+    uint32_t *lines;          // conjuntos x vias: (linha << 2) | CACHE_DIRTY | CACHE_VALID
+    uint32_t ways, set_mask, line_shift;
+    poxim_cache_level cfg;
+    uint64_t accesses, misses, evictions, writebacks;
+} cache_level_t;
+
+// Contagens de cada instrução (por meia palavra da RAM): busca na L1I e dados na L1D. As buscas
+// ficam num vetor à parte, o único escrito a cada instrução executada.
+typedef struct { uint64_t misses, evictions; } cache_count_t;
+typedef struct { cache_count_t fetch, data; uint64_t data_accesses; } cache_pc_t;
+
+struct cache_sim {
+    cache_level_t level[CACHE_LEVELS];
+    int has_l2;
+    uint32_t random;          // xorshift da política aleatória (sempre a mesma sequência)
+    uint32_t fetch_line;      // linha da última busca (a mais recente do seu conjunto na L1I)
+    uint64_t *fetches;
+    cache_pc_t *per_pc;
+};
+
+static int cache_level_init(cache_level_t *l, const poxim_cache_level *cfg) {
+    uint32_t line = cfg->line, ways = cfg->ways;
+    if (line < 4 || (line & (line - 1)) || ways == 0 || cfg->size % ((uint64_t)line * ways) != 0 || cfg->policy < POXIM_CACHE_LRU || cfg->policy > POXIM_CACHE_RANDOM) return 0;
+    uint32_t sets = cfg->size / line / ways;
+    if (sets == 0 || (sets & (sets - 1))) return 0;
+    if ((l->lines = calloc((size_t)sets * ways, sizeof(uint32_t))) == NULL) return 0;
+    l->ways = ways; l->set_mask = sets - 1; l->line_shift = __builtin_ctz(line); l->cfg = *cfg;
+    return 1;
+}
+
+static int cache_access_slow(cache_sim_t *c, cache_level_t *l, uint32_t addr, int write) {
+    uint32_t line = addr >> l->line_shift, key = (line << 2) | CACHE_VALID, dirty = write ? CACHE_DIRTY : 0, w;
+    uint32_t *set = l->lines + (size_t)(line & l->set_mask) * l->ways;
+    cache_level_t *next = (l != &c->level[CACHE_L2] && c->has_l2) ? &c->level[CACHE_L2] : NULL;
+    l->accesses++;
+    for (w = 0; w < l->ways; w++) {
+        if ((set[w] & ~CACHE_DIRTY) != key) continue;
+        uint32_t e = set[w] | dirty;
+        if (l->cfg.policy == POXIM_CACHE_LRU) { for (; w > 0; w--) set[w] = set[w - 1]; set[0] = e; }
+        else set[w] = e;
+        return CACHE_HIT;
+    }
+    l->misses++;
+    if (l->cfg.policy == POXIM_CACHE_RANDOM) {
+        for (w = 0; w < l->ways && (set[w] & CACHE_VALID); w++);
+        if (w == l->ways) { c->random ^= c->random << 13; c->random ^= c->random >> 17; c->random ^= c->random << 5; w = c->random % l->ways; }
+    } else w = l->ways - 1;
+    uint32_t victim = set[w]; int result = CACHE_MISS;
+    if (victim & CACHE_VALID) {
+        l->evictions++; result = CACHE_EVICT;
+        if (victim & CACHE_DIRTY) { l->writebacks++; if (next) cache_access_slow(c, next, (victim >> 2) << l->line_shift, 1); }
+    }
+    if (next) cache_access_slow(c, next, addr, 0);
+    if (l->cfg.policy != POXIM_CACHE_RANDOM) { for (; w > 0; w--) set[w] = set[w - 1]; }
+    set[w] = key | dirty;
+    return result;
+}
+
+// Caminho rápido: a linha já é a mais recente do conjunto (o caso comum nas buscas).
+static inline int cache_access(cache_sim_t *c, cache_level_t *l, uint32_t addr, int write) {
+    uint32_t line = addr >> l->line_shift;
+    uint32_t *first = l->lines + (size_t)(line & l->set_mask) * l->ways;
+    if ((*first & ~CACHE_DIRTY) == ((line << 2) | CACHE_VALID)) { l->accesses++; if (write) *first |= CACHE_DIRTY; return CACHE_HIT; }
+    return cache_access_slow(c, l, addr, write);
+}
+
+// Acesso de 'size' bytes em addr (dois se cruzar uma linha); devolve o pior resultado.
+static inline int cache_touch(cache_sim_t *c, cache_level_t *l, uint32_t addr, uint32_t size, int write) {
+    int r = cache_access(c, l, addr, write);
+    uint32_t last = addr + size - 1;
+    if ((last >> l->line_shift) != (addr >> l->line_shift)) { int r2 = cache_access(c, l, last, write); if (r2 > r) r = r2; }
+    return r;
+}
+
+static inline void cache_count(cache_count_t *n, int r) {
+    if (r != CACHE_HIT) { n->misses++; if (r == CACHE_EVICT) n->evictions++; }
+}
+
+static inline void cache_fetch(cache_sim_t *c, uint32_t pc, uint32_t len) {
+    cache_level_t *l = &c->level[CACHE_L1I];
+    uint32_t h = (pc - RAM_BASE) >> 1, last = (pc + len - 1) >> l->line_shift;
+    c->fetches[h]++;
+    // Na linha da busca anterior o acerto é certo e não muda o estado em nenhuma política.
+    if (last == c->fetch_line && (pc >> l->line_shift) == last) { l->accesses++; return; }
+    cache_count(&c->per_pc[h].fetch, cache_touch(c, l, pc, len, 0));
+    c->fetch_line = last;
+}
+
+static inline void cache_data(cache_sim_t *c, uint32_t pc, uint32_t addr, uint32_t size, int write) {
+    if (addr - RAM_BASE >= mem_size) return;
+    cache_pc_t *n = &c->per_pc[(pc - RAM_BASE) >> 1];
+    n->data_accesses++;
+    cache_count(&n->data, cache_touch(c, &c->level[CACHE_L1D], addr, size, write));
+}
+
+// Endereço de dados da instrução, lido antes de executá-la (o load pode sobrescrever rs1).
+static inline uint32_t cache_data_addr(const decoded_insn_t *d) {
+    int c = op_class(d->op);
+    return (c == CLASS_LOAD || c == CLASS_STORE) ? registers[d->rs1] + d->imm : registers[d->rs1];
+}
+
+// Busca e acesso de dados de uma instrução executada pelo interpretador. Uma instrução que
+// gerou trap foi buscada mas não acessou a memória.
+static void cache_insn(cache_sim_t *c, uint8_t op, uint32_t pc, uint32_t len, uint32_t addr) {
+    cache_fetch(c, pc, len);
+    if (trap_occurred) return;
+    switch (op_class(op)) {
+        case CLASS_LOAD: cache_data(c, pc, addr, (op == OP_LW) ? 4 : (op == OP_LH || op == OP_LHU) ? 2 : 1, 0); break;
+        case CLASS_STORE: cache_data(c, pc, addr, (op == OP_SW) ? 4 : (op == OP_SH) ? 2 : 1, 1); break;
+        case CLASS_ATOMIC: cache_data(c, pc, addr, 4, op != OP_LR_W); break;
+    }
+}
+
+static void cache_sim_free(cache_sim_t *c, uint32_t ram_size) {
+    if (c == NULL) return;
+    for (int i = 0; i < CACHE_LEVELS; i++) free(c->level[i].lines);
+    if (c->fetches) munmap(c->fetches, (size_t)(ram_size / 2) * sizeof(uint64_t));
+    if (c->per_pc) munmap(c->per_pc, (size_t)(ram_size / 2) * sizeof(cache_pc_t));
+    free(c);
+}
+
+int poxim_cache(poxim_machine *m, const poxim_cache_config *cfg) {
+    cache_sim_free(m->cache, m->mem_size); m->cache = NULL;
+    if (cfg == NULL) return 1;
+    if (m->hart_threads) return 0;
+    cache_sim_t *c = calloc(1, sizeof(cache_sim_t));
+    if (c == NULL) return 0;
+    c->random = 2463534242u; c->fetch_line = UINT32_MAX; c->has_l2 = cfg->l2.size != 0;
+    if (!cache_level_init(&c->level[CACHE_L1I], &cfg->l1i) || !cache_level_init(&c->level[CACHE_L1D], &cfg->l1d) ||
+        (c->has_l2 && !cache_level_init(&c->level[CACHE_L2], &cfg->l2)) ||
+        (c->fetches = alloc_guest((size_t)(m->mem_size / 2) * sizeof(uint64_t), 0)) == NULL ||
+        (c->per_pc = alloc_guest((size_t)(m->mem_size / 2) * sizeof(cache_pc_t), 0)) == NULL) { cache_sim_free(c, m->mem_size); return 0; }
+    m->cache = c;
+    return 1;
+}
+
+// --- Modelo de tempo ---
+// Pipeline clássico de 5 estágios (IF, ID, EX, MEM, WB) com forwarding: cada instrução custa um
+// ciclo mais as bolhas que causa. As bolhas entram em wfi_skipped, então mtime, mcycle e a UART
+// seguem os ciclos do modelo. As penalidades vêm do estágio em que cada desvio se resolve:
+// o destino de jal e de um desvio condicional é calculado em ID (uma bolha quando tomado), a
+// condição e o jalr em EX (duas: IF e ID descartados). Exceções e mret esvaziam o pipeline como
+// um jalr. mul e div ocupam EX pela latência configurada.
+#define TIMING_LOAD_USE 1
+#define TIMING_ID_REDIRECT 1
+#define TIMING_EX_REDIRECT 2
+enum { STALL_LOAD_USE = 0, STALL_MUL, STALL_DIV, STALL_MISPREDICT, STALL_TAKEN, STALL_JAL, STALL_JALR, STALL_TRAP, STALL_CAUSES };
+
+typedef struct {
+    uint8_t load_rd;          // rd do load da instrução anterior (0: nenhum)
+    uint32_t history;         // histórico global de desvios (gshare)
+    uint8_t *counters;        // contadores de 2 bits do preditor
+} timing_hart_t;
+
+struct timing_model {
+    poxim_timing_config cfg;
+    uint32_t mask;
+    uint64_t insns, branches, mispredicts, stalls[STALL_CAUSES];
+    timing_hart_t hart[MAX_HARTS];
+};
+
+// Registradores lidos em EX. O dado de um store só é usado em MEM e chega por forwarding.
+static inline int timing_reads(uint8_t op, uint32_t reg, const decoded_insn_t *d) {
+    int c = op_class(op);
+    int rs1 = !(op == OP_LUI || op == OP_AUIPC || op == OP_JAL || op == OP_NOP || (op >= OP_CSRRWI && op <= OP_CSRRCI) || c == CLASS_SYSTEM || c == CLASS_INVALID);
+    int rs2 = (op >= OP_ADD && op <= OP_SRA) || c == CLASS_MULDIV || c == CLASS_BRANCH || (c == CLASS_ATOMIC && op != OP_LR_W);
+    return (rs1 && d->rs1 == reg) || (rs2 && d->rs2 == reg);
+}
+
+// Prediz o desvio em pc e treina o preditor com o resultado.
+static int timing_predict(timing_model_t *t, timing_hart_t *h, uint32_t pc, int32_t imm, int taken) {
+    if (t->cfg.predictor == POXIM_PREDICT_STATIC) return imm < 0;   // para trás tomado, para frente não
+    uint32_t index = (pc >> 1) & t->mask;
+    if (t->cfg.predictor == POXIM_PREDICT_GSHARE) { index = ((pc >> 1) ^ h->history) & t->mask; h->history = (h->history << 1) | taken; }
+    uint8_t *c = &h->counters[index];
+    int predicted = *c >= 2;
+    if (taken && *c < 3) (*c)++;
+    else if (!taken && *c > 0) (*c)--;
+    return predicted;
+}
+
+// Bolhas da instrução que acabou de executar (taken: o pc não seguiu para a próxima).
+static uint32_t timing_insn(timing_model_t *t, const decoded_insn_t *d, uint8_t op, uint32_t pc, int taken) {
+    timing_hart_t *h = &t->hart[hart_id];
+    uint32_t load_use = (h->load_rd && timing_reads(op, h->load_rd, d)) ? TIMING_LOAD_USE : 0, stall = 0;
+    int c = op_class(op), cause = STALL_TRAP;
+    t->insns++; t->stalls[STALL_LOAD_USE] += load_use;
+    h->load_rd = 0;
+    if (trap_occurred || op == OP_MRET) stall = TIMING_EX_REDIRECT;
+    else if (c == CLASS_MULDIV) { cause = op >= OP_DIV ? STALL_DIV : STALL_MUL; stall = (op >= OP_DIV ? t->cfg.div_latency : t->cfg.mul_latency) - 1; }
+    else if (c == CLASS_BRANCH) {
+        t->branches++;
+        if (timing_predict(t, h, pc, d->imm, taken) != taken) { t->mispredicts++; cause = STALL_MISPREDICT; stall = TIMING_EX_REDIRECT; }
+        else if (taken) { cause = STALL_TAKEN; stall = TIMING_ID_REDIRECT; }
+    }
+    else if (op == OP_JAL) { cause = STALL_JAL; stall = TIMING_ID_REDIRECT; }
+    else if (op == OP_JALR) { cause = STALL_JALR; stall = TIMING_EX_REDIRECT; }
+    else if (!trap_occurred && (c == CLASS_LOAD || (c == CLASS_ATOMIC && op != OP_SC_W))) h->load_rd = d->rd;
+    t->stalls[cause] += stall;
+    return load_use + stall;
+}
+
+static void timing_model_free(timing_model_t *t) {
+    if (t == NULL) return;
+    for (int i = 0; i < MAX_HARTS; i++) free(t->hart[i].counters);
+    free(t);
+}
+
+int poxim_timing(poxim_machine *m, const poxim_timing_config *cfg) {
+    timing_model_free(m->timing); m->timing = NULL;
+    if (cfg == NULL) return 1;
+    if (m->hart_threads || cfg->predictor < POXIM_PREDICT_STATIC || cfg->predictor > POXIM_PREDICT_GSHARE ||
+        cfg->table_bits < 1 || cfg->table_bits > 24 || cfg->mul_latency < 1 || cfg->div_latency < 1) return 0;
+    timing_model_t *t = calloc(1, sizeof(timing_model_t));
+    if (t == NULL) return 0;
+    t->cfg = *cfg; t->mask = (1u << cfg->table_bits) - 1;
+    for (int i = 0; i < m->n_harts; i++) {
+        if ((t->hart[i].counters = malloc((size_t)1 << cfg->table_bits)) == NULL) { timing_model_free(t); return 0; }
+        memset(t->hart[i].counters, 2, (size_t)1 << cfg->table_bits);   // fracamente tomado
+    }
+    m->timing = t;
+    return 1;
+}
+
+// --- Superblocos ---
+// Sem trace o interpretador executa superblocos: as instruções já decodificadas a partir de
+// um pc, seguindo pelos desvios não tomados, até um salto ou uma instrução que precise do laço
+// principal (CSRs, ecall/ebreak/mret/wfi, fences, atômicas). Loads e stores rodam no bloco
+// quando são alinhados e caem na RAM; MMIO, acesso desalinhado ou store numa palavra marcada
+// (código ou reserva do lr.w) saem do bloco antes da instrução, que fica para o interpretador.
+// Pares comuns viram um macro-op: lui+addi, auipc+jalr, slli+add (cálculo de endereço) e uma
+// operação da ALU seguida do desvio que lê o resultado (slt+bnez, addi+blt). Cada saída guarda
+// o bloco de destino (link), então um laço passa de um bloco ao seguinte sem voltar ao laço
+// principal. Como no JIT, as interrupções só são verificadas entre chamadas de sb_run: um bloco
+// só é executado se todas as suas instruções couberem antes da próxima interrupção possível.
+#define SB_MAX_OPS    64
+#define SB_MAX_SPAN   (SB_MAX_OPS * 4)       // meias palavras que um bloco pode cobrir (64 pares de 32 bits)
+#define SB_ARENA_SIZE (8 * 1024 * 1024)
+#define SB_CHAIN_MAX  (1u << 20)             // instruções por chamada de sb_run
+
+// Macro-ops (depois dos OP_* em sb_op_t.kind).
+enum { SB_LUI_ADDI = OP_UNKNOWN + 1, SB_AUIPC_JALR, SB_SLLI_ADD, SB_ALU_BRANCH };
+
+typedef struct sb_block sb_block_t;
+
+// Uma instrução do bloco ou um macro-op (op1/rd..imm: primeira instrução, op2/rd2..imm2: segunda).
+typedef struct {
+    uint8_t kind, op1, op2, insns;
+    uint8_t rd, rs1, rs2, rd2, rs3, rs4;
+    uint16_t before;                 // instruções do bloco antes deste op
+    int32_t imm, imm2;
+    uint32_t pc, next_pc, target;    // target: destino de desvio/salto direto
+    sb_block_t *link;                // bloco em target (ou no último destino de um jalr)
+} sb_op_t;
+
+struct sb_block {
+    uint32_t pc, end_pc;             // end_pc: continuação quando o bloco termina sem salto
+    uint16_t n_ops, insns, halfwords, valid;
+    sb_block_t *link;                // bloco em end_pc
+    sb_op_t ops[];
+};
+
+_Thread_local int sb_enabled = 0;
+_Thread_local uint8_t *sb_arena;
+_Thread_local size_t sb_used;
+_Thread_local sb_block_t **sb_table;  // uma entrada por meia palavra da RAM
+_Thread_local uint32_t sb_generation; // muda a cada sb_flush (os links antigos deixam de valer)
+
+static int sb_supported(uint8_t op) {
+    return (op >= OP_ADDI && op <= OP_REMU) || (op >= OP_JAL && op <= OP_SW);
+}
+static inline int sb_imm_operand(uint8_t op) { return op <= OP_ANDI; }
+
+static inline uint32_t sb_alu(uint8_t op, uint32_t a, uint32_t b) {
+    switch (op) {
+        case OP_ADDI: case OP_ADD: return a + b;
+        case OP_SLLI: case OP_SLL: return a << (b & 31);
+        case OP_SLTI: case OP_SLT: return (int32_t)a < (int32_t)b;
+        case OP_SLTIU: case OP_SLTU: return a < b;
+        case OP_XORI: case OP_XOR: return a ^ b;
+        case OP_SRLI: case OP_SRL: return a >> (b & 31);
+        case OP_SRAI: case OP_SRA: return (uint32_t)((int32_t)a >> (b & 31));
+        case OP_ORI: case OP_OR: return a | b;
+        case OP_ANDI: case OP_AND: return a & b;
+        case OP_SUB: return a - b;
+        case OP_MUL: return a * b;
+        case OP_MULH: return (uint32_t)(((int64_t)(int32_t)a * (int64_t)(int32_t)b) >> 32);
+        case OP_MULHSU: return (uint32_t)(((int64_t)(int32_t)a * (int64_t)(uint64_t)b) >> 32);
+        case OP_MULHU: return (uint32_t)(((uint64_t)a * b) >> 32);
+        case OP_DIV: return b == 0 ? 0xFFFFFFFF : (a == 0x80000000 && b == 0xFFFFFFFF) ? a : (uint32_t)((int32_t)a / (int32_t)b);
+        case OP_DIVU: return b == 0 ? 0xFFFFFFFF : a / b;
+        case OP_REM: return b == 0 ? a : (a == 0x80000000 && b == 0xFFFFFFFF) ? 0 : (uint32_t)((int32_t)a % (int32_t)b);
+        case OP_REMU: return b == 0 ? a : a % b;
+        default: return 0;
+    }
+}
+
+static inline int sb_cond(uint8_t op, uint32_t a, uint32_t b) {
+    switch (op) {
+        case OP_BEQ: return a == b;
+        case OP_BNE: return a != b;
+        case OP_BLT: return (int32_t)a < (int32_t)b;
+        case OP_BGE: return (int32_t)a >= (int32_t)b;
+        case OP_BLTU: return a < b;
+        default: return a >= b;
+    }
+}
+
+// Endereço do host para um acesso alinhado à RAM (NULL: o interpretador faz o acesso).
+static inline uint8_t *sb_host(uint32_t addr, int size) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint8_t *host = page_host[addr >> PAGE_SHIFT];
+    if (host == NULL || (addr & (size - 1))) return NULL;
+    return host + (addr & ((1u << PAGE_SHIFT) - 1));
+#else
+    (void)addr; (void)size; return NULL;
+#endif
+}
+
+void sb_flush(void) {
+    madvise(sb_table, (size_t)(mem_size / 2) * sizeof(sb_block_t *), MADV_DONTNEED);
+    sb_used = 0; sb_generation++;
+}
+
+// Decodifica (se preciso) a instrução na meia palavra h; NULL se ela não pode entrar num bloco.
+static const decoded_insn_t *sb_insn(uint32_t h) {
+    if (h >= mem_size / 2) return NULL;
+    decoded_insn_t *d = &icache[h];
+    if (d->op == OP_INVALID && !decode_at(h * 2, d)) return NULL;
+    return (d->raw != 0 && sb_supported(d->op)) ? d : NULL;
+}
+
+// Tenta fundir d (já em o) com a instrução seguinte e2; devolve o macro-op ou 0.
+static uint8_t sb_fuse(const decoded_insn_t *d, const decoded_insn_t *e) {
+    if (e == NULL || d->rd == 0) return 0;
+    if (d->op == OP_LUI && e->op == OP_ADDI && e->rs1 == d->rd) return SB_LUI_ADDI;
+    if (d->op == OP_AUIPC && e->op == OP_JALR && e->rs1 == d->rd) return SB_AUIPC_JALR;
+    if (d->op == OP_SLLI && e->op == OP_ADD && (e->rs1 == d->rd || e->rs2 == d->rd)) return SB_SLLI_ADD;
+    if (((d->op >= OP_ADDI && d->op <= OP_ANDI) || (d->op >= OP_ADD && d->op <= OP_SRA)) && e->op >= OP_BEQ && e->op <= OP_BGEU && (e->rs1 == d->rd || e->rs2 == d->rd)) return SB_ALU_BRANCH;
+    return 0;
+}
+
+static sb_block_t *sb_build(uint32_t half) {
+    if (sb_used + sizeof(sb_block_t) + SB_MAX_OPS * sizeof(sb_op_t) > SB_ARENA_SIZE) sb_flush();
+    sb_block_t *b = (sb_block_t *)(sb_arena + sb_used);
+    uint32_t h = half, insns = 0; int n = 0;
+    const decoded_insn_t *d = sb_insn(h);
+    while (d && n < SB_MAX_OPS) {
+        sb_op_t *o = &b->ops[n++];
+        uint32_t op_pc = RAM_BASE + h * 2;
+        h += insn_length(d->raw) / 2;
+        const decoded_insn_t *e = sb_insn(h);
+        uint8_t fused = sb_fuse(d, e);
+        *o = (sb_op_t){ .kind = d->op, .op1 = d->op, .insns = 1, .rd = d->rd, .rs1 = d->rs1, .rs2 = d->rs2, .before = insns, .imm = d->imm, .pc = op_pc, .target = op_pc + d->imm };
+        if (fused) {
+            o->kind = fused; o->op2 = e->op; o->insns = 2; o->rd2 = e->rd; o->rs3 = e->rs1; o->rs4 = e->rs2; o->imm2 = e->imm;
+            o->target = (fused == SB_AUIPC_JALR) ? (op_pc + d->imm + e->imm) & ~1u : RAM_BASE + h * 2 + e->imm;
+            h += insn_length(e->raw) / 2;
+            e = sb_insn(h);
+        }
+        o->next_pc = RAM_BASE + h * 2;
+        insns += o->insns;
+        if (o->kind == OP_JAL || o->kind == OP_JALR || o->kind == SB_AUIPC_JALR) break;
+        d = e;
+    }
+    b->pc = RAM_BASE + half * 2; b->end_pc = RAM_BASE + h * 2; b->link = NULL;
+    b->n_ops = n; b->insns = insns; b->halfwords = n ? h - half : 1; b->valid = 1;
+    sb_used += (sizeof(sb_block_t) + n * sizeof(sb_op_t) + 15) & ~(size_t)15;
+    sb_table[half] = b;
+    return b;
+}
+
+// Bloco em 'at' (construído na primeira vez); NULL fora da RAM.
+static inline sb_block_t *sb_lookup(uint32_t at) {
+    uint32_t idx = at - RAM_BASE;
+    if (at % 2 != 0 || idx > mem_size - 2) return NULL;
+    sb_block_t *b = sb_table[idx >> 1];
+    return (b && b->valid) ? b : sb_build(idx >> 1);
+}
+
+// Descarta os blocos que cobrem alguma meia palavra da palavra 'word' (código sobrescrito).
+void sb_invalidate_word(uint32_t word) {
+    uint32_t last = 2 * word + 1, first = (last >= SB_MAX_SPAN) ? last - SB_MAX_SPAN : 0;
+    for (uint32_t h = first; h <= last; h++) {
+        sb_block_t *b = sb_table[h];
+        if (b && h + b->halfwords > 2 * word) { b->valid = 0; sb_table[h] = NULL; }
+    }
+}
+
+int sb_init(void) {
+    sb_arena = alloc_guest(SB_ARENA_SIZE, 0);
+    sb_table = alloc_guest((size_t)(mem_size / 2) * sizeof(sb_block_t *), machine->huge_pages);
+    if (sb_arena == NULL || sb_table == NULL) { perror("Erro ao alocar os superblocos"); return 0; }
+    sb_used = 0;
+    return 1;
+}
+
+void sb_free(void) {
+    if (sb_arena) munmap(sb_arena, SB_ARENA_SIZE);
+    if (sb_table) munmap(sb_table, (size_t)(mem_size / 2) * sizeof(sb_block_t *));
+    sb_arena = NULL; sb_table = NULL; sb_enabled = 0;
+}
+
+#define SB_WRITE(r, v) do { uint32_t v_ = (v); if (r) regs[r] = v_; } while (0)
+
+// Busca das instruções de um op no simulador de cache (as duas de um macro-op).
+static inline void sb_cache_fetch(cache_sim_t *c, const sb_op_t *o) {
+    if (o->insns == 1) { cache_fetch(c, o->pc, o->next_pc - o->pc); return; }
+    uint32_t len = insn_length(icache[(o->pc - RAM_BASE) >> 1].raw);
+    cache_fetch(c, o->pc, len);
+    cache_fetch(c, o->pc + len, o->next_pc - o->pc - len);
+}
+
+// 'cached' é constante em cada cópia: sem simulador de cache o caminho não tem nenhum teste a mais.
+// Loads e stores só contam a busca depois de saber que o bloco não sai antes deles.
+static inline __attribute__((always_inline)) uint32_t sb_run_body(uint64_t limit, cache_sim_t *cache, const int cached) {
+    if (machine->uart.tx_countdown > 0) return 0;
+    uint64_t budget = instructions_until_interrupt();
+    if (budget > limit) budget = limit;
+    if (budget > SB_CHAIN_MAX) budget = SB_CHAIN_MAX;
+    uint32_t *regs = registers, retired = 0;
+    sb_block_t *b = sb_lookup(pc);
+    while (b && b->n_ops && b->insns <= budget - retired) {
+        sb_block_t **slot = &b->link;
+        sb_op_t *o = b->ops, *end = o + b->n_ops;
+        uint32_t next = b->end_pc, done = b->insns;
+        for (; o < end; o++) {
+            if (cached && (o->kind < OP_LB || o->kind > OP_SW)) sb_cache_fetch(cache, o);
+            switch (o->kind) {
+                case OP_ADDI: SB_WRITE(o->rd, regs[o->rs1] + o->imm); break;
+                case OP_ADD: SB_WRITE(o->rd, regs[o->rs1] + regs[o->rs2]); break;
+                case OP_SLTI: case OP_SLTIU: case OP_XORI: case OP_ORI: case OP_ANDI: case OP_SLLI: case OP_SRLI: case OP_SRAI:
+                    SB_WRITE(o->rd, sb_alu(o->kind, regs[o->rs1], o->imm)); break;
+                case OP_SLL: case OP_SLT: case OP_SLTU: case OP_XOR: case OP_SRL: case OP_OR: case OP_AND: case OP_SUB: case OP_SRA:
+                case OP_MUL: case OP_MULH: case OP_MULHSU: case OP_MULHU: case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+                    SB_WRITE(o->rd, sb_alu(o->kind, regs[o->rs1], regs[o->rs2])); break;
+                case OP_NOP: break;
+                case OP_LUI: SB_WRITE(o->rd, o->imm); break;
+                case OP_AUIPC: SB_WRITE(o->rd, o->pc + o->imm); break;
+                case OP_LB: case OP_LBU: case OP_LH: case OP_LHU: case OP_LW: {
+                    int size = (o->kind == OP_LW) ? 4 : (o->kind == OP_LH || o->kind == OP_LHU) ? 2 : 1;
+                    uint8_t *host = sb_host(regs[o->rs1] + o->imm, size);
+                    if (host == NULL) { next = o->pc; done = o->before; slot = NULL; goto block_exit; }
+                    if (cached) { sb_cache_fetch(cache, o); cache_data(cache, o->pc, regs[o->rs1] + o->imm, size, 0); }
+                    uint32_t v;
+                    switch (o->kind) {
+                        case OP_LW: memcpy(&v, host, 4); break;
+                        case OP_LH: { int16_t x; memcpy(&x, host, 2); v = (uint32_t)(int32_t)x; break; }
+                        case OP_LHU: { uint16_t x; memcpy(&x, host, 2); v = x; break; }
+                        case OP_LB: v = (uint32_t)(int32_t)(int8_t)*host; break;
+                        default: v = *host; break;
+                    }
+                    SB_WRITE(o->rd, v);
+                    break;
+                }
+                case OP_SB: case OP_SH: case OP_SW: {
+                    int size = (o->kind == OP_SW) ? 4 : (o->kind == OP_SH) ? 2 : 1;
+                    uint8_t *host = sb_host(regs[o->rs1] + o->imm, size);
+                    uint32_t index = host ? (uint32_t)(host - memory) : 0;
+                    if (host == NULL || icache_words[index >> 2]) { next = o->pc; done = o->before; slot = NULL; goto block_exit; }
+                    if (cached) { sb_cache_fetch(cache, o); cache_data(cache, o->pc, regs[o->rs1] + o->imm, size, 1); }
+                    uint32_t v = regs[o->rs2];
+                    if (size == 4) memcpy(host, &v, 4);
+                    else if (size == 2) { uint16_t x = (uint16_t)v; memcpy(host, &x, 2); }
+                    else *host = (uint8_t)v;
+                    if (page_dirty) page_dirty[index >> PAGE_SHIFT] = 1;
+                    break;
+                }
+                case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+                    if (sb_cond(o->kind, regs[o->rs1], regs[o->rs2])) goto taken;
+                    break;
+                case OP_JAL: SB_WRITE(o->rd, o->next_pc); goto taken;
+                case OP_JALR: { uint32_t t = (regs[o->rs1] + o->imm) & ~1u; SB_WRITE(o->rd, o->next_pc); next = t; done = o->before + 1; slot = &o->link; goto block_exit; }
+                case SB_LUI_ADDI: SB_WRITE(o->rd, o->imm); SB_WRITE(o->rd2, regs[o->rs3] + o->imm2); break;
+                case SB_AUIPC_JALR: SB_WRITE(o->rd, o->pc + o->imm); SB_WRITE(o->rd2, o->next_pc); goto taken;
+                case SB_SLLI_ADD: SB_WRITE(o->rd, regs[o->rs1] << (o->imm & 31)); SB_WRITE(o->rd2, regs[o->rs3] + regs[o->rs4]); break;
+                case SB_ALU_BRANCH:
+                    SB_WRITE(o->rd, sb_alu(o->op1, regs[o->rs1], sb_imm_operand(o->op1) ? (uint32_t)o->imm : regs[o->rs2]));
+                    if (sb_cond(o->op2, regs[o->rs3], regs[o->rs4])) goto taken;
+                    break;
+            }
+            continue;
+        taken:
+            next = o->target; done = o->before + o->insns; slot = &o->link;
+            break;
+        }
+    block_exit:
+        pc = next; retired += done;
+        if (slot == NULL) break;
+        sb_block_t *n = *slot;
+        if (n == NULL || !n->valid || n->pc != next) {
+            uint32_t generation = sb_generation;
+            n = sb_lookup(next);
+            if (generation == sb_generation) *slot = n;   // depois de um sb_flush 'slot' não existe mais
+        }
+        b = n;
+    }
+    return retired;
+}
+
+// Executa a cadeia de superblocos a partir de pc, sem passar de 'limit' instruções nem da
+// próxima interrupção possível. Retorna o número de instruções retiradas (0: o interpretador
+// executa a instrução em pc).
+uint32_t sb_run(uint64_t limit) {
+    cache_sim_t *cache = machine->cache;
+    return cache ? sb_run_body(limit, cache, 1) : sb_run_body(limit, NULL, 0);
+}
+
+// --- Blocos do poxim-aot ---
+// O poxim-aot traduz um programa para C, com uma função por bloco básico, e o executável gerado
+// registra os blocos com poxim_aot. Eles rodam como os superblocos: em cadeia, sem passar da
+// próxima interrupção possível, e saindo antes de um acesso que não seja à RAM alinhada (o
+// interpretador faz o acesso pelo barramento). As palavras dos blocos ficam marcadas em
+// icache_words, então um store no código (por qualquer caminho) passa por invalidate_decoded,
+// que desliga os blocos que cobrem a palavra; dali em diante o código novo é interpretado.
+static inline const poxim_aot_block *aot_lookup(uint32_t at) {
+    uint32_t idx = at - RAM_BASE;
+    if (at % 2 != 0 || idx > mem_size - 2) return NULL;
+    return __atomic_load_n(&machine->aot_table[idx >> 1], __ATOMIC_RELAXED);
+}
+
+void aot_mark_words(void) {
+    machine_t *m = machine;
+    if (m->aot_table == NULL || icache_words == NULL) return;
+    for (uint32_t i = 0; i < m->aot->n_blocks; i++) {
+        const poxim_aot_block *b = &m->aot->blocks[i];
+        if (aot_lookup(b->pc) != b) continue;
+        for (uint32_t w = (b->pc - RAM_BASE) >> 2; w <= (b->end - 1 - RAM_BASE) >> 2; w++) word_mark(icache_words, w, WORD_CODE);
+    }
+}
+
+void aot_invalidate_word(uint32_t word) {
+    machine_t *m = machine;
+    for (uint32_t i = 0; i < m->aot->n_blocks; i++) {
+        const poxim_aot_block *b = &m->aot->blocks[i];
+        if (b->pc - RAM_BASE < word * 4 + 4 && b->end - RAM_BASE > word * 4) __atomic_store_n(&m->aot_table[(b->pc - RAM_BASE) >> 1], NULL, __ATOMIC_RELAXED);
+    }
+}
+
+static void aot_drop(machine_t *m) {
+    if (m->aot_table) munmap(m->aot_table, (size_t)(m->mem_size / 2) * sizeof(poxim_aot_block *));
+    m->aot_table = NULL; m->aot = NULL;
+}
+
+// Executa a cadeia de blocos a partir de pc, com os mesmos limites de sb_run.
+uint32_t aot_run(uint64_t limit) {
+    if (machine->uart.tx_countdown > 0) return 0;
+    uint64_t budget = instructions_until_interrupt();
+    if (budget > limit) budget = limit;
+    if (budget > SB_CHAIN_MAX) budget = SB_CHAIN_MAX;
+    poxim_aot_ctx ctx = { registers, memory, mem_size, icache_words, page_dirty };
+    uint32_t retired = 0;
+    const poxim_aot_block *b = aot_lookup(pc);
+    while (b && b->insns <= budget - retired) {
+        uint32_t done = 0;
+        pc = b->fn(&ctx, &done);
+        retired += done;
+        if (done == 0) break;   // saída antes da primeira instrução: fica para o interpretador
+        b = aot_lookup(pc);
+    }
+    return retired;
+}
+
+// --- Carregador de programas ---
+// O arquivo é mapeado inteiro (mmap) e o formato sai do conteúdo: ELF32 RISC-V (segmentos
+// PT_LOAD, pc = e_entry), imagem crua .bin (em --load-addr, pc = endereço de carga) ou o
+// texto .hex com linhas "@endereço" seguidas de bytes em hexadecimal.
+#ifndef EM_RISCV
+#define EM_RISCV 243
+#endif
+#define LOADER_MAP_MIN (64 * 1024)   // trechos menores são copiados em vez de mapeados
+static _Thread_local int loader_copy_only;   // poxim_image_open: a imagem vai para um memfd, sem mapear o arquivo
+static _Thread_local uint32_t loader_end;    // maior endereço carregado + 1 (com o .bss dos segmentos ELF)
+
+static inline void loader_extend(uint64_t end) { if (end > (uint64_t)RAM_BASE + mem_size) end = (uint64_t)RAM_BASE + mem_size; if (end > loader_end) loader_end = (uint32_t)end; }
+
+// Copia file[0..size) para a RAM a partir do índice 'dst'. As páginas inteiras de trechos
+// grandes com o mesmo alinhamento no arquivo são mapeadas MAP_PRIVATE por cima de memory[]
+// (cópia só quando o guest escreve).
+static void load_bytes(int fd, const uint8_t *file, uint64_t offset, uint32_t dst, uint32_t size) {
+    const uint32_t page = 1u << PAGE_SHIFT;
+    if (page_dirty && size) memset(page_dirty + (dst >> PAGE_SHIFT), 1, ((dst + size - 1) >> PAGE_SHIFT) - (dst >> PAGE_SHIFT) + 1);
+    uint32_t first = (dst + page - 1) & ~(page - 1), last = (dst + size) & ~(page - 1);
+    if (!loader_copy_only && size >= LOADER_MAP_MIN && (dst & (page - 1)) == (offset & (page - 1)) && first < last &&
+        mmap(memory + first, last - first, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, offset + (first - dst)) != MAP_FAILED) {
+        memcpy(memory + dst, file + offset, first - dst);
+        memcpy(memory + last, file + offset + (last - dst), dst + size - last);
+        return;
+    }
+    memcpy(memory + dst, file + offset, size);
+}
+
+static int load_elf(int fd, const uint8_t *file, size_t len, const char *path) {
+    const Elf32_Ehdr *eh = (const Elf32_Ehdr *)file;
+    if (len < sizeof(Elf32_Ehdr) || eh->e_ident[EI_CLASS] != ELFCLASS32 || eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_machine != EM_RISCV ||
+        (uint64_t)eh->e_phoff + (uint64_t)eh->e_phnum * sizeof(Elf32_Phdr) > len) {
+        fprintf(stderr, "%s: ELF não é um executável RISC-V de 32 bits little-endian\n", path); return 0;
+    }
+    for (int i = 0; i < eh->e_phnum; i++) {
+        const Elf32_Phdr *ph = (const Elf32_Phdr *)(file + eh->e_phoff) + i;
+        if (ph->p_type == PT_LOAD && ph->p_vaddr >= RAM_BASE) loader_extend((uint64_t)ph->p_vaddr + ph->p_memsz);
+        if (ph->p_type != PT_LOAD || ph->p_filesz == 0) continue;
+        if ((uint64_t)ph->p_offset + ph->p_filesz > len) { fprintf(stderr, "%s: segmento %d passa do fim do arquivo\n", path, i); return 0; }
+        // Só a parte do segmento dentro da RAM é carregada (o linker pode incluir o cabeçalho antes de RAM_BASE).
+        uint64_t start = ph->p_vaddr, end = (uint64_t)ph->p_vaddr + ph->p_filesz;
+        if (start < RAM_BASE) start = RAM_BASE;
+        if (end > (uint64_t)RAM_BASE + mem_size) end = (uint64_t)RAM_BASE + mem_size;
+        if (start >= end) { fprintf(stderr, "%s: segmento %d (0x%08x) fora da RAM\n", path, i, ph->p_vaddr); return 0; }
+        load_bytes(fd, file, ph->p_offset + (start - ph->p_vaddr), (uint32_t)(start - RAM_BASE), (uint32_t)(end - start));
+    }
+    pc = eh->e_entry;
+    return 1;
+}
+
+static int load_raw(int fd, const uint8_t *file, size_t len, uint32_t load_addr, const char *path) {
+    if (load_addr < RAM_BASE || load_addr - RAM_BASE > mem_size || len > mem_size - (load_addr - RAM_BASE)) {
+        fprintf(stderr, "%s: imagem de %zu bytes não cabe na RAM em 0x%08x\n", path, len, load_addr); return 0;
+    }
+    load_bytes(fd, file, 0, load_addr - RAM_BASE, (uint32_t)len);
+    loader_extend((uint64_t)load_addr + len);
+    pc = load_addr;
+    return 1;
+}
+
+// Parser do .hex em uma passada: hex_digit[] dá o valor de cada caractere mais um (0 se não for
+// dígito); é constante, então cargas em threads diferentes não compartilham estado. Como no
+// parser antigo, cada token vale os dígitos do seu início e bytes antes do primeiro '@' são
+// ignorados.
+static const uint8_t hex_digit[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+static void load_hex(const uint8_t *file, size_t len) {
+    const uint8_t *p = file, *end = file + len;
+    uint32_t address = 0; int address_set = 0;
+    while (p < end) {
+        uint8_t c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') { p++; continue; }
+        if (c == '@') {
+            address = 0; p++;
+            while (p < end && hex_digit[*p]) address = (address << 4) | (hex_digit[*p++] - 1u);
+            while (p < end && *p != '\n') p++;
+            address_set = 1;
+            continue;
+        }
+        uint32_t value = 0;
+        while (p < end && hex_digit[*p]) value = (value << 4) | (hex_digit[*p++] - 1u);
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+        if (!address_set) continue;
+        uint32_t idx = address - RAM_BASE;
+        if (idx < mem_size) { memory[idx] = (uint8_t)value; if (page_dirty) page_dirty[idx >> PAGE_SHIFT] = 1; if (address >= loader_end) loader_end = address + 1; }
+        address++;
+    }
+}
+
+int load_program(int fd, const char *path, uint32_t load_addr, int raw) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) { perror(path); return 0; }
+    loader_end = 0;
+    if (st.st_size == 0) return 1;
+    uint8_t *file = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (file == MAP_FAILED) { perror(path); return 0; }
+    int ok;
+    if (st.st_size >= 4 && memcmp(file, ELFMAG, SELFMAG) == 0) ok = load_elf(fd, file, st.st_size, path);
+    else if (raw) ok = load_raw(fd, file, st.st_size, load_addr, path);
+    else { load_hex(file, st.st_size); ok = 1; }
+    munmap(file, st.st_size);
+    return ok;
+}
+
+// --- Snapshots ---
+// Arquivo: cabeçalho (estado do hart, timer e UART), csrs[] em SNAP_CSRS_OFFSET, o mapa de
+// páginas presentes (um byte por página de RAM) e a imagem da RAM alinhada a página em
+// ram_offset. Só as páginas presentes são escritas; o resto do arquivo fica esparso.
+// Sem pai, as páginas ausentes são zero (snapshot completo). Com pai (o snapshot do qual a
+// execução foi restaurada), valem as do pai: o snapshot é incremental e só contém as páginas
+// escritas desde a restauração (page_dirty). A restauração mapeia a imagem copy-on-write.
+#define SNAP_MAGIC       "PXSN"
+#define SNAP_VERSION     2
+#define SNAP_CSRS_OFFSET 4096
+#define SNAP_MAP_OFFSET  (SNAP_CSRS_OFFSET + CSR_COUNT * sizeof(uint32_t))
+
+typedef struct {
+    char magic[4]; uint32_t version;
+    uint32_t mem_size, pc;
+    uint64_t instret, wfi_skipped, mtimecmp;
+    uint32_t msip;
+    uart_t uart;
+    plic_t plic;
+    uint32_t registers[32];
+    uint64_t ram_offset;
+    char parent[1024];         // caminho absoluto do snapshot pai; vazio = snapshot completo
+    uint64_t hpm_events[HPM_EVENTS];   // zeros nos snapshots anteriores aos contadores
+} snapshot_header_t;
+
+_Static_assert(sizeof(snapshot_header_t) <= SNAP_CSRS_OFFSET, "cabeçalho do snapshot maior que a área reservada");
+
+static uint64_t snapshot_ram_offset(uint32_t size) {
+    uint64_t page = 1u << PAGE_SHIFT;
+    return (SNAP_MAP_OFFSET + (size >> PAGE_SHIFT) + page - 1) & ~(page - 1);
+}
+
+static int snapshot_read_header(int fd, const char *path, snapshot_header_t *h) {
+    if (pread(fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h) || memcmp(h->magic, SNAP_MAGIC, 4) != 0 || h->version != SNAP_VERSION) {
+        fprintf(stderr, "%s: não é um snapshot do simulador\n", path); return 0;
+    }
+    return 1;
+}
+
+// Lê só o tamanho da RAM, antes de alocar a memória do guest.
+uint32_t poxim_snapshot_mem_size(const char *path) {
+    snapshot_header_t h;
+    int fd = open(path, O_RDONLY); if (fd < 0) { perror(path); return 0; }
+    int ok = snapshot_read_header(fd, path, &h);
+    close(fd);
+    return ok ? h.mem_size : 0;
+}
+
+int snapshot_save(const char *path) {
+    machine_t *m = machine;
+    if (m->async) async_sync(m->async);   // a mensagem abaixo vai depois do console
+    char full[1024];
+    if (m->snapshot_parent[0] && realpath(path, full) && strcmp(full, m->snapshot_parent) == 0) {
+        fprintf(stderr, "%s: o snapshot restaurado não pode ser sobrescrito\n", path); return 0;
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644); if (fd < 0) { perror(path); return 0; }
+    snapshot_header_t h; memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, 4); h.version = SNAP_VERSION;
+    h.mem_size = mem_size; h.pc = pc;
+    h.instret = instret; h.wfi_skipped = wfi_skipped; h.mtimecmp = m->clint_mtimecmp[0];
+    h.msip = m->clint_msip[0]; h.uart = m->uart; h.plic = m->plic;
+    memcpy(h.registers, registers, sizeof(h.registers));
+    h.ram_offset = snapshot_ram_offset(mem_size);
+    memcpy(h.parent, m->snapshot_parent, sizeof(h.parent));
+    memcpy(h.hpm_events, hpm_events, sizeof(h.hpm_events));
+
+    uint32_t pages = mem_size >> PAGE_SHIFT, written = 0;
+    int ok = pwrite(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h)
+          && pwrite(fd, csrs, CSR_COUNT * sizeof(uint32_t), SNAP_CSRS_OFFSET) == (ssize_t)(CSR_COUNT * sizeof(uint32_t))
+          && pwrite(fd, page_dirty, pages, SNAP_MAP_OFFSET) == (ssize_t)pages
+          && ftruncate(fd, h.ram_offset + mem_size) == 0;
+    for (uint32_t p = 0; ok && p < pages; ) {
+        if (!page_dirty[p]) { p++; continue; }
+        uint32_t run = p; while (run < pages && page_dirty[run]) run++;
+        size_t len = (size_t)(run - p) << PAGE_SHIFT;
+        ok = pwrite(fd, memory + ((size_t)p << PAGE_SHIFT), len, h.ram_offset + ((uint64_t)p << PAGE_SHIFT)) == (ssize_t)len;
+        written += run - p; p = run;
+    }
+    if (close(fd) != 0) ok = 0;
+    if (!ok) { perror(path); return 0; }
+    printf("Snapshot salvo em %s (pc=0x%08x, %llu instruções, %u páginas%s)\n", path, pc, (unsigned long long)instret, written, m->snapshot_parent[0] ? ", incremental" : "");
+    return 1;
+}
+
+// Mapeia a RAM de 'path' (e antes a dos pais) por cima de memory[], copy-on-write.
+static int snapshot_map_ram(const char *path, snapshot_header_t *h, int depth) {
+    int fd = open(path, O_RDONLY); if (fd < 0) { perror(path); return 0; }
+    if (!snapshot_read_header(fd, path, h)) { close(fd); return 0; }
+    if (h->mem_size != mem_size || depth > 64) { fprintf(stderr, "%s: cadeia de snapshots inconsistente\n", path); close(fd); return 0; }
+    int ok = 1;
+    if (!h->parent[0]) {
+        ok = mmap(memory, mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, h->ram_offset) != MAP_FAILED;
+    } else {
+        snapshot_header_t parent;
+        uint32_t pages = mem_size >> PAGE_SHIFT;
+        uint8_t *present = malloc(pages);
+        ok = present && snapshot_map_ram(h->parent, &parent, depth + 1) && pread(fd, present, pages, SNAP_MAP_OFFSET) == (ssize_t)pages;
+        for (uint32_t p = 0; ok && p < pages; ) {
+            if (!present[p]) { p++; continue; }
+            uint32_t run = p; while (run < pages && present[run]) run++;
+            ok = mmap(memory + ((size_t)p << PAGE_SHIFT), (size_t)(run - p) << PAGE_SHIFT, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, h->ram_offset + ((uint64_t)p << PAGE_SHIFT)) != MAP_FAILED;
+            p = run;
+        }
+        free(present);
+    }
+    if (!ok) fprintf(stderr, "%s: falha ao mapear a RAM do snapshot\n", path);
+    close(fd);
+    return ok;
+}
+
+int snapshot_restore(const char *path) {
+    snapshot_header_t h;
+    if (!snapshot_map_ram(path, &h, 0)) return 0;
+    int fd = open(path, O_RDONLY);
+    int ok = fd >= 0 && pread(fd, csrs, CSR_COUNT * sizeof(uint32_t), SNAP_CSRS_OFFSET) == (ssize_t)(CSR_COUNT * sizeof(uint32_t));
+    if (fd >= 0) close(fd);
+    if (!ok) { fprintf(stderr, "%s: snapshot truncado\n", path); return 0; }
+    pc = h.pc;
+    machine_t *m = machine;
+    instret = h.instret; wfi_skipped = h.wfi_skipped; m->clint_mtimecmp[0] = h.mtimecmp; timer_sync();
+    m->clint_msip[0] = h.msip; m->uart = h.uart; m->plic = h.plic; plic_update(m);
+    memcpy(registers, h.registers, sizeof(h.registers));
+    memcpy(hpm_events, h.hpm_events, sizeof(h.hpm_events)); hpm_active = hpm_selects_insns(csrs);
+    irq_dirty = 1; next_event = 0;
+    if (!realpath(path, m->snapshot_parent)) m->snapshot_parent[0] = '\0';
+    return 1;
+}
+
+// --- Máquinas e harts ---
+// machine->harts[] guarda o estado de cada hart. Sem threads um só thread do host executa
+// todos, HART_QUANTUM instruções por vez, em ordem fixa (a execução é determinística). Com
+// threads cada hart roda na sua thread sobre a mesma RAM.
+struct hart {
+    uint32_t registers[32];
+    uint32_t csrs[CSR_COUNT];
+    uint32_t pc;
+    uint64_t instret, wfi_skipped, next_event;
+    uint64_t hpm_events[HPM_EVENTS];
+    int trap_occurred, irq_dirty, hpm_active;
+    machine_t *machine; int id;
+};
+
+void hart_save(void) {
+    hart_t *h = &machine->harts[hart_id];
+    h->pc = pc; h->instret = instret; h->wfi_skipped = wfi_skipped; h->next_event = next_event;
+    h->trap_occurred = trap_occurred; h->irq_dirty = irq_dirty; h->hpm_active = hpm_active;
+}
+
+void hart_load(int id) {
+    hart_t *h = &machine->harts[id];
+    hart_id = id; registers = h->registers; csrs = h->csrs; hart_poke = &machine->clint_poke[id]; hpm_events = h->hpm_events;
+    pc = h->pc; instret = h->instret; wfi_skipped = h->wfi_skipped; next_event = h->next_event;
+    trap_occurred = h->trap_occurred; irq_dirty = h->irq_dirty; hpm_active = h->hpm_active;
+#if POXIM_SELF_PROFILE
+    selfprof = &machine->selfprof[id];
+#endif
+    timer_sync();
+}
+
+// Associa m ao thread, no hart 'id'.
+static void machine_attach(machine_t *m, int id) {
+    machine = m; mem_size = m->mem_size; memory = m->memory; page_host = m->page_host; page_dirty = m->page_dirty;
+    hart_load(id);
+}
+
+// icache, superblocos (se 'superblocks') e JIT (se 'jit') do thread.
+static int thread_caches_init(int superblocks, int jit) {
+    icache = alloc_guest(icache_bytes(), machine->huge_pages);
+    if (icache == NULL) { perror("Erro ao alocar o icache"); return 0; }
+    icache_words = (uint8_t *)(icache + mem_size / 2);
+    sb_enabled = superblocks && sb_init();
+    jit_enabled = jit && jit_init();
+    aot_mark_words();
+    resv_remark();
+    return 1;
+}
+
+static void thread_caches_free(void) {
+    if (icache) munmap(icache, icache_bytes());
+    icache = NULL; icache_words = NULL;
+    sb_free();
+    jit_free();
+}
+
+// Início e fim de uma chamada da API: a máquina guarda entre as chamadas o icache e o JIT
+// usados pelo thread que a executa sem threads por hart.
+static int machine_enter(machine_t *m) {
+    machine_attach(m, m->cur_hart);
+    if (m->icache == NULL) {
+        if (!thread_caches_init(m->superblocks && !m->hart_threads, m->jit && !m->hart_threads)) { machine = NULL; return 0; }
+        return 1;
+    }
+    icache = m->icache; icache_words = (uint8_t *)(icache + mem_size / 2); jit_enabled = m->jit_enabled;
+    sb_enabled = m->sb_enabled; sb_arena = m->sb_arena; sb_used = m->sb_used; sb_table = m->sb_table;
+#if defined(__x86_64__)
+    jit_buf = m->jit_buf; jit_used = m->jit_used; jit_blocks = m->jit_blocks;
+#endif
+    return 1;
+}
+
+static void machine_leave(void) {
+    machine_t *m = machine;
+    hart_save(); m->cur_hart = hart_id;
+    m->icache = icache; m->jit_enabled = jit_enabled; icache = NULL; icache_words = NULL; jit_enabled = 0;
+    m->sb_enabled = sb_enabled; m->sb_arena = sb_arena; m->sb_used = sb_used; m->sb_table = sb_table; sb_enabled = 0; sb_arena = NULL; sb_table = NULL;
+#if defined(__x86_64__)
+    m->jit_buf = jit_buf; m->jit_used = jit_used; m->jit_blocks = jit_blocks; jit_buf = NULL; jit_blocks = NULL;
+#endif
+    machine = NULL;
+}
+
+// Primeira parada vence: o motivo fica em stop_reason e a máquina não executa mais.
+static void machine_stop_with(machine_t *m, int reason) {
+    int expected = POXIM_LIMIT;
+    __atomic_compare_exchange_n(&m->stop_reason, &expected, reason, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    __atomic_store_n(&m->running, 0, __ATOMIC_RELAXED);
+}
+
+poxim_machine *poxim_create(const poxim_config *cfg) {
+    uint32_t size = (cfg && cfg->mem_size) ? cfg->mem_size : MEM_SIZE_DEFAULT;
+    int n = (cfg && cfg->harts) ? cfg->harts : 1;
+    if (size % (1u << PAGE_SHIFT) != 0 || size > MEM_SIZE_MAX || n < 1 || n > MAX_HARTS) return NULL;
+    machine_t *m = calloc(1, sizeof(machine_t));
+    if (m == NULL) return NULL;
+#if POXIM_SELF_PROFILE
+    static pthread_once_t selfprof_calibrated = PTHREAD_ONCE_INIT;
+    pthread_once(&selfprof_calibrated, selfprof_calibrate);
+#endif
+    m->mem_size = size; m->n_harts = n; m->running = 1;
+    m->superblocks = !(cfg && cfg->no_superblocks);
+    if (cfg) { m->hart_threads = cfg->threads; m->jit = cfg->jit; m->huge_pages = cfg->huge_pages; }
+    m->trace_start_icount = m->trace_window = m->window_end = m->snapshot_icount = UINT64_MAX;
+    m->quantum_end = HART_QUANTUM; m->uart.rx_ready = UINT64_MAX;
+    pthread_mutex_init(&m->device_mutex, NULL); pthread_mutex_init(&m->resv_mutex, NULL);
+    m->memory = alloc_guest(size, m->huge_pages); m->harts = calloc(n, sizeof(hart_t));
+    if (m->memory == NULL || m->harts == NULL || !bus_init(m) ||
+        (cfg && cfg->track_dirty && (m->page_dirty = alloc_guest(size >> PAGE_SHIFT, 0)) == NULL)) { poxim_destroy(m); return NULL; }
+    for (int h = 0; h < n; h++) {
+        hart_t *t = &m->harts[h];
+        t->csrs[CSR_MHARTID] = h; t->pc = RAM_BASE; t->irq_dirty = 1; t->machine = m; t->id = h;
+        m->clint_mtimecmp[h] = UINT64_MAX; m->resv_addr[h] = RESV_NONE;
+    }
+    return m;
+}
+
+void poxim_destroy(poxim_machine *m) {
+    if (m == NULL) return;
+    if (m->icache && machine_enter(m)) { thread_caches_free(); machine = NULL; }
+    async_stop(m);
+    for (int s = 0; s < POXIM_STREAMS; s++) if (m->sinks[s]) fclose(m->sinks[s]);
+    uart_input_reset(m);
+    if (m->memory) munmap(m->memory, m->mem_size);
+    if (m->page_dirty) munmap(m->page_dirty, m->mem_size >> PAGE_SHIFT);
+    if (m->prof_pc) munmap(m->prof_pc, (size_t)(m->mem_size / 2) * sizeof(uint64_t));
+    cache_sim_free(m->cache, m->mem_size); timing_model_free(m->timing); semihost_free(m->semihost); aot_drop(m);
+    free(m->page_host); free(m->page_device); free(m->harts); free(m->snapshot_path);
+    free(m->bt_buf); free(m->bt_cache_pc); free(m->bt_cache_raw);
+    pthread_mutex_destroy(&m->device_mutex); pthread_mutex_destroy(&m->resv_mutex);
+    free(m);
+}
+
+// --- Carga ---
+// Depois de carregar, todos os harts começam no ponto de entrada.
+static void harts_set_pc(machine_t *m, uint32_t entry) { for (int h = 0; h < m->n_harts; h++) m->harts[h].pc = entry; }
+
+// O host reescreveu [RAM_BASE + index, + len) com a máquina parada: as reservas nessa faixa caem.
+static void resv_drop(machine_t *m, uint32_t index, uint32_t len) {
+    for (int h = 0; h < m->n_harts; h++) {
+        uint32_t r = m->resv_addr[h] - RAM_BASE;
+        if (m->resv_addr[h] != RESV_NONE && r < index + len && r + 4 > index) m->resv_addr[h] = RESV_NONE;
+    }
+}
+
+int poxim_load(poxim_machine *m, const char *path, uint32_t load_addr, int raw) {
+    int fd = open(path, O_RDONLY); if (fd < 0) { perror(path); return 0; }
+    if (!machine_enter(m)) { close(fd); return 0; }
+    aot_drop(m); icache_flush();
+    int ok = load_program(fd, path, load_addr, raw);
+    if (ok) { harts_set_pc(m, pc); m->image_end = loader_end; resv_drop(m, 0, m->mem_size); }
+    machine_leave();
+    close(fd);
+    return ok;
+}
+
+// A imagem é carregada uma vez num memfd; poxim_load_image a mapeia MAP_PRIVATE por cima da
+// RAM da máquina (só as páginas que o guest escrever são copiadas).
+struct poxim_image { int fd; uint32_t mem_size, entry, end; };
+
+poxim_image *poxim_image_open(const char *path, uint32_t size, uint32_t load_addr, int raw) {
+    int fd = open(path, O_RDONLY); if (fd < 0) { perror(path); return NULL; }
+    poxim_image *img = calloc(1, sizeof(poxim_image));
+    if (img == NULL) { close(fd); return NULL; }
+    img->mem_size = size ? size : MEM_SIZE_DEFAULT;
+    img->fd = memfd_create("poxim-imagem", 0);
+    uint8_t *ram = MAP_FAILED;
+    if (img->fd < 0 || ftruncate(img->fd, img->mem_size) != 0 || (ram = mmap(NULL, img->mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, img->fd, 0)) == MAP_FAILED) {
+        perror("Erro ao criar a imagem do programa");
+        if (img->fd >= 0) close(img->fd);
+        free(img); close(fd); return NULL;
+    }
+    // O carregador escreve pela RAM do thread, que aqui é o memfd.
+    memory = ram; mem_size = img->mem_size; page_dirty = NULL; pc = RAM_BASE; loader_copy_only = 1;
+    int ok = load_program(fd, path, load_addr, raw);
+    loader_copy_only = 0; memory = NULL; img->entry = pc; img->end = loader_end;
+    munmap(ram, img->mem_size); close(fd);
+    if (!ok) { poxim_image_close(img); return NULL; }
+    return img;
+}
+
+int poxim_load_image(poxim_machine *m, const poxim_image *img) {
+    if (img->mem_size != m->mem_size) { fprintf(stderr, "Imagem de %u bytes numa máquina de %u bytes\n", img->mem_size, m->mem_size); return 0; }
+    if (mmap(m->memory, m->mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, img->fd, 0) == MAP_FAILED) { perror("Erro ao mapear a imagem do programa"); return 0; }
+    if (m->page_dirty) memset(m->page_dirty, 1, m->mem_size >> PAGE_SHIFT);
+    aot_drop(m);
+    if (m->icache) { if (!machine_enter(m)) return 0; icache_flush(); machine_leave(); }
+    harts_set_pc(m, img->entry); m->image_end = img->end; resv_drop(m, 0, m->mem_size);
+    return 1;
+}
+
+// Só os blocos cujo código confere com a RAM carregada são instalados.
+int poxim_aot(poxim_machine *m, const poxim_aot_program *prog) {
+    aot_drop(m);
+    if (prog == NULL) return 0;
+    const poxim_aot_block **table = alloc_guest((size_t)(m->mem_size / 2) * sizeof(poxim_aot_block *), 0);
+    if (table == NULL) return 0;
+    int installed = 0;
+    for (uint32_t i = 0; i < prog->n_blocks; i++) {
+        const poxim_aot_block *b = &prog->blocks[i];
+        if (b->pc < RAM_BASE || b->end <= b->pc || b->end - RAM_BASE > m->mem_size || b->pc % 2 != 0) continue;
+        if (memcmp(m->memory + (b->pc - RAM_BASE), prog->code + b->offset, b->end - b->pc) != 0) continue;
+        table[(b->pc - RAM_BASE) >> 1] = b; installed++;
+    }
+    if (!installed) { munmap(table, (size_t)(m->mem_size / 2) * sizeof(poxim_aot_block *)); return 0; }
+    m->aot = prog; m->aot_table = table;
+    if (m->icache) { if (!machine_enter(m)) return 0; aot_mark_words(); machine_leave(); }
+    return installed;
+}
+
+void poxim_image_close(poxim_image *img) {
+    if (img == NULL) return;
+    close(img->fd); free(img);
+}
+
+// --- Snapshots da API ---
+// O formato guarda um único hart.
+static int snapshot_allowed(const machine_t *m, const char *path) {
+    if (m->n_harts == 1) return 1;
+    fprintf(stderr, "%s: snapshots exigem um único hart\n", path); return 0;
+}
+
+int poxim_save_snapshot(poxim_machine *m, const char *path) {
+    if (!snapshot_allowed(m, path)) return 0;
+    if (m->page_dirty == NULL) { fprintf(stderr, "%s: a máquina não registra as páginas escritas (track_dirty)\n", path); return 0; }
+    if (!machine_enter(m)) return 0;
+    int ok = snapshot_save(path);
+    machine_leave();
+    return ok;
+}
+
+int poxim_restore_snapshot(poxim_machine *m, const char *path) {
+    if (!snapshot_allowed(m, path) || !machine_enter(m)) return 0;
+    aot_drop(m); icache_flush();
+    int ok = snapshot_restore(path);
+    resv_drop(m, 0, m->mem_size);
+    machine_leave();
+    return ok;
+}
+
+int poxim_snapshot_at(poxim_machine *m, const char *path, uint64_t icount, uint32_t at, int at_pc) {
+    if (!snapshot_allowed(m, path)) return 0;
+    if (m->page_dirty == NULL) { fprintf(stderr, "%s: a máquina não registra as páginas escritas (track_dirty)\n", path); return 0; }
+    char *copy = strdup(path); if (copy == NULL) return 0;
+    free(m->snapshot_path); m->snapshot_path = copy;
+    m->snapshot_icount = icount; m->snapshot_pc = at; m->snapshot_at_pc = at_pc;
+    m->snapshot_pending = icount != UINT64_MAX || at_pc;
+    return 1;
+}
+
+// --- Saídas ---
+void poxim_set_trace_window(poxim_machine *m, uint64_t start_icount, uint32_t start_pc, int start_at_pc, uint64_t window) {
+    m->trace_start_icount = start_icount; m->trace_start_pc = start_pc; m->trace_start_at_pc = start_at_pc; m->trace_window = window;
+    m->window_pending = start_icount != UINT64_MAX || start_at_pc;
+}
+
+int poxim_set_file(poxim_machine *m, int stream, FILE *f) {
+    if (stream < 0 || stream >= POXIM_STREAMS) return 0;
+    if (m->async) async_sync(m->async);   // o que já foi registrado vai para a saída anterior
+    if (stream == POXIM_BINARY_TRACE) {
+        if (m->bt_buf == NULL && !bt_init(m)) { perror("Erro ao alocar o buffer do trace"); return 0; }
+        machine = m;
+        if (m->bin_trace_file) bt_flush();   // registros pendentes vão para a saída anterior
+        if (f) { m->bin_trace_file = f; bt_write_header(); bt_flush(); }
+        machine = NULL;
+    }
+    if (m->sinks[stream] && m->sinks[stream] != f) { fclose(m->sinks[stream]); m->sinks[stream] = NULL; }
+    switch (stream) {
+        case POXIM_TRACE:        m->trace_out = f; break;
+        case POXIM_BINARY_TRACE: m->bin_out = f; break;
+        case POXIM_TERMINAL:     m->terminal_file = f; break;
+        case POXIM_CONSOLE:      m->console = f; break;
+        case POXIM_INPUT:        m->input_file = f; uart_input_reset(m); break;
+    }
+    // Com a janela aberta as novas saídas valem a partir da próxima instrução.
+    if (m->tracing && !m->trace_out && !m->bin_out) m->tracing = 0;
+    m->output_file = m->tracing ? m->trace_out : NULL; m->bin_trace_file = m->tracing ? m->bin_out : NULL;
+    return 1;
+}
+
+typedef struct { poxim_write_fn fn; void *ctx; } sink_t;
+
+static ssize_t sink_write(void *cookie, const char *buf, size_t len) { sink_t *s = cookie; s->fn(s->ctx, buf, len); return len; }
+static int sink_close(void *cookie) { free(cookie); return 0; }
+
+int poxim_set_sink(poxim_machine *m, int stream, poxim_write_fn fn, void *ctx) {
+    if (stream == POXIM_INPUT) return 0;
+    FILE *f = NULL;
+    if (fn) {
+        sink_t *s = malloc(sizeof(sink_t)); if (s == NULL) return 0;
+        s->fn = fn; s->ctx = ctx;
+        f = fopencookie(s, "w", (cookie_io_functions_t){ NULL, sink_write, NULL, sink_close });
+        if (f == NULL) { free(s); return 0; }
+    }
+    if (!poxim_set_file(m, stream, f)) { if (f) fclose(f); return 0; }
+    m->sinks[stream] = f;
+    return 1;
+}
+
+int poxim_async_output(poxim_machine *m, int enable) {
+    if (!enable) { async_stop(m); return 1; }
+    if (m->async) return 1;
+    if (m->hart_threads || !POXIM_BIN_TRACE) return 0;   // um produtor só; as linhas vêm dos valores do trace binário
+    async_out_t *a = calloc(1, sizeof(async_out_t));
+    if (a == NULL) return 0;
+    a->m = m;
+    a->ring = malloc(ASYNC_RING * sizeof(async_rec_t)); a->trace_buf = malloc(ASYNC_BUFFER); a->console_buf = malloc(ASYNC_BUFFER);
+    pthread_mutex_init(&a->lock, NULL); pthread_cond_init(&a->wake, NULL); pthread_cond_init(&a->done, NULL);
+    if (a->ring == NULL || a->trace_buf == NULL || a->console_buf == NULL || pthread_create(&a->thread, NULL, async_writer, a) != 0) {
+        pthread_mutex_destroy(&a->lock); pthread_cond_destroy(&a->wake); pthread_cond_destroy(&a->done);
+        free(a->ring); free(a->trace_buf); free(a->console_buf); free(a);
+        return 0;
+    }
+    m->async = a;
+    return 1;
+}
+
+// --- Execução ---
+// Busca da instrução em pc: pc par (RV32C) e a instrução inteira dentro da RAM; uma de 32
+// bits pode começar na última meia palavra de uma página. Devolve NULL depois do access fault.
+static inline decoded_insn_t *fetch_insn(void) {
+    uint32_t idx = pc - RAM_BASE;
+    if (pc % 2 != 0 || idx > mem_size - 2) { raise_exception(CAUSE_INSN_ACCESS, pc); return NULL; }
+    decoded_insn_t *insn = &icache[idx >> 1];
+    if (insn->op == OP_INVALID) {
+        int ok; SELFPROF_TIME(SELFPROF_DECODE, ok = decode_at(idx, insn));
+        if (!ok) { raise_exception(CAUSE_INSN_ACCESS, pc + 2); return NULL; }
+    }
+    return insn;
+}
+
+// Laço de um hart com threads: o mesmo de machine_run sem trace, janela e snapshots.
+static void *hart_thread(void *arg) {
+    hart_t *h = arg; machine_t *m = h->machine;
+    machine_attach(m, h->id);
+    if (!thread_caches_init(m->superblocks, m->jit)) { machine_stop_with(m, POXIM_ERROR); machine = NULL; return NULL; }
+    resv_lock(); m->hart_words[hart_id] = icache_words; resv_unlock();   // o lr.w dos outros harts marca as reservas aqui
+    resv_remark();
+    SELFPROF_RUN_BEGIN(run);
+    while (machine_running()) {
+        if (pc == 0) { printf("\nSimulação terminada (Retorno a 0x0, hart %d).\n", hart_id); machine_stop_with(m, POXIM_PC_ZERO); break; }
+        if (m->aot_table && !hpm_active) {
+            uint32_t retired; SELFPROF_TIME(SELFPROF_AOT, retired = aot_run(UINT64_MAX));
+            if (retired) { trap_occurred = 0; retire_instructions(retired); continue; }
+        }
+#if defined(__x86_64__)
+        if (jit_enabled && !hpm_active) {
+            uint32_t retired; SELFPROF_TIME(SELFPROF_JIT, retired = jit_run(UINT64_MAX));
+            if (retired) { trap_occurred = 0; retire_instructions(retired); continue; }
+        }
+#endif
+        if (sb_enabled && !hpm_active) {
+            uint32_t retired; SELFPROF_TIME(SELFPROF_SUPERBLOCKS, retired = sb_run(UINT64_MAX));
+            if (retired) { trap_occurred = 0; retire_instructions(retired); continue; }
+        }
+        decoded_insn_t *insn = fetch_insn();
+        if (insn == NULL) continue;
+        if (insn->raw == 0) { printf("Simulação terminada (instrução nula, hart %d). PC=0x%x\n", hart_id, pc); machine_stop_with(m, POXIM_NULL_INSN); break; }
+        uint32_t pc_atual = pc, len = insn_length(insn->raw); uint8_t op = insn->op;
+        SELFPROF_SAMPLE();
+        SELFPROF_BEGIN_SAMPLED(sp);
+        execute_instruction_untraced(insn, pc_atual);
+        SELFPROF_END(sp, SELFPROF_CLASS + op_class(op));
+        if (op == OP_EBREAK) { printf("Simulação terminada (ebreak, hart %d).\n", hart_id); machine_stop_with(m, POXIM_EBREAK); break; }
+        if (hpm_active && !trap_occurred) hpm_count(op, pc != pc_atual + len);
+        retire_instructions(1);
+    }
+    SELFPROF_RUN_END(run);
+    hart_save();
+    resv_lock(); m->hart_words[hart_id] = NULL; resv_unlock();
+    thread_caches_free();
+    machine = NULL;
+    return NULL;
+}
+
+static void harts_run_threads(machine_t *m) {
+    pthread_t threads[MAX_HARTS];
+    int started = 0;
+#ifdef SYS_membarrier
+    m->membarrier = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;   // ver --- RV32A ---
+#endif
+    for (; started < m->n_harts; started++) {
+        if (pthread_create(&threads[started], NULL, hart_thread, &m->harts[started]) != 0) { perror("Erro ao criar thread do hart"); machine_stop_with(m, POXIM_ERROR); break; }
+    }
+    for (int h = 0; h < started; h++) pthread_join(threads[h], NULL);
+    if (m->console) fflush(m->console);
+}
+
+// Executa até 'n' instruções a máquina associada ao thread; devolve POXIM_LIMIT ou o motivo da parada.
+static int machine_run(uint64_t n) {
+    machine_t *m = machine;
+    int has_trace = m->trace_out || m->bin_out;
+    // Fast-forward: até a janela abrir roda a cópia de execute_instruction sem trace.
+    int window_pending = has_trace && m->window_pending, tracing = m->tracing;
+    // Snapshot em um icount/pc: o JIT fica desligado até ele ser salvo, para parar no ponto exato.
+    int snapshot_pending = m->snapshot_pending, reason = POXIM_LIMIT;
+    uint64_t *prof_pc = m->prof_pc;   // o perfil conta cada instrução: sem JIT
+    cache_sim_t *cache = m->cache;    // o simulador de cache passa pelo interpretador e pelos superblocos
+    timing_model_t *timing = m->timing;   // o modelo de tempo só pelo interpretador
+    uint64_t window_end = m->window_end, quantum_end = m->quantum_end, remaining = n;
+    async_out_t *async = m->async;
+    if (async && tracing && m->output_file) async_write_regs(async);   // a API pode ter mudado os registradores
+    SELFPROF_RUN_BEGIN(run);
+
+    while (remaining) { 
+        if (m->n_harts > 1 && instret >= quantum_end) {
+            hart_save(); hart_load((hart_id + 1) % m->n_harts);
+            if (async && tracing && m->output_file) async_write_regs(async);
+            quantum_end = instret + HART_QUANTUM;
+        }
+        if (pc == 0) { reason = POXIM_PC_ZERO; break; }
+        if (has_trace && !tracing && (window_pending ? (instret >= m->trace_start_icount || (m->trace_start_at_pc && pc == m->trace_start_pc)) : window_end == UINT64_MAX)) {
+            m->output_file = m->trace_out; m->bin_trace_file = m->bin_out;
+            if (m->bin_trace_file) bt_write_regs();
+            else if (async && m->output_file) async_write_regs(async);
+            tracing = 1; window_pending = 0;
+            window_end = (m->trace_window > UINT64_MAX - instret) ? UINT64_MAX - 1 : instret + m->trace_window;
+        }
+        if (snapshot_pending && (instret >= m->snapshot_icount || (m->snapshot_at_pc && pc == m->snapshot_pc))) {
+            snapshot_save(m->snapshot_path); snapshot_pending = 0;
+        }
+        // Blocos do poxim-aot: como nos superblocos, a cadeia para no fim do quantum.
+        if (m->aot_table && !has_trace && !snapshot_pending && !prof_pc && !hpm_active && !cache && !timing) {
+            uint64_t limit = (m->n_harts > 1 && quantum_end - instret < remaining) ? quantum_end - instret : remaining;
+            uint32_t retired; SELFPROF_TIME(SELFPROF_AOT, retired = aot_run(limit));
+            if (retired) { trap_occurred = 0; retire_instructions(retired); remaining -= retired; continue; }
+        }
+#if defined(__x86_64__)
+        if (jit_enabled && !has_trace && !snapshot_pending && !prof_pc && !hpm_active && !cache && !timing) {
+            uint32_t retired; SELFPROF_TIME(SELFPROF_JIT, retired = jit_run(remaining));
+            if (retired) { trap_occurred = 0; retire_instructions(retired); remaining -= retired; continue; }
+        }
+#endif
+        // Superblocos: com vários harts a cadeia para no fim do quantum, para intercalar igual ao interpretador.
+        if (sb_enabled && !has_trace && !snapshot_pending && !prof_pc && !hpm_active && !timing) {
+            uint64_t limit = (m->n_harts > 1 && quantum_end - instret < remaining) ? quantum_end - instret : remaining;
+            uint32_t retired; SELFPROF_TIME(SELFPROF_SUPERBLOCKS, retired = sb_run(limit));
+            if (retired) { trap_occurred = 0; retire_instructions(retired); remaining -= retired; continue; }
+        }
+        decoded_insn_t *insn = fetch_insn();
+        if (insn == NULL) continue;
+        uint32_t pc_atual = pc, len = insn_length(insn->raw); uint8_t op = insn->op;
+        uint32_t data_addr = cache ? cache_data_addr(insn) : 0;
+
+        if (insn->raw == 0) { reason = POXIM_NULL_INSN; break; }
+        
+        SELFPROF_SAMPLE();
+        SELFPROF_BEGIN_SAMPLED(sp);
+        if (!tracing) {
+            execute_instruction_untraced(insn, pc_atual);
+        } else if (m->bin_trace_file) {
+            decoded_insn_t executed = *insn; // um store pode invalidar a própria entrada
+            execute_instruction_binary(insn, pc_atual);
+            SELFPROF_TIME_SAMPLED(SELFPROF_TRACE_BINARY, bt_write_insn(&executed, pc_atual));
+        } else if (async) {
+            decoded_insn_t executed = *insn;
+            execute_instruction_binary(insn, pc_atual);   // só os valores; a linha é formatada pelo thread de escrita
+            SELFPROF_TIME_SAMPLED(SELFPROF_TRACE_TEXT, async_write_insn(async, &executed, pc_atual));
+        } else {
+            execute_instruction(insn, pc_atual, m->output_file);
+        }
+        SELFPROF_END(sp, SELFPROF_CLASS + op_class(op));
+        
+        if (!m->running) { reason = POXIM_EBREAK; break; }
+        if (prof_pc) {
+            prof_pc[(pc_atual - RAM_BASE) >> 1]++; m->prof_op[op]++;
+            if (op >= OP_BEQ && op <= OP_BGEU && pc != pc_atual + len) m->prof_taken[op]++;
+        }
+        if (cache) cache_insn(cache, op, pc_atual, len, data_addr);
+        if (timing) {
+            // As bolhas adiantam os eventos agendados (next_event conta instruções).
+            uint32_t stalls = timing_insn(timing, insn, op, pc_atual, pc != pc_atual + len);
+            wfi_skipped += stalls;
+            if (next_event != UINT64_MAX) next_event = (next_event > stalls) ? next_event - stalls : 0;
+        }
+        if (hpm_active && !trap_occurred) hpm_count(op, pc != pc_atual + len);
+        
+        retire_instructions(1); remaining--;
+        if (tracing && instret >= window_end) {
+            if (m->bin_trace_file) bt_flush();
+            m->output_file = NULL; m->bin_trace_file = NULL; tracing = 0;
+        }
+    }
+    m->window_pending = window_pending; m->tracing = tracing; m->snapshot_pending = snapshot_pending;
+    m->window_end = window_end; m->quantum_end = quantum_end;
+    SELFPROF_RUN_END(run);
+    if (m->bin_trace_file) bt_flush();
+    output_sync(m);
+    if (reason != POXIM_LIMIT) { machine_stop_with(m, reason); reason = m->stop_reason; }   // o exit do semihosting para antes (!running)
+    return reason;
+}
+
+int poxim_run(poxim_machine *m, uint64_t n) {
+    if (!m->running) return m->stop_reason;
+    if (m->hart_threads) { harts_run_threads(m); return m->stop_reason; }
+    if (!machine_enter(m)) return POXIM_ERROR;
+    int reason = machine_run(n);
+    machine_leave();
+    return reason;
+}
+
+// --- Perfil ---
+static const char *class_name[CLASS_COUNT] = { "ALU", "mul/div", "load", "store", "desvio", "salto", "CSR", "sistema", "atômica", "inválida" };
+
+// Desmontagem com os operandos no formato do trace ("addi    a0,a0,0x001").
+static void disassemble(const decoded_insn_t *d, char *buf, size_t n) {
+    uint32_t rd = d->rd, rs1 = d->rs1, rs2 = d->rs2; int32_t imm = d->imm;
+    const char *name = insn_length(d->raw) == 2 ? rvc_name(d) : op_name[d->op];
+    switch (d->op) {
+        case OP_ADDI: case OP_SLTI: case OP_SLTIU: case OP_XORI: case OP_ORI: case OP_ANDI: case OP_JALR:
+            snprintf(buf, n, "%-7s %s,%s,0x%03x", name, x_label[rd], x_label[rs1], imm & 0xFFF); break;
+        case OP_SLLI: case OP_SRLI: case OP_SRAI: snprintf(buf, n, "%-7s %s,%s,%u", name, x_label[rd], x_label[rs1], (uint32_t)imm); break;
+        case OP_ADD: case OP_SLL: case OP_SLT: case OP_SLTU: case OP_XOR: case OP_SRL: case OP_OR: case OP_AND: case OP_SUB: case OP_SRA:
+        case OP_MUL: case OP_MULH: case OP_MULHSU: case OP_MULHU: case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+            snprintf(buf, n, "%-7s %s,%s,%s", name, x_label[rd], x_label[rs1], x_label[rs2]); break;
+        case OP_JAL: snprintf(buf, n, "%-7s %s,0x%05x", name, x_label[rd], (imm >> 1) & 0xFFFFF); break;
+        case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+            snprintf(buf, n, "%-7s %s,%s,0x%03x", name, x_label[rs1], x_label[rs2], (imm >> 1) & 0xFFF); break;
+        case OP_LUI: case OP_AUIPC: snprintf(buf, n, "%-7s %s,0x%05x", name, x_label[rd], ((uint32_t)imm >> 12) & 0xFFFFF); break;
+        case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU: snprintf(buf, n, "%-7s %s,0x%03x(%s)", name, x_label[rd], imm & 0xFFF, x_label[rs1]); break;
+        case OP_SB: case OP_SH: case OP_SW: snprintf(buf, n, "%-7s %s,0x%03x(%s)", name, x_label[rs2], imm & 0xFFF, x_label[rs1]); break;
+        case OP_CSRRW: case OP_CSRRS: case OP_CSRRC: snprintf(buf, n, "%-7s %s,%s,0x%03x", name, x_label[rd], x_label[rs1], (uint32_t)imm); break;
+        case OP_CSRRWI: case OP_CSRRSI: case OP_CSRRCI: snprintf(buf, n, "%-7s %s,0x%x,0x%03x", name, x_label[rd], rs1, (uint32_t)imm); break;
+        case OP_LR_W: snprintf(buf, n, "%-7s %s,(%s)", name, x_label[rd], x_label[rs1]); break;
+        case OP_SC_W: case OP_AMOSWAP_W: case OP_AMOADD_W: case OP_AMOXOR_W: case OP_AMOAND_W: case OP_AMOOR_W:
+        case OP_AMOMIN_W: case OP_AMOMAX_W: case OP_AMOMINU_W: case OP_AMOMAXU_W:
+            snprintf(buf, n, "%-7s %s,%s,(%s)", name, x_label[rd], x_label[rs2], x_label[rs1]); break;
+        case OP_ILLEGAL: case OP_UNKNOWN: snprintf(buf, n, "%-7s 0x%08x", name, d->raw); break;
+        default: snprintf(buf, n, "%s", name); break;
+    }
+}
+
+int poxim_profile(poxim_machine *m, int enable) {
+    size_t bytes = (size_t)(m->mem_size / 2) * sizeof(uint64_t);
+    if (!enable) {
+        if (m->prof_pc) munmap(m->prof_pc, bytes);
+        m->prof_pc = NULL; memset(m->prof_op, 0, sizeof(m->prof_op)); memset(m->prof_taken, 0, sizeof(m->prof_taken));
+        return 1;
+    }
+    if (m->hart_threads) return 0;
+    if (m->prof_pc == NULL && (m->prof_pc = alloc_guest(bytes, 0)) == NULL) return 0;
+    return 1;
+}
+
+typedef struct { uint32_t half, last, len; uint64_t count, weight; } prof_entry_t;   // meias palavras da primeira e da última instrução
+
+// Mantém top[] ordenado por peso decrescente com no máximo 'max' entradas.
+static void prof_insert(prof_entry_t *top, int *n, int max, prof_entry_t e) {
+    if (*n == max && e.weight <= top[max - 1].weight) return;
+    int i = (*n < max) ? (*n)++ : max - 1;
+    for (; i > 0 && top[i - 1].weight < e.weight; i--) top[i] = top[i - 1];
+    top[i] = e;
+}
+
+static void prof_decode(const machine_t *m, uint32_t half, decoded_insn_t *d) {
+    const uint8_t *p = m->memory + (size_t)half * 2;
+    uint32_t raw = p[0] | (p[1] << 8);
+    if ((raw & 3) == 3 && (size_t)half * 2 + 4 <= m->mem_size) raw |= (p[2] << 16) | ((uint32_t)p[3] << 24);
+    decode_any(raw, d);
+}
+
+static double percent(uint64_t part, uint64_t total) { return total ? 100.0 * part / total : 0.0; }
+
+// Blocos básicos são reconstruídos das contagens: instruções consecutivas executadas o mesmo
+// número de vezes, até um desvio, salto ou instrução de sistema. Só as páginas do contador que
+// foram escritas (mincore) são percorridas, então o custo não depende de --mem-size.
+void poxim_profile_report(const poxim_machine *m, FILE *out, int top) {
+    if (m->prof_pc == NULL || top <= 0) return;
+    uint64_t total = 0, by_class[CLASS_COUNT] = { 0 }, taken = 0, branches = 0;
+    for (int op = 0; op <= OP_UNKNOWN; op++) {
+        total += m->prof_op[op]; by_class[op_class(op)] += m->prof_op[op];
+        if (op >= OP_BEQ && op <= OP_BGEU) { branches += m->prof_op[op]; taken += m->prof_taken[op]; }
+    }
+    fprintf(out, "Perfil: %llu instruções\n\nMix por classe:\n", (unsigned long long)total);
+    for (int c = 0; c < CLASS_COUNT; c++) if (by_class[c]) fprintf(out, "  %-10s %14llu %6.2f%%\n", class_name[c], (unsigned long long)by_class[c], percent(by_class[c], total));
+
+    fprintf(out, "\nMix por instrução:\n");
+    int order[OP_UNKNOWN + 1], n_ops = 0;
+    for (int op = 0; op <= OP_UNKNOWN; op++) {
+        if (!m->prof_op[op]) continue;
+        int i = n_ops++;
+        for (; i > 0 && m->prof_op[order[i - 1]] < m->prof_op[op]; i--) order[i] = order[i - 1];
+        order[i] = op;
+    }
+    for (int i = 0; i < n_ops; i++) fprintf(out, "  %-10s %14llu %6.2f%%\n", op_name[order[i]], (unsigned long long)m->prof_op[order[i]], percent(m->prof_op[order[i]], total));
+
+    fprintf(out, "\nDesvios condicionais: %llu tomados, %llu não tomados (%.2f%% tomados)\n", (unsigned long long)taken, (unsigned long long)(branches - taken), percent(taken, branches));
+    for (int op = OP_BEQ; op <= OP_BGEU; op++) {
+        if (m->prof_op[op]) fprintf(out, "  %-10s %14llu tomados %14llu não tomados\n", op_name[op], (unsigned long long)m->prof_taken[op], (unsigned long long)(m->prof_op[op] - m->prof_taken[op]));
+    }
+
+    prof_entry_t *pcs = calloc(top, sizeof(prof_entry_t)), *blocks = calloc(top, sizeof(prof_entry_t));
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), bytes = (size_t)(m->mem_size / 2) * sizeof(uint64_t), n_pages = (bytes + page - 1) / page;
+    unsigned char *resident = malloc(n_pages);
+    if (pcs == NULL || blocks == NULL || resident == NULL) { free(pcs); free(blocks); free(resident); return; }
+    if (mincore(m->prof_pc, bytes, resident) != 0) memset(resident, 1, n_pages);
+    int n_pcs = 0, n_blocks = 0, block_open = 0;
+    prof_entry_t block = { 0 }; uint32_t next = 0; int last_ends = 0;
+    size_t halves_per_page = page / sizeof(uint64_t), halves = m->mem_size / 2;
+    for (size_t p = 0; p < n_pages; p++) {
+        if (!(resident[p] & 1)) continue;
+        for (size_t h = p * halves_per_page; h < (p + 1) * halves_per_page && h < halves; h++) {
+            uint64_t c = m->prof_pc[h];
+            if (!c) continue;
+            prof_insert(pcs, &n_pcs, top, (prof_entry_t){ (uint32_t)h, (uint32_t)h, 1, c, c });
+            if (!block_open || h != next || c != block.count || last_ends) {
+                if (block_open) { block.weight = block.count * block.len; prof_insert(blocks, &n_blocks, top, block); }
+                block = (prof_entry_t){ (uint32_t)h, (uint32_t)h, 0, c, 0 }; block_open = 1;
+            }
+            decoded_insn_t d; prof_decode(m, (uint32_t)h, &d);
+            block.len++; block.last = (uint32_t)h; next = (uint32_t)h + insn_length(d.raw) / 2; last_ends = op_ends_block(d.op);
+        }
+    }
+    if (block_open) { block.weight = block.count * block.len; prof_insert(blocks, &n_blocks, top, block); }
+
+    char text[64]; decoded_insn_t d;
+    fprintf(out, "\nPCs mais executados:\n");
+    for (int i = 0; i < n_pcs; i++) {
+        prof_decode(m, pcs[i].half, &d); disassemble(&d, text, sizeof text);
+        fprintf(out, "  0x%08x %14llu %6.2f%%  %s\n", RAM_BASE + pcs[i].half * 2, (unsigned long long)pcs[i].count, percent(pcs[i].count, total), text);
+    }
+    fprintf(out, "\nBlocos básicos mais executados:\n");
+    for (int i = 0; i < n_blocks; i++) {
+        prof_entry_t *b = &blocks[i];
+        fprintf(out, "  0x%08x-0x%08x %llu vezes x %u instruções = %llu (%.2f%%)\n", RAM_BASE + b->half * 2, RAM_BASE + b->last * 2,
+                (unsigned long long)b->count, b->len, (unsigned long long)b->weight, percent(b->weight, total));
+        for (uint32_t h = b->half; h <= b->last; h += insn_length(d.raw) / 2) {
+            prof_decode(m, h, &d); disassemble(&d, text, sizeof text);
+            fprintf(out, "      0x%08x: %s\n", RAM_BASE + h * 2, text);
+        }
+    }
+    free(pcs); free(blocks); free(resident);
+}
+
+// --- Relatório de cache ---
+static const char *cache_level_name[CACHE_LEVELS] = { "L1I", "L1D", "L2" };
+static const char *cache_policy_name[] = { "LRU", "FIFO", "aleatória" };
+
+static void cache_report_pcs(const poxim_machine *m, FILE *out, int top, int data) {
+    const cache_sim_t *c = m->cache;
+    prof_entry_t *pcs = calloc(top, sizeof(prof_entry_t));
+    size_t page = (size_t)sysconf(_SC_PAGESIZE), bytes = (size_t)(m->mem_size / 2) * sizeof(cache_pc_t), n_pages = (bytes + page - 1) / page;
+    unsigned char *resident = malloc(n_pages);
+    if (pcs == NULL || resident == NULL) { free(pcs); free(resident); return; }
+    if (mincore(c->per_pc, bytes, resident) != 0) memset(resident, 1, n_pages);
+    int n_pcs = 0; size_t h = 0;   // uma entrada pode cruzar duas páginas: cada uma é vista uma vez
+    for (size_t p = 0; p < n_pages; p++) {
+        if (!(resident[p] & 1)) continue;
+        if (h < p * page / sizeof(cache_pc_t)) h = p * page / sizeof(cache_pc_t);
+        for (; h < ((p + 1) * page + sizeof(cache_pc_t) - 1) / sizeof(cache_pc_t) && h < m->mem_size / 2; h++) {
+            const cache_count_t *n = data ? &c->per_pc[h].data : &c->per_pc[h].fetch;
+            if (n->misses) prof_insert(pcs, &n_pcs, top, (prof_entry_t){ (uint32_t)h, (uint32_t)h, 1, data ? c->per_pc[h].data_accesses : c->fetches[h], n->misses });
+        }
+    }
+    fprintf(out, "\nPCs com mais misses na %s:\n", data ? "L1D" : "L1I");
+    fprintf(out, "  %-10s %14s %14s %14s %8s %14s\n", "pc", "acessos", "acertos", "misses", "taxa", "evicções");
+    char text[64]; decoded_insn_t d;
+    for (int i = 0; i < n_pcs; i++) {
+        const cache_count_t *n = data ? &c->per_pc[pcs[i].half].data : &c->per_pc[pcs[i].half].fetch;
+        uint64_t accesses = pcs[i].count;
+        prof_decode(m, pcs[i].half, &d); disassemble(&d, text, sizeof text);
+        fprintf(out, "  0x%08x %14llu %14llu %14llu %7.2f%% %14llu  %s\n", RAM_BASE + pcs[i].half * 2, (unsigned long long)accesses,
+                (unsigned long long)(accesses - n->misses), (unsigned long long)n->misses, percent(n->misses, accesses), (unsigned long long)n->evictions, text);
+    }
+    free(pcs); free(resident);
+}
+
+// Totais por nível e os 'top' PCs com mais misses na L1I e na L1D. Um acesso que cruza uma
+// linha conta como dois nos totais do nível e como um na instrução.
+void poxim_cache_report(const poxim_machine *m, FILE *out, int top) {
+    const cache_sim_t *c = m->cache;
+    if (c == NULL) return;
+    fprintf(out, "Cache:\n  %-5s %10s %6s %5s %-10s %14s %14s %14s %8s %14s %14s\n", "nível", "tamanho", "linha", "vias", "política", "acessos", "acertos", "misses", "taxa", "evicções", "write-backs");
+    for (int i = 0; i < CACHE_LEVELS; i++) {
+        const cache_level_t *l = &c->level[i];
+        if (i == CACHE_L2 && !c->has_l2) continue;
+        fprintf(out, "  %-5s %10u %6u %5u %-10s %14llu %14llu %14llu %7.2f%% %14llu %14llu\n", cache_level_name[i], l->cfg.size, l->cfg.line, l->cfg.ways, cache_policy_name[l->cfg.policy],
+                (unsigned long long)l->accesses, (unsigned long long)(l->accesses - l->misses), (unsigned long long)l->misses, percent(l->misses, l->accesses),
+                (unsigned long long)l->evictions, (unsigned long long)l->writebacks);
+    }
+    if (top <= 0) return;
+    cache_report_pcs(m, out, top, 0);
+    cache_report_pcs(m, out, top, 1);
+}
+
+// --- Relatório do modelo de tempo ---
+static const char *predictor_name[] = { "estático (para trás tomado)", "bimodal", "gshare" };
+static const char *stall_name[STALL_CAUSES] = { "load-use", "mul", "div", "desvio mal predito", "desvio tomado", "jal", "jalr", "trap/mret" };
+
+void poxim_timing_report(const poxim_machine *m, FILE *out) {
+    const timing_model_t *t = m->timing;
+    if (t == NULL) return;
+    uint64_t stalls = 0;
+    for (int i = 0; i < STALL_CAUSES; i++) stalls += t->stalls[i];
+    uint64_t cycles = t->insns + stalls;
+    double insns = t->insns ? (double)t->insns : 1.0;
+    fprintf(out, "Modelo de tempo: pipeline de 5 estágios, preditor %s", predictor_name[t->cfg.predictor]);
+    if (t->cfg.predictor != POXIM_PREDICT_STATIC) fprintf(out, " (%u entradas)", t->mask + 1);
+    fprintf(out, ", mul %d ciclos, div %d ciclos\n", t->cfg.mul_latency, t->cfg.div_latency);
+    fprintf(out, "Instruções: %llu\nCiclos: %llu (CPI %.3f, sem os ciclos pulados em wfi)\n", (unsigned long long)t->insns, (unsigned long long)cycles, cycles / insns);
+    fprintf(out, "\nComposição do CPI:\n  %-20s %8.3f %14llu ciclos\n", "base", t->insns ? 1.0 : 0.0, (unsigned long long)t->insns);
+    for (int i = 0; i < STALL_CAUSES; i++) fprintf(out, "  %-20s %8.3f %14llu ciclos\n", stall_name[i], t->stalls[i] / insns, (unsigned long long)t->stalls[i]);
+    fprintf(out, "\nDesvios condicionais: %llu, %llu mal preditos (acerto de %.2f%%)\n", (unsigned long long)t->branches, (unsigned long long)t->mispredicts,
+            percent(t->branches - t->mispredicts, t->branches));
+}
+
+// --- Autoperfil do simulador ---
+int poxim_self_profile_report(const poxim_machine *m, FILE *out) {
+#if POXIM_SELF_PROFILE
+    if (out) selfprof_json(out, m->selfprof, m->n_harts);
+    return 1;
+#else
+    (void)m; (void)out;
+    return 0;
+#endif
+}
+
+// --- Estado dos harts e da RAM ---
+int poxim_harts(const poxim_machine *m) { return m->n_harts; }
+int poxim_hart(const poxim_machine *m) { return m->cur_hart; }
+uint32_t poxim_get_reg(const poxim_machine *m, int hart, int reg) { return m->harts[hart].registers[reg & 31]; }
+void poxim_set_reg(poxim_machine *m, int hart, int reg, uint32_t value) { if (reg & 31) m->harts[hart].registers[reg & 31] = value; }
+uint32_t poxim_get_pc(const poxim_machine *m, int hart) { return m->harts[hart].pc; }
+void poxim_set_pc(poxim_machine *m, int hart, uint32_t value) { m->harts[hart].pc = value; }
+uint32_t poxim_get_csr(const poxim_machine *m, int hart, uint32_t csr) {
+    const hart_t *h = &m->harts[hart]; csr %= CSR_COUNT;
+    return csr_is_counter(csr) ? counter_csr_get(h->csrs, h->instret, h->wfi_skipped, h->hpm_events, csr) : h->csrs[csr];
+}
+// Uma escrita em CSR pode mudar as interrupções pendentes: o hart as reavalia na próxima instrução.
+void poxim_set_csr(poxim_machine *m, int hart, uint32_t csr, uint32_t value) {
+    hart_t *h = &m->harts[hart]; csr %= CSR_COUNT;
+    if (csr_is_counter(csr)) h->hpm_active = counter_csr_set(h->csrs, h->instret, h->wfi_skipped, h->hpm_events, csr, value);
+    else h->csrs[csr] = value;
+    h->irq_dirty = 1;
+}
+
+uint64_t poxim_instret(const poxim_machine *m, int hart) {
+    if (hart >= 0) return m->harts[hart].instret;
+    uint64_t total = 0;
+    for (int h = 0; h < m->n_harts; h++) total += m->harts[h].instret;
+    return total;
+}
+
+static int ram_range(const machine_t *m, uint32_t addr, uint32_t len) { return addr >= RAM_BASE && addr - RAM_BASE <= m->mem_size && len <= m->mem_size - (addr - RAM_BASE); }
+
+int poxim_peek(const poxim_machine *m, uint32_t addr, void *buf, uint32_t len) {
+    if (!ram_range(m, addr, len)) return 0;
+    memcpy(buf, m->memory + (addr - RAM_BASE), len);
+    return 1;
+}
+
+// Como um store do guest: marca as páginas escritas e invalida as instruções pré-decodificadas.
+int poxim_poke(poxim_machine *m, uint32_t addr, const void *buf, uint32_t len) {
+    if (!ram_range(m, addr, len)) return 0;
+    if (len == 0) return 1;
+    uint32_t index = addr - RAM_BASE;
+    memcpy(m->memory + index, buf, len);
+    resv_drop(m, index, len);
+    if (m->page_dirty) memset(m->page_dirty + (index >> PAGE_SHIFT), 1, ((index + len - 1) >> PAGE_SHIFT) - (index >> PAGE_SHIFT) + 1);
+    if (m->icache) {
+        if (!machine_enter(m)) return 0;
+        if (len > (1u << PAGE_SHIFT)) icache_flush(); else invalidate_decoded(index, (int)len);
+        machine_leave();
+    }
+    return 1;
+}
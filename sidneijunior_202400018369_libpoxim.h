@@ -0,0 +1,161 @@
+#ifndef SIDNEIJUNIOR_202400018369_LIBPOXIM_H
+#define SIDNEIJUNIOR_202400018369_LIBPOXIM_H
+
+// libpoxim: o simulador RV32IMA do V2 como biblioteca. Cada poxim_machine é uma instância
+// independente (RAM, dispositivos, harts, saídas); um processo pode criar quantas quiser e
+// executá-las em threads diferentes (uma máquina só é executada por um thread de cada vez).
+// O poximv2 é uma interface de linha de comando sobre esta API.
+//
+//   gcc -O2 -pthread -c sidneijunior_202400018369_libpoxim.c && ar rcs libpoxim.a sidneijunior_202400018369_libpoxim.o
+//   gcc -O2 -pthread -fPIC -shared -o libpoxim.so sidneijunior_202400018369_libpoxim.c
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define POXIM_RAM_BASE     0x80000000u
+#define POXIM_MEM_SIZE_MAX 0x80000000u
+#define POXIM_MAX_HARTS    16
+
+typedef struct poxim_machine poxim_machine;
+typedef struct poxim_image poxim_image;
+
+typedef struct {
+    uint32_t mem_size;   // bytes de RAM a partir de POXIM_RAM_BASE, múltiplo de 4 KiB (0: 1 MiB)
+    int harts;           // 1 a POXIM_MAX_HARTS (0: 1)
+    int threads;         // poxim_run executa cada hart numa thread do host (sem trace)
+    int jit;             // tradução para x86-64 enquanto não houver trace
+    int huge_pages;      // transparent huge pages para a RAM
+    int track_dirty;     // registra as páginas escritas (exigido por poxim_save_snapshot)
+    int no_superblocks;  // sem trace, interpreta instrução a instrução em vez de usar superblocos
+} poxim_config;
+
+// Motivo de retorno de poxim_run. Em POXIM_EBREAK o pc já aponta a instrução seguinte ao ebreak.
+enum { POXIM_LIMIT = 0, POXIM_EBREAK, POXIM_PC_ZERO, POXIM_NULL_INSN, POXIM_EXIT, POXIM_ERROR = -1 };   // POXIM_EXIT: exit do semihosting
+
+// Saídas e entrada da máquina. Nenhuma é obrigatória; sem POXIM_INPUT a UART lê EOF.
+enum { POXIM_TRACE = 0, POXIM_BINARY_TRACE, POXIM_TERMINAL, POXIM_CONSOLE, POXIM_INPUT, POXIM_STREAMS };
+
+poxim_machine *poxim_create(const poxim_config *cfg);
+void poxim_destroy(poxim_machine *m);
+
+// Carrega .hex, ELF32 RISC-V ou imagem crua (raw != 0, em load_addr); todos os harts vão para o ponto de entrada.
+int poxim_load(poxim_machine *m, const char *path, uint32_t load_addr, int raw);
+
+// Imagem carregada uma vez e compartilhada: cada máquina recebe uma cópia copy-on-write da RAM.
+poxim_image *poxim_image_open(const char *path, uint32_t mem_size, uint32_t load_addr, int raw);
+int poxim_load_image(poxim_machine *m, const poxim_image *img);
+void poxim_image_close(poxim_image *img);
+
+// Snapshots (formato do --save-snapshot). poxim_snapshot_mem_size devolve 0 se o arquivo for inválido.
+uint32_t poxim_snapshot_mem_size(const char *path);
+int poxim_save_snapshot(poxim_machine *m, const char *path);
+int poxim_restore_snapshot(poxim_machine *m, const char *path);
+
+// Executa até n instruções (somadas entre os harts; UINT64_MAX: até parar). Devolve POXIM_LIMIT
+// se o limite foi atingido ou o motivo da parada; depois de parada a máquina devolve sempre o mesmo.
+// Com threads, n é ignorado e a execução vai até a parada.
+int poxim_run(poxim_machine *m, uint64_t n);
+static inline int poxim_step(poxim_machine *m) { return poxim_run(m, 1); }
+
+// Janela de trace: abre após start_icount instruções ou quando o pc chegar em start_pc
+// (start_at_pc != 0) e fecha depois de 'window' instruções. Sem chamada, o trace é contínuo.
+void poxim_set_trace_window(poxim_machine *m, uint64_t start_icount, uint32_t start_pc, int start_at_pc, uint64_t window);
+// Salva um snapshot em 'path' quando o hart chegar em icount instruções ou em pc (at_pc != 0).
+int poxim_snapshot_at(poxim_machine *m, const char *path, uint64_t icount, uint32_t pc, int at_pc);
+
+// poxim_set_file associa um FILE* do chamador (não é fechado pela biblioteca; NULL desliga);
+// poxim_set_sink, só para as saídas, chama fn com os bytes escritos. POXIM_CONSOLE recebe a
+// saída da UART sem buffer (o que o CLI mostra em stdout).
+typedef void (*poxim_write_fn)(void *ctx, const char *data, size_t len);
+int poxim_set_file(poxim_machine *m, int stream, FILE *f);
+int poxim_set_sink(poxim_machine *m, int stream, poxim_write_fn fn, void *ctx);
+
+// Perfil de execução: conta cada instrução por pc e por op e os desvios tomados (o JIT fica
+// desligado enquanto estiver ativo; não funciona com threads). Desligar descarta as contagens.
+// O relatório traz o mix de instruções, os desvios e os 'top' PCs e blocos básicos mais executados.
+int poxim_profile(poxim_machine *m, int enable);
+void poxim_profile_report(const poxim_machine *m, FILE *out, int top);
+
+// Simulador de cache: L1I e L1D associativas por conjunto e uma L2 unificada opcional (write-back,
+// write-allocate). Cada busca de instrução e cada acesso de dados à RAM passa pelo modelo, que
+// não muda a execução; o JIT fica desligado enquanto ele estiver ativo e não funciona com threads.
+// Devolve 0 se a configuração for inválida: linha potência de 2 (>= 4 bytes) e size/(line*ways)
+// conjuntos, também potência de 2. NULL desliga e descarta as contagens. O relatório traz, por
+// nível, acessos, acertos, misses, evicções e write-backs, e os 'top' PCs com mais misses.
+enum { POXIM_CACHE_LRU = 0, POXIM_CACHE_FIFO, POXIM_CACHE_RANDOM };
+typedef struct { uint32_t size, line, ways; int policy; } poxim_cache_level;   // bytes, bytes por linha, vias
+typedef struct { poxim_cache_level l1i, l1d, l2; } poxim_cache_config;         // l2.size = 0: sem L2
+int poxim_cache(poxim_machine *m, const poxim_cache_config *cfg);
+void poxim_cache_report(const poxim_machine *m, FILE *out, int top);
+
+// Modelo de tempo: pipeline de 5 estágios com bolhas de load-use, latências de mul/div e um
+// preditor de desvios (estático, bimodal ou gshare com 2^table_bits contadores). Cada instrução
+// custa um ciclo mais as bolhas, e mtime/mcycle do guest seguem os ciclos do modelo (sem ele, um
+// ciclo por instrução). O JIT e os superblocos ficam desligados; não funciona com threads.
+// Devolve 0 se a configuração for inválida; NULL desliga. O relatório traz a composição do CPI.
+enum { POXIM_PREDICT_STATIC = 0, POXIM_PREDICT_BIMODAL, POXIM_PREDICT_GSHARE };
+typedef struct { int predictor, table_bits, mul_latency, div_latency; } poxim_timing_config;   // latências em ciclos
+int poxim_timing(poxim_machine *m, const poxim_timing_config *cfg);
+void poxim_timing_report(const poxim_machine *m, FILE *out);
+
+// Autoperfil do simulador (só no build com -DPOXIM_SELF_PROFILE=1, ver sidneijunior_202400018369_selfprof.h):
+// ciclos do host gastos por classe de instrução, dispositivo, trace, verificação de interrupções e
+// camada de tradução, somados entre os harts, em JSON. Devolve 0 se a biblioteca foi compilada sem
+// a instrumentação; out NULL só consulta.
+int poxim_self_profile_report(const poxim_machine *m, FILE *out);
+
+// Semihosting: ecall vira chamada de sistema do newlib/libgloss (a7 = read, write, open, openat,
+// close, lseek, fstat, brk ou exit, nos números do Linux RISC-V) servida pelo host, em vez de trap.
+// Os fds 0 a 2 são a entrada e o console da máquina; open só alcança arquivos abaixo de 'root'
+// (caminhos absolutos e ".." são recusados; links só são seguidos se continuarem abaixo de 'root'
+// com openat2, e nunca sem ele). exit para a máquina com POXIM_EXIT e o código em
+// poxim_exit_code. Devolve 0 se o diretório não abrir; NULL desliga e fecha os arquivos abertos.
+int poxim_semihosting(poxim_machine *m, const char *root);
+int poxim_exit_code(const poxim_machine *m);
+
+// Saída assíncrona: o trace textual, o console e o terminal passam a ser formatados e escritos por
+// um thread de escrita, que recebe registros da execução por uma fila circular sem trava e os
+// entrega em blocos grandes. O conteúdo e a ordem de cada saída não mudam; poxim_run só retorna
+// com tudo entregue (e o console esvaziado). As funções de poxim_set_sink passam a ser chamadas
+// pelo thread de escrita. Devolve 0 com threads por hart; 0 desliga.
+int poxim_async_output(poxim_machine *m, int enable);
+
+// Blocos traduzidos antecipadamente pelo poxim-aot (o .c gerado usa sidneijunior_202400018369_aot.h).
+// Cada bloco executa as instruções a partir de 'pc' sobre o estado do hart e devolve o pc seguinte,
+// com as instruções retiradas em *retired. Um acesso fora da RAM alinhada ou um store em código sai
+// do bloco antes da instrução, que o interpretador executa (MMIO passa pelo barramento).
+typedef struct {
+    uint32_t *x;           // registradores do hart
+    uint8_t *ram;          // RAM a partir de POXIM_RAM_BASE
+    uint32_t ram_size;
+    const uint8_t *code;   // uma marca por palavra da RAM com código: um store nela sai do bloco
+    uint8_t *dirty;        // páginas de 4 KiB escritas (NULL sem track_dirty)
+} poxim_aot_ctx;
+typedef uint32_t (*poxim_aot_fn)(poxim_aot_ctx *ctx, uint32_t *retired);
+typedef struct { uint32_t pc, end, insns, offset; poxim_aot_fn fn; } poxim_aot_block;   // código em [pc, end), cópia em code + offset
+typedef struct { const char *source; uint32_t n_blocks; const poxim_aot_block *blocks; const uint8_t *code; } poxim_aot_program;
+
+// Instala os blocos cujo código confere com a RAM carregada e devolve quantos (NULL desinstala).
+// Carregar outro programa ou restaurar um snapshot desinstala; um store no código desliga os
+// blocos que o cobrem. Com trace, perfil, cache, modelo de tempo ou eventos de hpm os blocos não rodam.
+int poxim_aot(poxim_machine *m, const poxim_aot_program *prog);
+
+// Estado dos harts. 'hart' vai de 0 a harts-1; poxim_hart devolve o hart que executava por último.
+// Os CSRs de contador (mcycle, minstret, mhpmcounter*, mcountinhibit, mhpmevent*) têm a mesma
+// semântica que para o guest.
+int poxim_harts(const poxim_machine *m);
+int poxim_hart(const poxim_machine *m);
+uint32_t poxim_get_reg(const poxim_machine *m, int hart, int reg);
+void poxim_set_reg(poxim_machine *m, int hart, int reg, uint32_t value);
+uint32_t poxim_get_pc(const poxim_machine *m, int hart);
+void poxim_set_pc(poxim_machine *m, int hart, uint32_t pc);
+uint32_t poxim_get_csr(const poxim_machine *m, int hart, uint32_t csr);
+void poxim_set_csr(poxim_machine *m, int hart, uint32_t csr, uint32_t value);
+uint64_t poxim_instret(const poxim_machine *m, int hart);   // hart < 0: soma de todos
+
+// Leitura e escrita direta da RAM (sem passar pelo barramento nem gerar trace); 0 fora da RAM.
+int poxim_peek(const poxim_machine *m, uint32_t addr, void *buf, uint32_t len);
+int poxim_poke(poxim_machine *m, uint32_t addr, const void *buf, uint32_t len);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef POXIM_PLATFORM_H
+#define POXIM_PLATFORM_H
+
+// Perfis de plataforma do núcleo (decodificação em sidneijunior_202400018369_isa.h, execução em
+// sidneijunior_202400018369_core.h), escolhidos em tempo de compilação com -DPOXIM_PLATFORM=...:
+//   POXIM_PLATFORM_V2 (padrão, libpoxim): RV32IMAC com fence/fence.i e wfi; trap empilha MIE em
+//     MPIE e mret desempilha; interrupções usam o mtvec vetorizado e só são reavaliadas quando algo
+//     muda (irq_dirty); trace textual e binário.
+//   POXIM_PLATFORM_V1 (POXIMV1): RV32IM; trap e mret não mexem em mstatus, mtvec é só direto e o
+//     laço verifica o timer a cada instrução; fence e atômicas são opcodes desconhecidos e wfi é
+//     ilegal; só trace textual.
+// Os dispositivos (e o barramento) são os do arquivo de cada plataforma. Cada opção abaixo também
+// pode ser trocada sozinha (ex.: -DPOXIM_EXT_M=0 tira a extensão M); o que fica desligado não gera
+// código nem teste em tempo de execução.
+#define POXIM_PLATFORM_V1 1
+#define POXIM_PLATFORM_V2 2
+#ifndef POXIM_PLATFORM
+#define POXIM_PLATFORM POXIM_PLATFORM_V2
+#endif
+
+#if POXIM_PLATFORM == POXIM_PLATFORM_V2
+#define POXIM_PROFILE_DEFAULT 1
+#elif POXIM_PLATFORM == POXIM_PLATFORM_V1
+#define POXIM_PROFILE_DEFAULT 0
+#else
+#error "POXIM_PLATFORM deve ser POXIM_PLATFORM_V1 ou POXIM_PLATFORM_V2"
+#endif
+
+#ifndef POXIM_EXT_M
+#define POXIM_EXT_M 1                                 // mul/div (as duas plataformas)
+#endif
+#ifndef POXIM_EXT_A
+#define POXIM_EXT_A POXIM_PROFILE_DEFAULT             // lr.w/sc.w e AMOs
+#endif
+#ifndef POXIM_EXT_C
+#define POXIM_EXT_C POXIM_PROFILE_DEFAULT             // mnemônicos c.* no trace (a busca de 16 bits é da libpoxim)
+#endif
+#ifndef POXIM_EXT_ZIFENCEI
+#define POXIM_EXT_ZIFENCEI POXIM_PROFILE_DEFAULT      // fence e fence.i
+#endif
+#ifndef POXIM_WFI
+#define POXIM_WFI POXIM_PROFILE_DEFAULT
+#endif
+#ifndef POXIM_TRAP_STACK
+#define POXIM_TRAP_STACK POXIM_PROFILE_DEFAULT        // MIE/MPIE em mstatus no trap e no mret
+#endif
+#ifndef POXIM_VECTORED_TRAPS
+#define POXIM_VECTORED_TRAPS POXIM_PROFILE_DEFAULT    // mtvec modo 1: interrupção vai para base + 4*causa
+#endif
+#ifndef POXIM_LAZY_IRQ
+#define POXIM_LAZY_IRQ POXIM_PROFILE_DEFAULT          // CSRs e mret marcam irq_dirty
+#endif
+#ifndef POXIM_BIN_TRACE
+#define POXIM_BIN_TRACE POXIM_PROFILE_DEFAULT         // trace_value/trace_addr para o trace binário
+#endif
+#ifndef POXIM_SEMIHOSTING
+#define POXIM_SEMIHOSTING POXIM_PROFILE_DEFAULT       // ecall pergunta antes a semihost_call
+#endif
+
+#endif
@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sidneijunior_202400018369_isa.h"
+#include "sidneijunior_202400018369_libpoxim.h"
+
+// poxim-aot: traduz um programa (.hex, ELF ou .bin, pelo mesmo carregador do simulador) para C,
+// com uma função por bloco básico alcançável a partir do ponto de entrada. O .c gerado é
+// compilado junto com o poximv2 e a libpoxim, e o executável registra os blocos com poxim_aot.
+//
+// A descoberta segue os desvios, os jal, o retorno de cada chamada, os jalr de destino constante
+// (auipc/lui + addi) e o endereço gravado em mtvec. CSRs, ecall, ebreak, mret, wfi, fences,
+// atômicas e instruções inválidas ficam fora dos blocos (o interpretador as executa); um jalr de
+// destino desconhecido sai do bloco e continua no bloco do destino, se houver, ou no interpretador.
+
+#define BLOCK_MAX 64   // instruções por bloco (a cadeia de aot_run para antes da próxima interrupção possível)
+
+static poxim_machine *m;
+static uint32_t mem_size = 1024 * 1024;
+static uint8_t *leader;     // uma marca por meia palavra: começo de bloco
+static uint8_t *visited;    // bloco já explorado
+static uint32_t *worklist; static uint32_t n_work;
+
+static int in_ram(uint32_t a) { return a >= POXIM_RAM_BASE && a - POXIM_RAM_BASE < mem_size && a % 2 == 0; }
+
+// Lê e decodifica a instrução em 'a'; devolve 0 fora da RAM.
+static int fetch(uint32_t a, decoded_insn_t *d) {
+    uint16_t lo, hi;
+    if (!in_ram(a) || !poxim_peek(m, a, &lo, 2)) return 0;
+    uint32_t raw = lo;
+    if ((lo & 3) == 3) { if (!poxim_peek(m, a + 2, &hi, 2)) return 0; raw |= (uint32_t)hi << 16; }
+    decode_any(raw, d);
+    return 1;
+}
+
+static void add_leader(uint32_t a) {
+    if (!in_ram(a)) return;
+    uint32_t i = (a - POXIM_RAM_BASE) >> 1;
+    if (!leader[i]) { leader[i] = 1; worklist[n_work++] = a; }
+}
+
+// Instrução traduzida para C dentro do bloco.
+static int translatable(const decoded_insn_t *d) {
+    if (d->raw == 0) return 0;
+    int c = op_class(d->op);
+    return c == CLASS_ALU || c == CLASS_MULDIV || c == CLASS_LOAD || c == CLASS_STORE || c == CLASS_BRANCH || c == CLASS_JUMP;
+}
+
+// Explora o bloco em 'a' até o primeiro desvio ou instrução não traduzida, acompanhando os
+// registradores de valor constante (lui, auipc, addi) para jalr e escritas em mtvec.
+static void explore(uint32_t a) {
+    uint32_t known = 1, value[32] = { 0 };
+    decoded_insn_t d;
+    while (fetch(a, &d)) {
+        uint32_t next = a + insn_length(d.raw);
+        uint32_t k1 = known >> d.rs1 & 1, v1 = value[d.rs1];
+        int writes = d.rd != 0 && op_class(d.op) != CLASS_BRANCH && op_class(d.op) != CLASS_STORE;
+        if (!translatable(&d)) {
+            if (d.op >= OP_CSRRW && d.op <= OP_CSRRS && d.imm == 0x305 && k1) add_leader(v1);   // mtvec
+            if (d.raw != 0 && d.op != OP_EBREAK && d.op != OP_MRET && op_class(d.op) != CLASS_INVALID) add_leader(next);
+            return;
+        }
+        if (op_class(d.op) == CLASS_BRANCH) { add_leader(a + d.imm); add_leader(next); return; }
+        if (d.op == OP_JAL) { add_leader(a + d.imm); if (d.rd != 0) add_leader(next); return; }
+        if (d.op == OP_JALR) { if (k1) add_leader((v1 + d.imm) & ~1u); if (d.rd != 0) add_leader(next); return; }
+        if (writes) {
+            known &= ~(1u << d.rd);
+            if (d.op == OP_LUI) { value[d.rd] = d.imm; known |= 1u << d.rd; }
+            else if (d.op == OP_AUIPC) { value[d.rd] = a + d.imm; known |= 1u << d.rd; }
+            else if (d.op == OP_ADDI && k1) { value[d.rd] = v1 + d.imm; known |= 1u << d.rd; }
+        }
+        a = next;
+    }
+}
+
+// Expressão C do resultado de uma instrução de ALU ou M.
+static void alu_expr(char *s, uint32_t at, const decoded_insn_t *d) {
+    uint32_t imm = (uint32_t)d->imm; int r1 = d->rs1, r2 = d->rs2;
+    switch (d->op) {
+        case OP_ADDI: sprintf(s, "x[%d] + 0x%08xu", r1, imm); break;
+        case OP_SLLI: sprintf(s, "x[%d] << %u", r1, imm); break;
+        case OP_SLTI: sprintf(s, "(int32_t)x[%d] < %d", r1, d->imm); break;
+        case OP_SLTIU: sprintf(s, "x[%d] < 0x%08xu", r1, imm); break;
+        case OP_XORI: sprintf(s, "x[%d] ^ 0x%08xu", r1, imm); break;
+        case OP_SRLI: sprintf(s, "x[%d] >> %u", r1, imm); break;
+        case OP_SRAI: sprintf(s, "(uint32_t)((int32_t)x[%d] >> %u)", r1, imm); break;
+        case OP_ORI: sprintf(s, "x[%d] | 0x%08xu", r1, imm); break;
+        case OP_ANDI: sprintf(s, "x[%d] & 0x%08xu", r1, imm); break;
+        case OP_ADD: sprintf(s, "x[%d] + x[%d]", r1, r2); break;
+        case OP_SUB: sprintf(s, "x[%d] - x[%d]", r1, r2); break;
+        case OP_SLL: sprintf(s, "x[%d] << (x[%d] & 31)", r1, r2); break;
+        case OP_SLT: sprintf(s, "(int32_t)x[%d] < (int32_t)x[%d]", r1, r2); break;
+        case OP_SLTU: sprintf(s, "x[%d] < x[%d]", r1, r2); break;
+        case OP_XOR: sprintf(s, "x[%d] ^ x[%d]", r1, r2); break;
+        case OP_SRL: sprintf(s, "x[%d] >> (x[%d] & 31)", r1, r2); break;
+        case OP_SRA: sprintf(s, "(uint32_t)((int32_t)x[%d] >> (x[%d] & 31))", r1, r2); break;
+        case OP_OR: sprintf(s, "x[%d] | x[%d]", r1, r2); break;
+        case OP_AND: sprintf(s, "x[%d] & x[%d]", r1, r2); break;
+        case OP_MUL: sprintf(s, "x[%d] * x[%d]", r1, r2); break;
+        case OP_LUI: sprintf(s, "0x%08xu", imm); break;
+        case OP_AUIPC: sprintf(s, "0x%08xu", at + imm); break;
+        default: sprintf(s, "aot_%s(x[%d], x[%d])", op_name[d->op], r1, r2); break;   // mulh, mulhsu, mulhu, div, divu, rem, remu
+    }
+}
+
+// Operandos da instrução para o comentário do código gerado.
+static void operands(char *s, const decoded_insn_t *d) {
+    const char *rd = x_label[d->rd], *rs1 = x_label[d->rs1], *rs2 = x_label[d->rs2];
+    switch (op_class(d->op)) {
+        case CLASS_LOAD: sprintf(s, "%s,%d(%s)", rd, d->imm, rs1); break;
+        case CLASS_STORE: sprintf(s, "%s,%d(%s)", rs2, d->imm, rs1); break;
+        case CLASS_BRANCH: sprintf(s, "%s,%s,%d", rs1, rs2, d->imm); break;
+        case CLASS_JUMP: if (d->op == OP_JAL) sprintf(s, "%s,%d", rd, d->imm); else sprintf(s, "%s,%d(%s)", rd, d->imm, rs1); break;
+        default:
+            if (d->op == OP_LUI || d->op == OP_AUIPC) sprintf(s, "%s,0x%05x", rd, (uint32_t)d->imm >> 12);
+            else if (d->op >= OP_ADD) sprintf(s, "%s,%s,%s", rd, rs1, rs2);
+            else sprintf(s, "%s,%s,%d", rd, rs1, d->imm);
+            break;
+    }
+}
+
+// Emite a função do bloco em 'a' e devolve quantos bytes de código ela cobre.
+static uint32_t emit_block(FILE *out, uint32_t a, uint32_t *insns) {
+    static const char *cond[] = { [OP_BEQ] = "x[%d] == x[%d]", [OP_BNE] = "x[%d] != x[%d]", [OP_BLT] = "(int32_t)x[%d] < (int32_t)x[%d]",
+                                  [OP_BGE] = "(int32_t)x[%d] >= (int32_t)x[%d]", [OP_BLTU] = "x[%d] < x[%d]", [OP_BGEU] = "x[%d] >= x[%d]" };
+    static const char *load[] = { [OP_LB] = "(uint32_t)(int32_t)(int8_t)*h", [OP_LH] = "aot_lh(h)", [OP_LW] = "aot_lw(h)", [OP_LBU] = "*h", [OP_LHU] = "aot_lhu(h)" };
+    static const char *store[] = { [OP_SB] = "*h = (uint8_t)x[%d]", [OP_SH] = "aot_sh(h, x[%d])", [OP_SW] = "aot_sw(h, x[%d])" };
+    static const int size[] = { [OP_LB] = 1, [OP_LH] = 2, [OP_LW] = 4, [OP_LBU] = 1, [OP_LHU] = 2, [OP_SB] = 1, [OP_SH] = 2, [OP_SW] = 4 };
+    uint32_t start = a, n = 0;
+    char s[96], c[64];
+    decoded_insn_t d;
+    fprintf(out, "static uint32_t b_%08x(poxim_aot_ctx *c, uint32_t *retired) {\n    uint32_t *restrict x = c->x; (void)x;\n", a);
+    while (n < BLOCK_MAX && fetch(a, &d) && translatable(&d) && (a == start || !leader[(a - POXIM_RAM_BASE) >> 1])) {
+        uint32_t next = a + insn_length(d.raw); int cls = op_class(d.op);
+        operands(s, &d); fprintf(out, "    // 0x%08x: %s %s\n", a, op_name[d.op], s);
+        if (cls == CLASS_ALU || cls == CLASS_MULDIV) {
+            if (d.rd != 0 && d.op != OP_NOP) { alu_expr(s, a, &d); fprintf(out, "    x[%d] = %s;\n", d.rd, s); }
+        } else if (cls == CLASS_LOAD) {
+            fprintf(out, "    { const uint8_t *h = aot_load(c, x[%d] + 0x%08xu, %d); if (!h) AOT_EXIT(%u, 0x%08xu);", d.rs1, (uint32_t)d.imm, size[d.op], n, a);
+            if (d.rd != 0) fprintf(out, " x[%d] = %s;", d.rd, load[d.op]);
+            fprintf(out, " }\n");
+        } else if (cls == CLASS_STORE) {
+            sprintf(s, store[d.op], d.rs2);
+            fprintf(out, "    { uint8_t *h = aot_store(c, x[%d] + 0x%08xu, %d); if (!h) AOT_EXIT(%u, 0x%08xu); %s; }\n", d.rs1, (uint32_t)d.imm, size[d.op], n, a, s);
+        } else if (cls == CLASS_BRANCH) {
+            sprintf(c, cond[d.op], d.rs1, d.rs2);
+            fprintf(out, "    *retired = %u; return %s ? 0x%08xu : 0x%08xu;\n}\n\n", n + 1, c, a + d.imm, next);
+            *insns = n + 1; return next - start;
+        } else if (d.op == OP_JAL) {
+            if (d.rd != 0) fprintf(out, "    x[%d] = 0x%08xu;\n", d.rd, next);
+            fprintf(out, "    *retired = %u; return 0x%08xu;\n}\n\n", n + 1, a + d.imm);
+            *insns = n + 1; return next - start;
+        } else {
+            fprintf(out, "    { uint32_t t = (x[%d] + 0x%08xu) & ~1u;", d.rs1, (uint32_t)d.imm);
+            if (d.rd != 0) fprintf(out, " x[%d] = 0x%08xu;", d.rd, next);
+            fprintf(out, " *retired = %u; return t; }\n}\n\n", n + 1);
+            *insns = n + 1; return next - start;
+        }
+        a = next; n++;
+    }
+    if (n == BLOCK_MAX && in_ram(a)) leader[(a - POXIM_RAM_BASE) >> 1] = 1;   // o resto vira outro bloco
+    fprintf(out, "    *retired = %u; return 0x%08xu;\n}\n\n", n, a);
+    *insns = n; return a - start;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t load_addr = POXIM_RAM_BASE, entry = 0; int raw = 0, has_entry = 0;
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        if (strcmp(argv[i], "--mem-size") == 0 && i + 1 < argc) mem_size = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--load-addr") == 0 && i + 1 < argc) { load_addr = (uint32_t)strtoul(argv[++i], NULL, 16); raw = 1; }
+        else if (strcmp(argv[i], "--entry") == 0 && i + 1 < argc) { entry = (uint32_t)strtoul(argv[++i], NULL, 16); has_entry = 1; }
+        else break;
+    }
+    if (argc - i != 2) {
+        fprintf(stderr, "Uso: %s [--mem-size BYTES] [--load-addr ADDR] [--entry ADDR] <programa> <saida.c>\n", argv[0]);
+        fprintf(stderr, "     gcc -O2 -pthread -o prog saida.c sidneijunior_202400018369_poximv2.c sidneijunior_202400018369_libpoxim.c\n");
+        return 1;
+    }
+    const char *prog = argv[i], *out_path = argv[i + 1];
+    poxim_config cfg = { .mem_size = mem_size, .harts = 1 };
+    if ((m = poxim_create(&cfg)) == NULL) { perror("Erro ao criar a máquina"); return 1; }
+    if (!poxim_load(m, prog, load_addr, raw)) return 1;
+    if (!has_entry) entry = poxim_get_pc(m, 0);
+    leader = calloc(mem_size / 2, 1); visited = calloc(mem_size / 2, 1); worklist = malloc((size_t)(mem_size / 2) * sizeof(uint32_t));
+    if (leader == NULL || visited == NULL || worklist == NULL) { perror("Erro de memória"); return 1; }
+
+    // Descoberta: cada começo de bloco é explorado uma vez e acrescenta os seus sucessores.
+    add_leader(entry);
+    while (n_work > 0) {
+        uint32_t a = worklist[--n_work], idx = (a - POXIM_RAM_BASE) >> 1;
+        if (!visited[idx]) { visited[idx] = 1; explore(a); }
+    }
+
+    FILE *out = fopen(out_path, "w");
+    if (out == NULL) { perror(out_path); return 1; }
+    fprintf(out, "// Gerado pelo poxim-aot a partir de %s (entrada 0x%08x). Não editar.\n#include \"sidneijunior_202400018369_aot.h\"\n\n", prog, entry);
+    uint32_t n_blocks = 0, code_size = 0, total_insns = 0, capacity = 0;
+    uint32_t *pcs = NULL;   // pc, bytes e instruções de cada bloco emitido
+    for (uint32_t idx = 0; idx < mem_size / 2; idx++) {
+        if (!leader[idx]) continue;
+        uint32_t a = POXIM_RAM_BASE + idx * 2, insns, bytes;
+        decoded_insn_t d;
+        if (!fetch(a, &d) || !translatable(&d)) continue;   // instrução que fica para o interpretador
+        if (n_blocks == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            if ((pcs = realloc(pcs, (size_t)capacity * 3 * sizeof(uint32_t))) == NULL) { perror("Erro de memória"); return 1; }
+        }
+        bytes = emit_block(out, a, &insns);
+        pcs[3 * n_blocks] = a; pcs[3 * n_blocks + 1] = bytes; pcs[3 * n_blocks + 2] = insns;
+        n_blocks++; code_size += bytes; total_insns += insns;
+    }
+
+    // Cópia do código de cada bloco: poxim_aot só instala os que conferem com a RAM carregada.
+    fprintf(out, "static const uint8_t code[%u] = {", code_size ? code_size : 1);
+    for (uint32_t b = 0, k = 0; b < n_blocks; b++) {
+        uint8_t buf[BLOCK_MAX * 4];
+        poxim_peek(m, pcs[3 * b], buf, pcs[3 * b + 1]);
+        for (uint32_t j = 0; j < pcs[3 * b + 1]; j++, k++) fprintf(out, "%s0x%02x,", k % 16 ? " " : "\n    ", buf[j]);
+    }
+    fprintf(out, "\n};\n\nstatic const poxim_aot_block blocks[%u] = {\n", n_blocks ? n_blocks : 1);
+    for (uint32_t b = 0, offset = 0; b < n_blocks; offset += pcs[3 * b + 1], b++)
+        fprintf(out, "    { 0x%08xu, 0x%08xu, %u, %u, b_%08x },\n", pcs[3 * b], pcs[3 * b] + pcs[3 * b + 1], pcs[3 * b + 2], offset, pcs[3 * b]);
+    fprintf(out, "};\n\nconst poxim_aot_program poxim_aot_generated = { \"%s\", %u, blocks, code };\n", prog, n_blocks);
+    if (fclose(out) != 0) { perror(out_path); return 1; }
+    printf("%s: %u blocos, %u instruções, %u bytes de código\n", out_path, n_blocks, total_insns, code_size);
+    poxim_destroy(m);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sidneijunior_202400018369_isa.h"
+#include "sidneijunior_202400018369_trace.h"
+
+// poxim-trace: converte o trace binário (--binary-trace) no .out textual do simulador.
+// As linhas são formatadas por bt_format_insn (sidneijunior_202400018369_trace.h) sobre uma
+// cópia dos registradores, atualizada com o valor de rd gravado em cada registro.
+
+#define READ_BUFFER_SIZE (1 << 20)
+
+FILE *in_file = NULL;
+uint8_t in_buf[READ_BUFFER_SIZE];
+size_t in_len = 0, in_pos = 0;
+
+uint32_t x[32];
+uint32_t cache_pc[BT_CACHE_SIZE];
+uint32_t cache_raw[BT_CACHE_SIZE];
+
+int read_byte(void) {
+    if (in_pos == in_len) {
+        in_len = fread(in_buf, 1, READ_BUFFER_SIZE, in_file);
+        in_pos = 0;
+        if (in_len == 0) return EOF;
+    }
+    return in_buf[in_pos++];
+}
+
+uint32_t read_u32(void) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)read_byte() << (8 * i);
+    return v;
+}
+
+uint32_t read_varint(void) {
+    uint32_t v = 0; int shift = 0, b;
+    do { b = read_byte(); if (b == EOF) return v; v |= (uint32_t)(b & 0x7F) << shift; shift += 7; } while (b & 0x80);
+    return v;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) { fprintf(stderr, "Uso: %s <trace.bin> <arquivo.out>\n", argv[0]); return 1; }
+    in_file = fopen(argv[1], "rb"); if (in_file == NULL) { perror("Erro ao abrir trace binário"); return 1; }
+    FILE *out = fopen(argv[2], "w"); if (out == NULL) { perror("Erro ao criar arquivo .out"); fclose(in_file); return 1; }
+    static char out_buf[READ_BUFFER_SIZE];
+    setvbuf(out, out_buf, _IOFBF, sizeof(out_buf));
+
+    char header[BT_HEADER_SIZE];
+    for (int i = 0; i < BT_HEADER_SIZE; i++) header[i] = (char)read_byte();
+    if (memcmp(header, BT_MAGIC, 4) != 0 || header[4] < 1 || header[4] > BT_VERSION) {
+        fprintf(stderr, "Arquivo '%s' não é um trace binário do POXIM (versão %d).\n", argv[1], BT_VERSION);
+        fclose(in_file); fclose(out); return 1;
+    }
+
+    uint32_t expected_pc = 0, last_addr = 0;
+    uint64_t records = 0;
+    int tag;
+    while ((tag = read_byte()) != EOF) {
+        switch (tag & BT_KIND_MASK) {
+            case BT_REGS:
+                for (int i = 0; i < 32; i++) x[i] = read_u32();
+                break;
+            case BT_IRQ: {
+                uint32_t cause = read_varint(); uint32_t epc = read_u32(); uint32_t tval = read_varint();
+                char line[BT_LINE_MAX];
+                fwrite(line, 1, bt_format_irq(line, cause, epc, tval), out);
+                break;
+            }
+            case BT_INSN: {
+                uint32_t insn_pc = expected_pc;
+                if (tag & BT_F_JUMP) insn_pc += (uint32_t)bt_unzigzag(read_varint());
+                uint32_t slot = bt_cache_slot(insn_pc);
+                uint32_t raw;
+                if (tag & BT_F_RAW_CACHED) raw = cache_raw[slot];
+                else { raw = read_u32(); cache_pc[slot] = insn_pc; cache_raw[slot] = raw; }
+                decoded_insn_t d; decode_any(raw, &d);
+                int fields = bt_fields(d.op);
+                uint32_t address = 0, value = 0;
+                if (fields & BT_HAS_ADDR) { last_addr += (uint32_t)bt_unzigzag(read_varint()); address = last_addr; }
+                if (fields & BT_HAS_VALUE) value = read_varint();
+                char line[BT_LINE_MAX];
+                fwrite(line, 1, bt_format_insn(line, x, insn_pc, &d, value, address), out);
+                bt_update_registers(x, insn_pc, &d, value);
+                expected_pc = insn_pc + insn_length(raw);
+                break;
+            }
+            default:
+                fprintf(stderr, "Registro inválido (tag 0x%02x) após %llu registros.\n", tag, (unsigned long long)records);
+                fclose(in_file); fclose(out); return 1;
+        }
+        records++;
+    }
+
+    fclose(in_file);
+    fclose(out);
+    return 0;
+}
@@ -2,475 +2,366 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 
-// --- Definições de CSRs ---
-#define CSR_MSTATUS 0x300
-#define CSR_MIE     0x304
-#define CSR_MTVEC   0x305
-#define CSR_MEPC    0x341
-#define CSR_MCAUSE  0x342
-#define CSR_MTVAL   0x343
-#define CSR_MIP     0x344
+#include "sidneijunior_202400018369_libpoxim.h"
 
-// --- Códigos de Exceção e Interrupção ---
-#define CAUSE_INSN_ACCESS      0x1
-#define CAUSE_ILLEGAL_INSTR    0x2
-#define CAUSE_LOAD_ACCESS      0x5
-#define CAUSE_STORE_ACCESS     0x7
-#define CAUSE_ECALL_MMODE      0xb
-#define CAUSE_MSI              0x80000003
-#define CAUSE_MTI              0x80000007
-#define CAUSE_MEI              0x8000000b
+// Interface de linha de comando do simulador; a máquina inteira está em libpoxim.
 
-// --- Mapeamento de Memória ---
-#define CLINT_BASE  0x02000000
-#define CLINT_SIZE  0x00010000
-#define PLIC_BASE   0x0c000000
-#define PLIC_SIZE   0x00400000
-#define UART_BASE   0x10000000
-#define UART_SIZE   0x100
-#define RAM_BASE    0x80000000
-#define MEM_SIZE    (1024 * 1024)
+// Blocos gerados pelo poxim-aot: definido só quando o .c gerado é compilado junto.
+extern const poxim_aot_program poxim_aot_generated __attribute__((weak));
 
-#define TIMER_DIVIDER 100
-#define UART_TX_DELAY 0 
+#define PAGE_SIZE_GUEST  4096u
+#define MEM_SIZE_DEFAULT (1024 * 1024)
 
-uint32_t registers[32];
-uint32_t pc = 0x80000000;
-uint32_t csrs[4096];
-uint8_t memory[MEM_SIZE];
+typedef struct {
+    uint64_t start_icount, trace_window; uint32_t start_pc; int start_at_pc;
+} trace_window_t;
 
-uint64_t mtime = 0;
-uint64_t mtimecmp = -1;
-uint32_t msip = 0;
-
-// Estado da UART e PLIC
-uint32_t uart_ier = 0; 
-int uart_tx_countdown = 0; 
-int uart_irq_pending = 0; 
+static void stop_message(const poxim_machine *m, int reason) {
+    if (reason == POXIM_EBREAK) printf("Simulação terminada (ebreak).\n");
+    else if (reason == POXIM_PC_ZERO) printf("\nSimulação terminada (Retorno a 0x0).\n");
+    else if (reason == POXIM_NULL_INSN) printf("Simulação terminada (instrução nula). PC=0x%x\n", poxim_get_pc(m, poxim_hart(m)));
+    else if (reason == POXIM_EXIT) printf("\nSimulação terminada (exit %d).\n", poxim_exit_code(m));
+}
 
-int trap_occurred = 0;
-int sim_running = 1;
+static const char *stop_names[] = { "limite", "ebreak", "retorno a 0x0", "instrução nula", "exit" };
 
-// Arquivos Globais
-FILE *output_file = NULL;
-FILE *terminal_file = NULL;
-FILE *input_file = NULL;
+// --mem-size: bytes, com sufixo K/M/G opcional; arredondado para páginas de 4 KiB.
+static int parse_mem_size(const char *arg, uint32_t *size) {
+    char *end; unsigned long long v = strtoull(arg, &end, 0);
+    if (*end == 'K' || *end == 'k') { v <<= 10; end++; }
+    else if (*end == 'M' || *end == 'm') { v <<= 20; end++; }
+    else if (*end == 'G' || *end == 'g') { v <<= 30; end++; }
+    v = (v + PAGE_SIZE_GUEST - 1) & ~(unsigned long long)(PAGE_SIZE_GUEST - 1);
+    if (*end != '\0' || v == 0 || v > POXIM_MEM_SIZE_MAX) { fprintf(stderr, "Tamanho de memória inválido: %s (máximo 2G)\n", arg); return 0; }
+    *size = (uint32_t)v;
+    return 1;
+}
 
-const char* x_label[32] = { "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6" };
+// Nível de cache no formato TAM:LINHA:VIAS[:lru|fifo|random] (TAM aceita K e M).
+static int parse_cache_level(const char *arg, poxim_cache_level *l) {
+    char *end; unsigned long long size = strtoull(arg, &end, 0);
+    if (*end == 'K' || *end == 'k') { size <<= 10; end++; }
+    else if (*end == 'M' || *end == 'm') { size <<= 20; end++; }
+    l->policy = POXIM_CACHE_LRU;
+    if (*end == ':') { l->line = (uint32_t)strtoul(end + 1, &end, 0); }
+    if (*end == ':') { l->ways = (uint32_t)strtoul(end + 1, &end, 0); }
+    int ok = 1;
+    if (*end == ':') {
+        if (strcmp(end + 1, "lru") == 0) l->policy = POXIM_CACHE_LRU;
+        else if (strcmp(end + 1, "fifo") == 0) l->policy = POXIM_CACHE_FIFO;
+        else if (strcmp(end + 1, "random") == 0) l->policy = POXIM_CACHE_RANDOM;
+        else ok = 0;
+        end += strlen(end);
+    }
+    if (!ok || *end != '\0' || size == 0 || size > UINT32_MAX) { fprintf(stderr, "Nível de cache inválido: %s (TAM:LINHA:VIAS[:lru|fifo|random])\n", arg); return 0; }
+    l->size = (uint32_t)size;
+    return 1;
+}
 
-void raise_exception(uint32_t cause, uint32_t tval) {
-    if (trap_occurred) return;
+// --jit: só sem trace e em x86-64.
+static int jit_usable(int trace_enabled) {
+#if defined(__x86_64__)
+    if (trace_enabled) { printf("JIT desativado: o trace exige o interpretador (use --no-trace).\n"); return 0; }
+    return 1;
+#else
+    (void)trace_enabled;
+    printf("JIT indisponível nesta arquitetura; usando o interpretador.\n");
+    return 0;
+#endif
+}
 
-    // Log para igualar o output ideal
-    if (output_file) {
-        if (cause & 0x80000000) {
-             fprintf(output_file, ">interrupt:external                   cause=0x%08x,epc=0x%08x,tval=0x%08x\n", cause, pc, tval);
-        }
-    }
+// --- Execução em lote (--batch) ---
+// O programa é carregado uma vez (poxim_image_open); cada entrada roda numa máquina própria
+// cuja RAM é uma cópia copy-on-write dessa imagem, em um pool de threads. A entrada X.in gera
+// X.out (trace) e X.terminal.out.
+typedef struct {
+    const char *in_path;
+    uint64_t instret;
+    int reason, ok;
+    double seconds;
+} batch_job_t;
 
-    csrs[CSR_MEPC] = pc;
-    csrs[CSR_MCAUSE] = cause;
-    csrs[CSR_MTVAL] = tval;
+static struct {
+    const poxim_image *image;
+    const poxim_config *config;
+    const trace_window_t *window; int trace;
+    const char *semihost_root;
+    batch_job_t *jobs; int n_jobs, next;
+} batch;
 
-    uint32_t mstatus = csrs[CSR_MSTATUS];
-    uint32_t mie_bit = (mstatus & 0x8) ? 1 : 0;
-    mstatus = (mstatus & ~0x80) | (mie_bit << 7);
-    mstatus &= ~0x8;
-    csrs[CSR_MSTATUS] = mstatus;
+static double now_seconds(void) { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return t.tv_sec + t.tv_nsec * 1e-9; }
 
-    uint32_t mtvec = csrs[CSR_MTVEC];
-    uint32_t mode = mtvec & 0x3;
-    uint32_t base = mtvec & ~0x3;
+static void batch_run(batch_job_t *job) {
+    double start = now_seconds();
+    size_t n = strlen(job->in_path), base = (n > 3 && strcmp(job->in_path + n - 3, ".in") == 0) ? n - 3 : n;
+    char *out_path = malloc(base + 16), *term_path = malloc(base + 16);
+    FILE *in = NULL, *term = NULL, *out = NULL;
+    poxim_machine *m = NULL;
+    if (out_path == NULL || term_path == NULL) goto done;
+    memcpy(out_path, job->in_path, base); strcpy(out_path + base, ".out");
+    memcpy(term_path, job->in_path, base); strcpy(term_path + base, ".terminal.out");
+    in = fopen(job->in_path, "r"); if (in == NULL) { perror(job->in_path); goto done; }
+    term = fopen(term_path, "w"); if (term == NULL) { perror(term_path); goto done; }
+    if (batch.trace && (out = fopen(out_path, "w")) == NULL) { perror(out_path); goto done; }
+    m = poxim_create(batch.config);
+    if (m == NULL) { perror("Erro ao criar a máquina"); goto done; }
+    if (!poxim_load_image(m, batch.image)) goto done;
+    if (batch.semihost_root && !poxim_semihosting(m, batch.semihost_root)) { perror(batch.semihost_root); goto done; }
+    if (&poxim_aot_generated) poxim_aot(m, &poxim_aot_generated);
+    poxim_set_file(m, POXIM_INPUT, in); poxim_set_file(m, POXIM_TERMINAL, term); poxim_set_file(m, POXIM_TRACE, out);
+    const trace_window_t *w = batch.window;
+    poxim_set_trace_window(m, w->start_icount, w->start_pc, w->start_at_pc, w->trace_window);
+    job->reason = poxim_run(m, UINT64_MAX);
+    job->instret = poxim_instret(m, -1); job->ok = job->reason != POXIM_ERROR;
+done:
+    if (m) poxim_destroy(m);
+    if (in) fclose(in);
+    if (term) fclose(term);
+    if (out) fclose(out);
+    free(out_path); free(term_path);
+    job->seconds = now_seconds() - start;
+}
 
-    if ((mode == 1) && (cause & 0x80000000)) {
-        uint32_t exception_code = cause & 0x7FFFFFFF;
-        pc = base + (exception_code * 4);
-    } else {
-        pc = base;
-    }
-    trap_occurred = 1;
+static void *batch_worker(void *arg) {
+    (void)arg;
+    for (int i; (i = __atomic_fetch_add(&batch.next, 1, __ATOMIC_RELAXED)) < batch.n_jobs; ) batch_run(&batch.jobs[i]);
+    return NULL;
 }
 
-uint32_t bus_load(uint32_t addr, int size_bytes) {
-    if (addr >= RAM_BASE && addr < (RAM_BASE + MEM_SIZE)) {
-        uint32_t index = addr - RAM_BASE;
-        if (index > MEM_SIZE - size_bytes) { raise_exception(CAUSE_LOAD_ACCESS, addr); return 0; }
-        uint32_t val = 0;
-        for(int i=0; i<size_bytes; i++) val |= (uint32_t)memory[index + i] << (8*i);
-        return val;
-    }
-    else if (addr >= CLINT_BASE && addr < (CLINT_BASE + CLINT_SIZE)) {
-        if (addr == 0x02000000) return msip;
-        if (addr == 0x02004000) return (uint32_t)(mtimecmp);
-        if (addr == 0x02004004) return (uint32_t)(mtimecmp >> 32);
-        if (addr == 0x0200bff8) return (uint32_t)(mtime);
-        if (addr == 0x0200bffc) return (uint32_t)(mtime >> 32);
-        return 0;
-    }
-    else if (addr >= PLIC_BASE && addr < (PLIC_BASE + PLIC_SIZE)) {
-        if (addr == 0x0c200004) {
-            if ((uart_ier & 0x2) && (uart_tx_countdown == 0) && uart_irq_pending) {
-                uart_irq_pending = 0; 
-                return 10;
-            }
-        }
-        return 0;
-    }
-    else if (addr >= UART_BASE && addr < (UART_BASE + UART_SIZE)) {
-        if ((addr - UART_BASE) == 0) {
-            int c = (input_file) ? fgetc(input_file) : EOF;
-            if (c == EOF) {
-                static int eof_warned = 0;
-                if (!eof_warned) { eof_warned = 1; return 10; } 
-                return 0xFFFFFFFF;
-            }
-            return (uint32_t)c;
-        }
-        if ((addr - UART_BASE) == 2) {
-            return (uart_irq_pending) ? 2 : 1; 
-        }
-        return 0;
+static int batch_main(const char *prog_path, uint32_t load_addr, int raw_image, char **inputs, int n_inputs, int jobs, const poxim_config *cfg, const trace_window_t *window, int trace, const char *semihost_root) {
+    double start = now_seconds();
+    poxim_image *image = poxim_image_open(prog_path, cfg->mem_size, load_addr, raw_image);
+    if (image == NULL) return 1;
+    batch.image = image; batch.config = cfg; batch.window = window; batch.trace = trace; batch.semihost_root = semihost_root;
+    batch.jobs = calloc(n_inputs, sizeof(batch_job_t)); batch.n_jobs = n_inputs; batch.next = 0;
+    if (batch.jobs == NULL) { poxim_image_close(image); return 1; }
+    for (int i = 0; i < n_inputs; i++) batch.jobs[i].in_path = inputs[i];
+    if (jobs > n_inputs) jobs = n_inputs;
+    printf("Lote: %d entradas, %d threads\n", n_inputs, jobs);
+
+    pthread_t *threads = calloc(jobs, sizeof(pthread_t));
+    int started = 0;
+    for (; threads && started < jobs; started++) if (pthread_create(&threads[started], NULL, batch_worker, NULL) != 0) break;
+    if (started == 0) batch_worker(NULL);
+    for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+    free(threads);
+
+    uint64_t total = 0; int failed = 0;
+    for (int i = 0; i < n_inputs; i++) {
+        batch_job_t *j = &batch.jobs[i];
+        if (!j->ok) { printf("%-40s %15s %10s  falhou\n", j->in_path, "-", "-"); failed++; continue; }
+        printf("%-40s %15llu %9.3fs  %s\n", j->in_path, (unsigned long long)j->instret, j->seconds, stop_names[j->reason]);
+        total += j->instret;
     }
-    raise_exception(CAUSE_LOAD_ACCESS, addr);
-    return 0;
+    double wall = now_seconds() - start;
+    printf("Total: %d entradas (%d com falha), %llu instruções em %.3f s (%.1f MIPS)\n", n_inputs, failed, (unsigned long long)total, wall, wall > 0 ? total / wall / 1e6 : 0.0);
+    free(batch.jobs); poxim_image_close(image);
+    return failed ? 1 : 0;
 }
 
-void bus_store(uint32_t addr, uint32_t value, int size_bytes) {
-    if (addr >= RAM_BASE && addr < (RAM_BASE + MEM_SIZE)) {
-        uint32_t index = addr - RAM_BASE;
-        if (index > MEM_SIZE - size_bytes) { raise_exception(CAUSE_STORE_ACCESS, addr); return; }
-        for(int i=0; i<size_bytes; i++) memory[index + i] = (value >> (8*i)) & 0xFF;
-        return;
-    }
-    else if (addr >= UART_BASE && addr < (UART_BASE + UART_SIZE)) {
-        if (addr == UART_BASE) { // THR
-            if (uart_tx_countdown == 0) {
-                putchar((char)value);
-                if (terminal_file) fputc((char)value, terminal_file);
-                fflush(stdout);
-                
-                uart_tx_countdown = UART_TX_DELAY; 
-                uart_irq_pending = 1; 
-            }
+int main(int argc, char *argv[]) {
+    int trace_enabled = 1, binary_trace = 0, sync_output = 0, jit = 0, no_superblocks = 0, threads = 0, n_harts = 1, batch_mode = 0, jobs = 0, huge_pages = 0;
+    trace_window_t w = { UINT64_MAX, UINT64_MAX, 0, 0 };
+    uint32_t load_addr = POXIM_RAM_BASE, mem_size = MEM_SIZE_DEFAULT; int raw_image = -1;
+    char *save_snapshot = NULL, *restore_snapshot = NULL, *profile_path = NULL; int profile_top = 20;
+    char *cache_path = NULL; int cache_top = 20;
+    char *selfprof_path = NULL, *semihost_root = NULL;
+    char *timing_path = NULL; poxim_timing_config timing_cfg = { POXIM_PREDICT_BIMODAL, 10, 3, 32 };
+    poxim_cache_config cache_cfg = { { 16384, 64, 4, POXIM_CACHE_LRU }, { 16384, 64, 4, POXIM_CACHE_LRU }, { 0, 64, 8, POXIM_CACHE_LRU } };
+    uint64_t snap_icount = UINT64_MAX; uint32_t snap_pc = 0; int snap_at_pc = 0;
+    char **args = calloc(argc, sizeof(char *)); int n_args = 0;
+    if (args == NULL) return 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-trace") == 0) trace_enabled = 0;
+        else if (strcmp(argv[i], "--binary-trace") == 0) binary_trace = 1;
+        else if (strcmp(argv[i], "--sync-output") == 0) sync_output = 1;
+        else if (strcmp(argv[i], "--jit") == 0) jit = 1;
+        else if (strcmp(argv[i], "--no-superblocks") == 0) no_superblocks = 1;
+        else if (strcmp(argv[i], "--threads") == 0) threads = 1;
+        else if (strcmp(argv[i], "--batch") == 0) batch_mode = 1;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--harts") == 0 && i + 1 < argc) {
+            n_harts = atoi(argv[++i]);
+            if (n_harts < 1 || n_harts > POXIM_MAX_HARTS) { fprintf(stderr, "Número de harts inválido: %s (1 a %d)\n", argv[i], POXIM_MAX_HARTS); return 1; }
         }
-        else if (addr == UART_BASE + 1) { 
-            uart_ier = value; 
+        else if (strcmp(argv[i], "--huge-pages") == 0) huge_pages = 1;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) profile_path = argv[++i];
+        else if (strcmp(argv[i], "--profile-top") == 0 && i + 1 < argc) profile_top = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cache_path = argv[++i];
+        else if (strcmp(argv[i], "--cache-top") == 0 && i + 1 < argc) cache_top = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--l1i") == 0 && i + 1 < argc) { if (!parse_cache_level(argv[++i], &cache_cfg.l1i)) return 1; }
+        else if (strcmp(argv[i], "--l1d") == 0 && i + 1 < argc) { if (!parse_cache_level(argv[++i], &cache_cfg.l1d)) return 1; }
+        else if (strcmp(argv[i], "--l2") == 0 && i + 1 < argc) { if (!parse_cache_level(argv[++i], &cache_cfg.l2)) return 1; }
+        else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc) timing_path = argv[++i];
+        else if (strcmp(argv[i], "--semihosting") == 0 && i + 1 < argc) semihost_root = argv[++i];
+        else if (strcmp(argv[i], "--predictor") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (strcmp(name, "static") == 0) timing_cfg.predictor = POXIM_PREDICT_STATIC;
+            else if (strcmp(name, "bimodal") == 0) timing_cfg.predictor = POXIM_PREDICT_BIMODAL;
+            else if (strcmp(name, "gshare") == 0) timing_cfg.predictor = POXIM_PREDICT_GSHARE;
+            else { fprintf(stderr, "Preditor desconhecido: %s (static, bimodal ou gshare)\n", name); return 1; }
         }
-        return;
+        else if (strcmp(argv[i], "--predictor-bits") == 0 && i + 1 < argc) timing_cfg.table_bits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mul-latency") == 0 && i + 1 < argc) timing_cfg.mul_latency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--div-latency") == 0 && i + 1 < argc) timing_cfg.div_latency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--self-profile") == 0 && i + 1 < argc) selfprof_path = argv[++i];
+        else if (strcmp(argv[i], "--save-snapshot") == 0 && i + 1 < argc) save_snapshot = argv[++i];
+        else if (strcmp(argv[i], "--restore-snapshot") == 0 && i + 1 < argc) restore_snapshot = argv[++i];
+        else if (strcmp(argv[i], "--snapshot-at-icount") == 0 && i + 1 < argc) snap_icount = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--snapshot-at-pc") == 0 && i + 1 < argc) { snap_pc = (uint32_t)strtoul(argv[++i], NULL, 16); snap_at_pc = 1; }
+        else if (strcmp(argv[i], "--load-addr") == 0 && i + 1 < argc) { load_addr = (uint32_t)strtoul(argv[++i], NULL, 16); raw_image = 1; }
+        else if (strcmp(argv[i], "--mem-size") == 0 && i + 1 < argc) { if (!parse_mem_size(argv[++i], &mem_size)) return 1; }
+        else if (strcmp(argv[i], "--start-trace-at-icount") == 0 && i + 1 < argc) w.start_icount = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--start-trace-at-pc") == 0 && i + 1 < argc) { w.start_pc = (uint32_t)strtoul(argv[++i], NULL, 16); w.start_at_pc = 1; }
+        else if (strcmp(argv[i], "--trace-window") == 0 && i + 1 < argc) w.trace_window = strtoull(argv[++i], NULL, 0);
+        else if (strncmp(argv[i], "--", 2) == 0) { fprintf(stderr, "Opção desconhecida: %s\n", argv[i]); return 1; }
+        else args[n_args++] = argv[i];
     }
-    else if (addr >= CLINT_BASE && addr < (CLINT_BASE + CLINT_SIZE)) {
-        if (addr == 0x02000000) msip = value & 0x1;
-        else if (addr == 0x02004000) mtimecmp = (mtimecmp & 0xFFFFFFFF00000000) | value;
-        else if (addr == 0x02004004) mtimecmp = (mtimecmp & 0x00000000FFFFFFFF) | ((uint64_t)value << 32);
-        return;
+    int n_required = batch_mode ? 2 : (trace_enabled ? 1 : 0) + (restore_snapshot ? 0 : 1);   // com --restore-snapshot não há <programa>
+    if (n_args < n_required) {
+        fprintf(stderr, "Uso: %s [--binary-trace] [--start-trace-at-icount N] [--start-trace-at-pc ADDR] [--trace-window M] <programa> <arquivo.out> [arquivo.in]\n", argv[0]);
+        fprintf(stderr, "     %s --no-trace [--jit] [--no-superblocks] <programa> [arquivo.in]\n", argv[0]);
+        fprintf(stderr, "     %s --batch [--jobs N] [--no-trace] [--jit] <programa> <entrada.in>...: cada X.in gera X.out e X.terminal.out\n", argv[0]);
+        fprintf(stderr, "     (todos aceitam --mem-size N[K|M|G], --huge-pages e --load-addr ADDR)\n");
+        fprintf(stderr, "     <programa>: .hex, executável ELF32 RISC-V ou imagem crua .bin (carregada em --load-addr, padrão 0x%08x)\n", POXIM_RAM_BASE);
+        fprintf(stderr, "     --save-snapshot ARQ [--snapshot-at-icount N | --snapshot-at-pc ADDR]: salva o estado (padrão: no ebreak)\n");
+        fprintf(stderr, "     --restore-snapshot ARQ: continua de um snapshot, no lugar de <programa>\n");
+        fprintf(stderr, "     --profile ARQ [--profile-top N]: grava em ARQ o perfil de execução (N PCs e blocos mais executados, padrão 20)\n");
+        fprintf(stderr, "     --cache ARQ [--l1i C] [--l1d C] [--l2 C] [--cache-top N]: simula as caches e grava o relatório em ARQ\n");
+        fprintf(stderr, "       (C = TAM:LINHA:VIAS[:lru|fifo|random]; padrão L1I e L1D 16K:64:4:lru, sem L2)\n");
+        fprintf(stderr, "     --timing ARQ [--predictor static|bimodal|gshare] [--predictor-bits N] [--mul-latency N] [--div-latency N]:\n");
+        fprintf(stderr, "       modelo de pipeline de 5 estágios (mtime/mcycle seguem os ciclos); grava o CPI em ARQ (padrão bimodal, 10, 3, 32)\n");
+        fprintf(stderr, "     --self-profile ARQ: grava em ARQ (JSON) onde o simulador gastou o tempo do host (build com -DPOXIM_SELF_PROFILE=1)\n");
+        fprintf(stderr, "     --semihosting DIR: ecall atende read/write/open/close/lseek/fstat/brk/exit do newlib, com arquivos só abaixo de DIR\n");
+        fprintf(stderr, "     --sync-output: trace e console escritos pela própria execução (padrão com um só processador), sem o thread de escrita\n");
+        fprintf(stderr, "     --harts N [--threads]: N harts (até %d), intercalados ou um por thread do host (--threads exige --no-trace)\n", POXIM_MAX_HARTS);
+        return 1;
     }
-    else if (addr >= PLIC_BASE && addr < (PLIC_BASE + PLIC_SIZE)) {
-        return; 
+    if (n_harts > 1 && (binary_trace || save_snapshot || restore_snapshot)) {
+        fprintf(stderr, "--binary-trace e snapshots exigem um único hart\n"); return 1;
     }
-    raise_exception(CAUSE_STORE_ACCESS, addr);
-}
+    if (batch_mode && (binary_trace || save_snapshot || restore_snapshot || threads)) {
+        fprintf(stderr, "--batch não aceita --binary-trace, --threads nem snapshots\n"); return 1;
+    }
+    if (profile_path && (batch_mode || threads)) { fprintf(stderr, "--profile não aceita --batch nem --threads\n"); return 1; }
+    if (cache_path && (batch_mode || threads)) { fprintf(stderr, "--cache não aceita --batch nem --threads\n"); return 1; }
+    if (timing_path && (batch_mode || threads)) { fprintf(stderr, "--timing não aceita --batch nem --threads\n"); return 1; }
+    if (selfprof_path && batch_mode) { fprintf(stderr, "--self-profile não aceita --batch\n"); return 1; }
+    if (threads && trace_enabled) { printf("Threads desativadas: o trace exige um único thread (use --no-trace).\n"); threads = 0; }
+    int arg = 0;
+    char *prog_path = restore_snapshot ? NULL : args[arg++];
+    if (prog_path && raw_image < 0) { size_t n = strlen(prog_path); raw_image = n > 4 && strcmp(prog_path + n - 4, ".bin") == 0; }
+    if (prog_path && access(prog_path, R_OK) != 0) return 1;
 
-uint32_t read_word_from_memory(uint32_t address) { return bus_load(address, 4); }
-uint16_t read_half_word_from_memory(uint32_t address) { return (uint16_t)bus_load(address, 2); }
-uint8_t read_byte_from_memory(uint32_t address) { return (uint8_t)bus_load(address, 1); }
-void write_word_to_memory(uint32_t address, uint32_t value) { bus_store(address, value, 4); }
-void write_half_word_to_memory(uint32_t address, uint16_t value) { bus_store(address, value, 2); }
-void write_byte_to_memory(uint32_t address, uint8_t value) { bus_store(address, value, 1); }
+    if (batch_mode) {
+        if (jit) jit = jit_usable(trace_enabled);
+        if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (jobs <= 0) jobs = 1;
+        poxim_config cfg = { mem_size, n_harts, 0, jit, huge_pages, 0, no_superblocks };
+        int r = batch_main(prog_path, load_addr, raw_image, args + 1, n_args - 1, jobs, &cfg, &w, trace_enabled, semihost_root);
+        free(args);
+        return r;
+    }
 
-void execute_instruction(uint32_t instruction, uint32_t current_pc, FILE *out_file) {
-    uint32_t opcode = instruction & 0x7F;
-    int pc_updated = 0;
-    trap_occurred = 0;
-    char operand_str[40];
+    char *out_path = trace_enabled ? args[arg++] : NULL;
+    char *in_path = (n_args > arg) ? args[arg] : NULL;
+    free(args);
+    if (restore_snapshot && (mem_size = poxim_snapshot_mem_size(restore_snapshot)) == 0) return 1;
 
-    switch (opcode) {
-        case 0x13: { // I-Type
-            uint32_t rd = (instruction >> 7) & 0x1F;
-            uint32_t funct3 = (instruction >> 12) & 0x7;
-            uint32_t rs1 = (instruction >> 15) & 0x1F;
-            int32_t imm = (int32_t)(instruction & 0xFFF00000) >> 20;
-            uint32_t val_rs1 = registers[rs1];
-            uint32_t res;
-            uint32_t shamt = imm & 0x1F; 
-            switch (funct3) {
-                case 0x0: res = val_rs1 + imm; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, "addi", operand_str, x_label[rd], val_rs1, imm, res); break;
-                case 0x1: res = val_rs1 << shamt; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,%u", x_label[rd], x_label[rs1], shamt); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x<<%u=0x%08x\n", current_pc, "slli", operand_str, x_label[rd], val_rs1, shamt, res); break;
-                case 0x2: res = ((int32_t)val_rs1 < imm) ? 1 : 0; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, "slti", operand_str, x_label[rd], val_rs1, imm, res); break;
-                case 0x3: res = (val_rs1 < (uint32_t)imm) ? 1 : 0; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, "sltiu", operand_str, x_label[rd], val_rs1, imm, res); break;
-                case 0x4: res = val_rs1 ^ imm; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x^0x%08x=0x%08x\n", current_pc, "xori", operand_str, x_label[rd], val_rs1, imm, res); break;
-                case 0x5: { 
-                    uint32_t funct7 = (instruction >> 25) & 0x7F;
-                    if (funct7 == 0x00) { res = (uint32_t)val_rs1 >> shamt; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,%u", x_label[rd], x_label[rs1], shamt); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x>>%u=0x%08x\n", current_pc, "srli", operand_str, x_label[rd], val_rs1, shamt, res); } 
-                    else if (funct7 == 0x20) { res = (int32_t)val_rs1 >> shamt; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,%u", x_label[rd], x_label[rs1], shamt); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x>>>%u=0x%08x\n", current_pc, "srai", operand_str, x_label[rd], val_rs1, shamt, res); }
-                    break;
-                }
-                case 0x6: res = val_rs1 | imm; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x|0x%08x=0x%08x\n", current_pc, "ori", operand_str, x_label[rd], val_rs1, imm, res); break;
-                case 0x7: res = val_rs1 & imm; if (rd != 0) registers[rd] = res; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x&0x%08x=0x%08x\n", current_pc, "andi", operand_str, x_label[rd], val_rs1, imm, res); break;
-                default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); break;
-            }
-            break;
-        }
-        case 0x33: { // R-Type
-            uint32_t rd = (instruction >> 7) & 0x1F; uint32_t funct3 = (instruction >> 12) & 0x7; uint32_t rs1 = (instruction >> 15) & 0x1F; uint32_t rs2 = (instruction >> 20) & 0x1F; uint32_t funct7 = (instruction >> 25) & 0x7F;
-            int32_t v_rs1 = registers[rs1]; int32_t v_rs2 = registers[rs2]; uint32_t v_urs1 = registers[rs1]; uint32_t v_urs2 = registers[rs2]; uint32_t shamt = v_urs2 & 0x1F; uint32_t res; 
-            sprintf(operand_str, "%s,%s,%s", x_label[rd], x_label[rs1], x_label[rs2]);
-            int instr_valid = 0;
-            if (funct7 == 0x00) {
-                switch (funct3) {
-                    case 0x0: res = v_rs1 + v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, "add", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x1: res = v_urs1 << shamt; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x<<%u=0x%08x\n", current_pc, "sll", operand_str, x_label[rd], v_urs1, shamt, res); break;
-                    case 0x2: res = (v_rs1 < v_rs2) ? 1 : 0; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, "slt", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x3: res = (v_urs1 < v_urs2) ? 1 : 0; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, "sltu", operand_str, x_label[rd], v_urs1, v_urs2, res); break;
-                    case 0x4: res = v_rs1 ^ v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x^0x%08x=0x%08x\n", current_pc, "xor", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x5: res = v_urs1 >> shamt; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x>>%u=0x%08x\n", current_pc, "srl", operand_str, x_label[rd], v_urs1, shamt, res); break;
-                    case 0x6: res = v_rs1 | v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x|0x%08x=0x%08x\n", current_pc, "or", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x7: res = v_rs1 & v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x&0x%08x=0x%08x\n", current_pc, "and", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                }
-            } else if (funct7 == 0x20) {
-                switch (funct3) {
-                    case 0x0: res = v_rs1 - v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x-0x%08x=0x%08x\n", current_pc, "sub", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x5: res = v_rs1 >> shamt; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x>>>%u=0x%08x\n", current_pc, "sra", operand_str, x_label[rd], v_rs1, shamt, res); break;
-                }
-            } else if (funct7 == 0x01) {
-                int64_t s64_rs1 = (int64_t)v_rs1; int64_t s64_rs2 = (int64_t)v_rs2; uint64_t u64_rs1 = (uint64_t)v_urs1; uint64_t u64_rs2 = (uint64_t)v_urs2;
-                switch (funct3) {
-                    case 0x0: res = v_rs1 * v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, "mul", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x1: res = (uint32_t)((s64_rs1 * s64_rs2) >> 32); instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, "mulh", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x2: res = (uint32_t)((s64_rs1 * u64_rs2) >> 32); instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, "mulhsu", operand_str, x_label[rd], v_rs1, v_urs2, res); break;
-                    case 0x3: res = (uint32_t)((u64_rs1 * u64_rs2) >> 32); instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x*0x%08x=0x%08x\n", current_pc, "mulhu", operand_str, x_label[rd], v_urs1, v_urs2, res); break;
-                    case 0x4: if(v_rs2==0)res=-1;else if(v_rs1==0x80000000&&v_rs2==-1)res=0x80000000;else res=v_rs1/v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x/0x%08x=0x%08x\n", current_pc, "div", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x5: if(v_urs2==0)res=-1;else res=v_urs1/v_urs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x/0x%08x=0x%08x\n", current_pc, "divu", operand_str, x_label[rd], v_urs1, v_urs2, res); break;
-                    case 0x6: if(v_rs2==0)res=v_rs1;else if(v_rs1==0x80000000&&v_rs2==-1)res=0;else res=v_rs1%v_rs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x%%0x%08x=0x%08x\n", current_pc, "rem", operand_str, x_label[rd], v_rs1, v_rs2, res); break;
-                    case 0x7: if(v_urs2==0)res=v_urs1;else res=v_urs1%v_urs2; instr_valid=1; fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x%%0x%08x=0x%08x\n", current_pc, "remu", operand_str, x_label[rd], v_urs1, v_urs2, res); break;
-                }
-            }
-            if (instr_valid) { if (rd != 0) registers[rd] = res; } 
-            else { raise_exception(CAUSE_ILLEGAL_INSTR, instruction); }
-            break;
-        }
-        case 0x6F: { // jal
-            uint32_t rd = (instruction >> 7) & 0x1F; uint32_t imm_20 = (instruction >> 31) & 1; uint32_t imm_10_1 = (instruction >> 21) & 0x3FF; uint32_t imm_11 = (instruction >> 20) & 1; uint32_t imm_19_12 = (instruction >> 12) & 0xFF;
-            int32_t offset = (imm_20 << 20) | (imm_19_12 << 12) | (imm_11 << 11) | (imm_10_1 << 1); offset = (int32_t)(offset << 11) >> 11;
-            uint32_t return_address = current_pc + 4; uint32_t target_address = current_pc + offset; 
-            if (rd != 0) {
-                registers[rd] = return_address;
-            }
-            pc = target_address; 
-            pc_updated = 1;  
-            sprintf(operand_str, "%s,0x%05x", x_label[rd], (offset >> 1) & 0xFFFFF); fprintf(out_file, "0x%08x:%-7s %-16s pc=0x%08x,%s=0x%08x\n", current_pc, "jal", operand_str, target_address, x_label[rd], return_address);
-            break;
-        }
-        case 0x63: { // Branches
-            uint32_t funct3 = (instruction >> 12) & 0x7; uint32_t rs1 = (instruction >> 15) & 0x1F; uint32_t rs2 = (instruction >> 20) & 0x1F;
-            uint32_t imm_12 = (instruction >> 31) & 1; uint32_t imm_10_5 = (instruction >> 25) & 0x3F; uint32_t imm_4_1 = (instruction >> 8) & 0xF; uint32_t imm_11 = (instruction >> 7) & 1;
-            int32_t offset = (imm_12 << 12) | (imm_11 << 11) | (imm_10_5 << 5) | (imm_4_1 << 1); offset = (int32_t)(offset << 19) >> 19;
-            int32_t val_rs1 = registers[rs1]; int32_t val_rs2 = registers[rs2]; uint32_t u_val_rs1 = registers[rs1]; uint32_t u_val_rs2 = registers[rs2];
-            int condition_met = 0; const char* instr_name = "???"; const char* op_symbol = "??"; int is_unsigned = 0;
-            switch (funct3) {
-                case 0x0: instr_name = "beq"; op_symbol = "=="; if (val_rs1 == val_rs2) condition_met = 1; break;
-                case 0x1: instr_name = "bne"; op_symbol = "!="; if (val_rs1 != val_rs2) condition_met = 1; break;
-                case 0x4: instr_name = "blt"; op_symbol = "<";  if (val_rs1 < val_rs2) condition_met = 1; break;
-                case 0x5: instr_name = "bge"; op_symbol = ">="; if (val_rs1 >= val_rs2) condition_met = 1; break;
-                case 0x6: instr_name = "bltu"; op_symbol = "<";  if (u_val_rs1 < u_val_rs2) condition_met = 1; is_unsigned = 1; break;
-                case 0x7: instr_name = "bgeu"; op_symbol = ">="; if (u_val_rs1 >= u_val_rs2) condition_met = 1; is_unsigned = 1; break;
-                default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); return;
-            }
-            if (is_unsigned) { fprintf(out_file, "0x%08x:%-7s %s,%s,0x%03x   (0x%08x%s0x%08x)=%d->pc=0x%08x\n", current_pc, instr_name, x_label[rs1], x_label[rs2], (offset >> 1) & 0xFFF, u_val_rs1, op_symbol, u_val_rs2, condition_met, (condition_met ? (current_pc + offset) : (current_pc + 4))); } 
-            else { fprintf(out_file, "0x%08x:%-7s %s,%s,0x%03x   (0x%08x%s0x%08x)=%d->pc=0x%08x\n", current_pc, instr_name, x_label[rs1], x_label[rs2], (offset >> 1) & 0xFFF, val_rs1, op_symbol, val_rs2, condition_met, (condition_met ? (current_pc + offset) : (current_pc + 4))); }
-            if (condition_met) { pc = current_pc + offset; pc_updated = 1; }
-            break;
-        }
-        case 0x37: { // lui
-            uint32_t rd = (instruction >> 7) & 0x1F; uint32_t imm_u = instruction & 0xFFFFF000; 
-            if (rd != 0) registers[rd] = imm_u;
-            sprintf(operand_str, "%s,0x%05x", x_label[rd], (imm_u >> 12)); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "lui", operand_str, x_label[rd], imm_u); 
-            break;
-        }
-        case 0x17: { // auipc
-            uint32_t rd = (instruction >> 7) & 0x1F; int32_t imm_u = (int32_t)(instruction & 0xFFFFF000); uint32_t res = current_pc + imm_u;
-            if (rd != 0) registers[rd] = res;
-            sprintf(operand_str, "%s,0x%05x", x_label[rd], (imm_u >> 12) & 0xFFFFF); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, "auipc", operand_str, x_label[rd], current_pc, imm_u, res);
-            break;
-        }
-        case 0x67: { // jalr
-            uint32_t rd = (instruction >> 7) & 0x1F; uint32_t rs1 = (instruction >> 15) & 0x1F; int32_t imm = (int32_t)(instruction & 0xFFF00000) >> 20; 
-            uint32_t val_rs1 = registers[rs1]; uint32_t return_address = current_pc + 4; uint32_t target_address = (val_rs1 + imm) & ~1;
-            if (rd != 0) {
-                registers[rd] = return_address;
-            }
-            pc = target_address; 
-            pc_updated = 1;
-            sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); fprintf(out_file, "0x%08x:%-7s %-16s pc=0x%08x+0x%08x,%s=0x%08x\n", current_pc, "jalr", operand_str, val_rs1, imm, x_label[rd], return_address);
-            break;
-        }
-        case 0x03: { // Loads
-            uint32_t rd = (instruction >> 7) & 0x1F; uint32_t funct3 = (instruction >> 12) & 0x7; uint32_t rs1 = (instruction >> 15) & 0x1F; int32_t imm = (int32_t)(instruction & 0xFFF00000) >> 20;
-            uint32_t val_rs1 = registers[rs1]; uint32_t address = val_rs1 + imm; uint32_t res = 0; const char* instr_name = "???";
-            sprintf(operand_str, "%s,0x%03x(%s)", x_label[rd], (imm & 0xFFF), x_label[rs1]);
-            switch (funct3) {
-                case 0x0: instr_name = "lb";  { int8_t  b = (int8_t) read_byte_from_memory(address); if(!trap_occurred) res = (int32_t)b; } break;
-                case 0x1: instr_name = "lh";  { int16_t h = (int16_t)read_half_word_from_memory(address); if(!trap_occurred) res = (int32_t)h; } break;
-                case 0x2: instr_name = "lw";  { res = read_word_from_memory(address); } break;
-                case 0x4: instr_name = "lbu"; { uint8_t b = read_byte_from_memory(address); if(!trap_occurred) res = (uint32_t)b; } break;
-                case 0x5: instr_name = "lhu"; { uint16_t h = read_half_word_from_memory(address); if(!trap_occurred) res = (uint32_t)h; } break;
-                default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); return;
-            }
-            if (!trap_occurred) { if(rd != 0) registers[rd] = res; fprintf(out_file, "0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x\n", current_pc, instr_name, operand_str, x_label[rd], address, res); }
-            break;
-        }
-        case 0x23: { // Stores
-            uint32_t funct3 = (instruction >> 12) & 0x7; uint32_t rs1 = (instruction >> 15) & 0x1F; uint32_t rs2 = (instruction >> 20) & 0x1F;
-            uint32_t imm_11_5 = (instruction >> 25) & 0x7F; uint32_t imm_4_0  = (instruction >> 7) & 0x1F; int32_t imm = (imm_11_5 << 5) | imm_4_0; imm = (int32_t)(imm << 20) >> 20;
-            uint32_t val_rs1 = registers[rs1]; uint32_t val_rs2 = registers[rs2]; uint32_t address = val_rs1 + imm; const char* instr_name = "???";
-            sprintf(operand_str, "%s,0x%03x(%s)", x_label[rs2], (imm & 0xFFF), x_label[rs1]);
-            switch (funct3) {
-                case 0x0: instr_name = "sb"; write_byte_to_memory(address, (uint8_t)val_rs2); if(!trap_occurred) fprintf(out_file, "0x%08x:%-7s %-16s mem[0x%08x]=0x%02x\n", current_pc, instr_name, operand_str, address, (uint8_t)val_rs2); break;
-                case 0x1: instr_name = "sh"; write_half_word_to_memory(address, (uint16_t)val_rs2); if(!trap_occurred) fprintf(out_file, "0x%08x:%-7s %-16s mem[0x%08x]=0x%04x\n", current_pc, instr_name, operand_str, address, (uint16_t)val_rs2); break;
-                case 0x2: instr_name = "sw"; write_word_to_memory(address, val_rs2); if(!trap_occurred) fprintf(out_file, "0x%08x:%-7s %-16s mem[0x%08x]=0x%08x\n", current_pc, instr_name, operand_str, address, val_rs2); break;
-                default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); return; 
-            }
-            break;
-        }
-        case 0x73: { // SYSTEM / CSR
-            uint32_t funct3 = (instruction >> 12) & 0x7; uint32_t rd = (instruction >> 7) & 0x1F; uint32_t rs1 = (instruction >> 15) & 0x1F; uint32_t csr_addr = (instruction >> 20) & 0xFFF; uint32_t uimm = rs1; 
-            if (funct3 == 0) {
-                if (csr_addr == 0) { raise_exception(CAUSE_ECALL_MMODE, 0); fprintf(out_file, "0x%08x:ecall\n", current_pc); }
-                else if (csr_addr == 1) { 
-                    fprintf(out_file, "0x%08x:ebreak\n", current_pc);
-                    sim_running = 0; 
-                }
-                else if (csr_addr == 0x302) { 
-                    pc = csrs[CSR_MEPC]; 
-                    pc_updated = 1; 
-                    uint32_t mstatus = csrs[CSR_MSTATUS];
-                    uint32_t mpie_bit = (mstatus >> 7) & 1;
-                    mstatus = (mstatus & ~0x8) | (mpie_bit << 3);
-                    mstatus |= 0x80;
-                    csrs[CSR_MSTATUS] = mstatus;
-                    fprintf(out_file, "0x%08x:mret\n", current_pc); 
-                }
-                else { raise_exception(CAUSE_ILLEGAL_INSTR, instruction); }
-            } else {
-                uint32_t csr_val = csrs[csr_addr]; uint32_t new_val = csr_val;
-                switch (funct3) {
-                    case 0x1: new_val = registers[rs1]; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], csr_addr); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "csrrw", operand_str, x_label[rd], csr_val); break;
-                    case 0x2: new_val = csr_val | registers[rs1]; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], csr_addr); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "csrrs", operand_str, x_label[rd], csr_val); break;
-                    case 0x3: new_val = csr_val & ~registers[rs1]; sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], csr_addr); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "csrrc", operand_str, x_label[rd], csr_val); break;
-                    case 0x5: new_val = uimm; sprintf(operand_str, "%s,0x%x,0x%03x", x_label[rd], uimm, csr_addr); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "csrrwi", operand_str, x_label[rd], csr_val); break;
-                    case 0x6: new_val = csr_val | uimm; sprintf(operand_str, "%s,0x%x,0x%03x", x_label[rd], uimm, csr_addr); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "csrrsi", operand_str, x_label[rd], csr_val); break;
-                    case 0x7: new_val = csr_val & ~uimm; sprintf(operand_str, "%s,0x%x,0x%03x", x_label[rd], uimm, csr_addr); fprintf(out_file, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, "csrrci", operand_str, x_label[rd], csr_val); break;
-                    default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); return;
-                }
-                csrs[csr_addr] = new_val; if (rd != 0) registers[rd] = csr_val;
-            }
-            break;
-        }
-        default: raise_exception(CAUSE_ILLEGAL_INSTR, instruction); fprintf(out_file, "Erro: Opcode 0x%x desconhecido em 0x%08x (Trap)\n", opcode, current_pc); break;
-    }
-    if (!pc_updated && !trap_occurred) { pc += 4; }
-}
+    FILE *text_out = NULL, *bin_out = NULL, *terminal_file = NULL, *input_file = NULL;
+    if (out_path && binary_trace) { bin_out = fopen(out_path, "wb"); if (bin_out == NULL) return 1; }
+    else if (out_path) { text_out = fopen(out_path, "w"); if (text_out == NULL) return 1; }
 
-int main(int argc, char *argv[]) {
-    if (argc < 3) { fprintf(stderr, "Uso: %s <arquivo.hex> <arquivo.out> [arquivo.in]\n", argv[0]); return 1; }
-    FILE *hex_file = fopen(argv[1], "r"); if (hex_file == NULL) return 1;
-    
-    output_file = fopen(argv[2], "w"); if (output_file == NULL) { fclose(hex_file); return 1; }
-    
     terminal_file = fopen("terminal.out", "w");
     if (terminal_file == NULL) { perror("Erro ao criar terminal.out"); }
 
-    input_file = NULL;
-    if (argc >= 4) {
-        input_file = fopen(argv[3], "r");
+    if (in_path) {
+        input_file = fopen(in_path, "r");
         if (input_file == NULL) {
             perror("Erro ao abrir arquivo .in");
-            fclose(hex_file); fclose(output_file); if(terminal_file) fclose(terminal_file);
+            if (text_out) fclose(text_out);
+            if (bin_out) fclose(bin_out);
+            if (terminal_file) fclose(terminal_file);
             return 1;
         }
-        printf("Lendo entrada do arquivo: %s\n", argv[3]);
+        printf("Lendo entrada do arquivo: %s\n", in_path);
     } else {
         printf("Modo Sem Entrada: Executando sem dados (EOF imediato).\n");
     }
+    if (jit) jit = jit_usable(trace_enabled);
+    if (jit && profile_path) { printf("JIT desativado: o perfil conta cada instrução no interpretador.\n"); jit = 0; }
+    if (jit && cache_path) { printf("JIT desativado: o simulador de cache acompanha cada acesso no interpretador.\n"); jit = 0; }
+    if (jit && timing_path) { printf("JIT desativado: o modelo de tempo acompanha cada instrução no interpretador.\n"); jit = 0; }
 
-    memset(memory, 0, MEM_SIZE); memset(csrs, 0, sizeof(csrs));
-    char line[1024]; uint32_t current_address = 0; int address_set = 0;
-
-    while (fgets(line, sizeof(line), hex_file)) {
-        line[strcspn(line, "\r\n")] = 0;
-        if (line[0] == '@') { current_address = (uint32_t)strtoul(&line[1], NULL, 16); address_set = 1; } 
-        else if (address_set && strlen(line) > 0) {
-            char *token = strtok(line, " ");
-            while (token != NULL) {
-                if (token == NULL) break;
-                uint32_t byte = (uint32_t)strtoul(token, NULL, 16);
-                uint32_t idx = current_address - 0x80000000;
-                if (idx < MEM_SIZE) memory[idx] = byte;
-                current_address++; token = strtok(NULL, " ");
-            }
-        }
-    }
-    fclose(hex_file);
+    poxim_config cfg = { mem_size, n_harts, threads, jit, huge_pages, save_snapshot != NULL, no_superblocks };
+    poxim_machine *m = poxim_create(&cfg);
+    if (m == NULL) { perror("Erro ao alocar a memória do guest"); return 1; }
+    if (selfprof_path && !poxim_self_profile_report(m, NULL)) { fprintf(stderr, "--self-profile exige o build com -DPOXIM_SELF_PROFILE=1\n"); return 1; }
+    if (bin_out && !poxim_set_file(m, POXIM_BINARY_TRACE, bin_out)) return 1;
+    poxim_set_file(m, POXIM_TRACE, text_out); poxim_set_file(m, POXIM_TERMINAL, terminal_file);
+    poxim_set_file(m, POXIM_CONSOLE, stdout); poxim_set_file(m, POXIM_INPUT, input_file);
+    // O thread de escrita só adianta com um processador livre; se não puder ser criado, segue síncrono.
+    if (!sync_output && !threads && sysconf(_SC_NPROCESSORS_ONLN) > 1) poxim_async_output(m, 1);
+    if (restore_snapshot) {
+        if (!poxim_restore_snapshot(m, restore_snapshot)) return 1;
+        printf("Snapshot %s restaurado (pc=0x%08x, %llu instruções)\n", restore_snapshot, poxim_get_pc(m, 0), (unsigned long long)poxim_instret(m, 0));
+    } else if (!poxim_load(m, prog_path, load_addr, raw_image)) return 1;
+    if (&poxim_aot_generated) printf("poxim-aot: %d blocos de %s instalados\n", poxim_aot(m, &poxim_aot_generated), poxim_aot_generated.source);
     printf("--- SIMULADOR FINAL V10 (Confirmado) ---\n");
-    printf("Programa '%s' carregado. Iniciando simulação, saída em %s\n", argv[1], argv[2]);
-    
-    int timer_divider_counter = 0;
-    
-    while (sim_running) { 
-        if (pc == 0) {
-            printf("\nSimulação terminada (Retorno a 0x0).\n");
-            break; 
-        }
-        if (pc % 4 != 0) { raise_exception(CAUSE_INSN_ACCESS, pc); continue; } 
-        uint32_t idx = pc - 0x80000000;
-        if (idx > MEM_SIZE - 4) { raise_exception(CAUSE_INSN_ACCESS, pc); continue; }
-
-        uint32_t instruction = memory[idx] | (memory[idx+1] << 8) | (memory[idx+2] << 16) | (memory[idx+3] << 24);
-        uint32_t pc_atual = pc;
+    printf("Programa '%s' carregado. Iniciando simulação, saída em %s\n", prog_path ? prog_path : restore_snapshot, out_path ? out_path : "(sem trace)");
 
-        if (instruction == 0) { printf("Simulação terminada (instrução nula). PC=0x%x\n", pc_atual); break; }
-        
-        execute_instruction(instruction, pc_atual, output_file);
-        
-        if (!sim_running) {
-            printf("Simulação terminada (ebreak).\n");
-            break;
-        }
-        
-        timer_divider_counter++;
-        if (timer_divider_counter >= TIMER_DIVIDER) {
-            mtime++;
-            timer_divider_counter = 0;
-        }
-        
-        if (mtime >= mtimecmp) csrs[CSR_MIP] |= 0x80;
-        else csrs[CSR_MIP] &= ~0x80;
-
-        if (msip & 0x1) csrs[CSR_MIP] |= 0x08;
-        else csrs[CSR_MIP] &= ~0x08;
+    poxim_set_trace_window(m, w.start_icount, w.start_pc, w.start_at_pc, w.trace_window);
+    if (out_path && (w.start_icount != UINT64_MAX || w.start_at_pc)) {
+        printf("Trace a partir de ");
+        if (w.start_icount != UINT64_MAX) printf("%llu instruções%s", (unsigned long long)w.start_icount, w.start_at_pc ? " ou " : "");
+        if (w.start_at_pc) printf("pc=0x%08x", w.start_pc);
+        if (w.trace_window != UINT64_MAX) printf(", janela de %llu instruções", (unsigned long long)w.trace_window);
+        printf("\n");
+    }
+    if (n_harts > 1) printf("%d harts%s\n", n_harts, threads ? ", um por thread" : " intercalados");
+    if (profile_path && !poxim_profile(m, 1)) { perror("Erro ao alocar o perfil"); return 1; }
+    if (timing_path && !poxim_timing(m, &timing_cfg)) { fprintf(stderr, "Configuração do modelo de tempo inválida: --predictor-bits de 1 a 24 e latências de pelo menos 1 ciclo\n"); return 1; }
+    if (cache_path && !poxim_cache(m, &cache_cfg)) { fprintf(stderr, "Configuração de cache inválida: a linha e o número de conjuntos (TAM/(LINHA*VIAS)) devem ser potências de 2\n"); return 1; }
+    if (semihost_root && !poxim_semihosting(m, semihost_root)) { perror(semihost_root); return 1; }
+    if (save_snapshot && (snap_icount != UINT64_MAX || snap_at_pc)) poxim_snapshot_at(m, save_snapshot, snap_icount, snap_pc, snap_at_pc);
 
-        if (uart_tx_countdown > 0) {
-            uart_tx_countdown--;
-        } else {
-            if ((uart_ier & 0x2) && uart_irq_pending) csrs[CSR_MIP] |= 0x800;
-            else csrs[CSR_MIP] &= ~0x800;
-        }
-        
-        uint32_t mstatus = csrs[CSR_MSTATUS];
-        uint32_t mie = csrs[CSR_MIE];
-        uint32_t mip = csrs[CSR_MIP];
+    int reason = poxim_run(m, UINT64_MAX);
+    if (!threads || reason == POXIM_EXIT) stop_message(m, reason);   // com --threads cada hart imprime o seu
+    // No ebreak o pc já passou da instrução: o snapshot retoma na seguinte.
+    if (reason == POXIM_EBREAK && save_snapshot && snap_icount == UINT64_MAX && !snap_at_pc) poxim_save_snapshot(m, save_snapshot);
 
-        if (mstatus & 0x8) { 
-            if ((mie & 0x800) && (mip & 0x800)) raise_exception(CAUSE_MEI, 0); 
-            else if ((mie & 0x8) && (mip & 0x8)) raise_exception(CAUSE_MSI, 0); 
-            else if ((mie & 0x80) && (mip & 0x80)) raise_exception(CAUSE_MTI, 0); 
-        }
-        
-        registers[0] = 0;
+    if (n_harts > 1) {
+        for (int h = 0; h < n_harts; h++) printf("Hart %d: %llu instruções retiradas\n", h, (unsigned long long)poxim_instret(m, h));
+    }
+    if (profile_path) {
+        FILE *prof = fopen(profile_path, "w");
+        if (prof == NULL) perror(profile_path);
+        else { poxim_profile_report(m, prof, profile_top); fclose(prof); printf("Perfil gravado em %s\n", profile_path); }
+    }
+    if (cache_path) {
+        FILE *rep = fopen(cache_path, "w");
+        if (rep == NULL) perror(cache_path);
+        else { poxim_cache_report(m, rep, cache_top); fclose(rep); printf("Relatório de cache gravado em %s\n", cache_path); }
+    }
+    if (timing_path) {
+        FILE *rep = fopen(timing_path, "w");
+        if (rep == NULL) perror(timing_path);
+        else { poxim_timing_report(m, rep); fclose(rep); printf("Modelo de tempo gravado em %s\n", timing_path); }
     }
-    
+    if (selfprof_path) {
+        FILE *rep = fopen(selfprof_path, "w");
+        if (rep == NULL) perror(selfprof_path);
+        else { poxim_self_profile_report(m, rep); fclose(rep); printf("Autoperfil gravado em %s\n", selfprof_path); }
+    }
+    int exit_code = poxim_exit_code(m);
+    poxim_destroy(m);
     if (terminal_file) fclose(terminal_file);
     if (input_file) fclose(input_file);
-    fclose(output_file);
-    return 0;
-}
\ No newline at end of file
+    if (text_out) fclose(text_out);
+    if (bin_out) fclose(bin_out);
+    return reason == POXIM_EXIT ? exit_code & 0xFF : 0;
+}
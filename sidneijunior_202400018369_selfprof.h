@@ -0,0 +1,149 @@
+#ifndef POXIM_SELFPROF_H
+#define POXIM_SELFPROF_H
+
+// Autoperfil do simulador (build de instrumentação, -DPOXIM_SELF_PROFILE=1): ciclos do host gastos
+// na execução por classe de instrução, na decodificação, na formatação do trace, na verificação de
+// interrupções, em cada dispositivo (load e store, com a trava e o fflush da UART) e em cada camada
+// de tradução. A execução, o trace e, no V1, a decodificação e o bloco do timer são amostrados (em
+// média 1 instrução a cada SELFPROF_PERIOD); os demais eventos são raros ou longos e são medidos todos. Os tempos são exclusivos: um trecho medido dentro de outro (o MMIO de um load, o
+// fprintf do trace) sai do tempo de quem o contém. Sem a opção as macros não geram código.
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "sidneijunior_202400018369_isa.h"
+
+#ifndef POXIM_SELF_PROFILE
+#define POXIM_SELF_PROFILE 0
+#endif
+
+#if POXIM_SELF_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SELFPROF_UNIT "tsc"
+static inline uint64_t selfprof_now(void) { return __rdtsc(); }
+#else
+#define SELFPROF_UNIT "ns"
+static inline uint64_t selfprof_now(void) { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec; }
+#endif
+static inline uint64_t selfprof_ns(void) { struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec; }
+
+#define SELFPROF_PERIOD 64
+#define SELFPROF_PERIOD_BITS 6
+
+enum { SELFPROF_CLINT, SELFPROF_PLIC, SELFPROF_UART };
+enum {
+    SELFPROF_CLASS = 0,                       // + CLASS_*: execução
+    SELFPROF_DECODE = CLASS_COUNT,
+    SELFPROF_TRACE_TEXT, SELFPROF_TRACE_BINARY,
+    SELFPROF_INTERRUPTS,
+    SELFPROF_LOAD,                            // + SELFPROF_CLINT/PLIC/UART
+    SELFPROF_STORE = SELFPROF_LOAD + 3,       // + SELFPROF_CLINT/PLIC/UART
+    SELFPROF_AOT = SELFPROF_STORE + 3, SELFPROF_JIT, SELFPROF_SUPERBLOCKS,
+    SELFPROF_SLOTS
+};
+// count: eventos medidos; ticks: tempo medido; estimated: ticks vezes SELFPROF_PERIOD se amostrado.
+typedef struct { uint64_t count, ticks, estimated; } selfprof_slot_t;
+typedef struct { selfprof_slot_t slot[SELFPROF_SLOTS]; uint64_t run_ticks, run_ns; } selfprof_t;
+typedef struct { uint64_t t0, nested; int weight; } selfprof_scope_t;
+typedef struct { uint64_t t0, ns0; } selfprof_run_t;
+
+static _Thread_local selfprof_t *selfprof;            // do hart em execução
+static _Thread_local uint64_t selfprof_nested;        // tempo dos trechos internos ao trecho aberto
+static _Thread_local uint64_t selfprof_rng = 1;
+static _Thread_local int selfprof_sampling;           // a instrução atual é amostrada
+static uint64_t selfprof_bias;                        // custo de medir um trecho vazio (selfprof_calibrate)
+
+static inline selfprof_scope_t selfprof_enter(int weight) {
+    selfprof_scope_t s = { weight ? selfprof_now() : 0, selfprof_nested, weight };
+    selfprof_nested = 0;
+    return s;
+}
+
+static inline void selfprof_leave(const selfprof_scope_t *s, int slot) {
+    if (!s->weight) { selfprof_nested += s->nested; return; }
+    uint64_t dt = selfprof_now() - s->t0, own = dt > selfprof_nested + selfprof_bias ? dt - selfprof_nested - selfprof_bias : 0;
+    selfprof_slot_t *e = &selfprof->slot[slot];
+    e->count++; e->ticks += own; e->estimated += own * s->weight;
+    selfprof_nested = s->nested + dt;
+}
+
+// Cada instrução é amostrada com probabilidade 1/SELFPROF_PERIOD (um LCG, e não a cada N, para não
+// sincronizar com laços do guest cujo tamanho divide N).
+#define SELFPROF_SAMPLE() (selfprof_rng = selfprof_rng * 6364136223846793005ull + 1442695040888963407ull, selfprof_sampling = (selfprof_rng >> (64 - SELFPROF_PERIOD_BITS)) == 0)
+#define SELFPROF_BEGIN(s) selfprof_scope_t s = selfprof_enter(1)
+#define SELFPROF_BEGIN_SAMPLED(s) selfprof_scope_t s = selfprof_enter(selfprof_sampling ? SELFPROF_PERIOD : 0)
+#define SELFPROF_END(s, slot) selfprof_leave(&s, (s).weight ? (slot) : 0)
+#define SELFPROF_TIME(slot, ...) do { SELFPROF_BEGIN(s_); __VA_ARGS__; SELFPROF_END(s_, slot); } while (0)
+#define SELFPROF_TIME_SAMPLED(slot, ...) do { SELFPROF_BEGIN_SAMPLED(s_); __VA_ARGS__; SELFPROF_END(s_, slot); } while (0)
+// Tempo total de execução do thread (somado no perfil do hart corrente ao final).
+#define SELFPROF_RUN_BEGIN(r) selfprof_run_t r = { selfprof_now(), selfprof_ns() }
+#define SELFPROF_RUN_END(r) do { selfprof->run_ticks += selfprof_now() - (r).t0; selfprof->run_ns += selfprof_ns() - (r).ns0; } while (0)
+
+// Desconta de cada trecho o custo das próprias leituras do relógio, que senão pesa nos trechos curtos.
+static inline void selfprof_calibrate(void) {
+    selfprof_t dummy = { 0 }, *saved = selfprof; uint64_t best = UINT64_MAX;
+    selfprof = &dummy; selfprof_bias = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t before = dummy.slot[0].ticks;
+        SELFPROF_TIME(0, (void)0);
+        if (dummy.slot[0].ticks - before < best) best = dummy.slot[0].ticks - before;
+    }
+    selfprof = saved; selfprof_nested = 0; selfprof_bias = best;
+}
+
+static inline void selfprof_entry(FILE *out, const char *indent, const char *name, const selfprof_slot_t *e, double run, const char *sep) {
+    fprintf(out, "%s\"%s\": { \"count\": %llu, \"ticks\": %llu, \"estimated_ticks\": %llu, \"share\": %.6f }%s\n", indent, name,
+            (unsigned long long)e->count, (unsigned long long)e->ticks, (unsigned long long)e->estimated, run > 0 ? e->estimated / run : 0.0, sep);
+}
+
+// Relatório em JSON somando os n perfis (um por hart); 'share' é a fração do tempo de execução.
+static inline void selfprof_json(FILE *out, const selfprof_t *p, int n) {
+    static const char *class_key[CLASS_COUNT] = { "alu", "muldiv", "load", "store", "branch", "jump", "csr", "system", "atomic", "invalid" };
+    static const char *device_key[3] = { "clint", "plic", "uart" };
+    selfprof_t t = { 0 };
+    for (int h = 0; h < n; h++) {
+        for (int i = 0; i < SELFPROF_SLOTS; i++) { t.slot[i].count += p[h].slot[i].count; t.slot[i].ticks += p[h].slot[i].ticks; t.slot[i].estimated += p[h].slot[i].estimated; }
+        t.run_ticks += p[h].run_ticks; t.run_ns += p[h].run_ns;
+    }
+    double run = (double)t.run_ticks; uint64_t measured = 0;
+    for (int i = 0; i < SELFPROF_SLOTS; i++) measured += t.slot[i].estimated;
+    selfprof_slot_t other = { 0, 0, t.run_ticks > measured ? t.run_ticks - measured : 0 };
+    fprintf(out, "{\n  \"unit\": \"%s\",\n  \"ticks_per_second\": %.0f,\n  \"sample_period\": %d,\n  \"harts\": %d,\n", SELFPROF_UNIT, t.run_ns ? run * 1e9 / t.run_ns : 0.0, SELFPROF_PERIOD, n);
+    fprintf(out, "  \"run\": { \"ticks\": %llu, \"seconds\": %.6f },\n", (unsigned long long)t.run_ticks, t.run_ns / 1e9);
+    fprintf(out, "  \"execute\": {\n");
+    for (int c = 0; c < CLASS_COUNT; c++) selfprof_entry(out, "    ", class_key[c], &t.slot[SELFPROF_CLASS + c], run, c + 1 < CLASS_COUNT ? "," : "");
+    fprintf(out, "  },\n");
+    selfprof_entry(out, "  ", "decode", &t.slot[SELFPROF_DECODE], run, ",");
+    fprintf(out, "  \"trace\": {\n");
+    selfprof_entry(out, "    ", "text", &t.slot[SELFPROF_TRACE_TEXT], run, ",");
+    selfprof_entry(out, "    ", "binary", &t.slot[SELFPROF_TRACE_BINARY], run, "");
+    fprintf(out, "  },\n");
+    selfprof_entry(out, "  ", "interrupts", &t.slot[SELFPROF_INTERRUPTS], run, ",");
+    fprintf(out, "  \"devices\": {\n");
+    for (int d = 0; d < 3; d++) {
+        fprintf(out, "    \"%s\": {\n", device_key[d]);
+        selfprof_entry(out, "      ", "load", &t.slot[SELFPROF_LOAD + d], run, ",");
+        selfprof_entry(out, "      ", "store", &t.slot[SELFPROF_STORE + d], run, "");
+        fprintf(out, "    }%s\n", d < 2 ? "," : "");
+    }
+    fprintf(out, "  },\n  \"tiers\": {\n");
+    selfprof_entry(out, "    ", "aot", &t.slot[SELFPROF_AOT], run, ",");
+    selfprof_entry(out, "    ", "jit", &t.slot[SELFPROF_JIT], run, ",");
+    selfprof_entry(out, "    ", "superblocks", &t.slot[SELFPROF_SUPERBLOCKS], run, "");
+    fprintf(out, "  },\n");
+    selfprof_entry(out, "  ", "other", &other, run, "");
+    fprintf(out, "}\n");
+}
+#else
+#define SELFPROF_SAMPLE() ((void)0)
+#define SELFPROF_BEGIN(s) do {} while (0)
+#define SELFPROF_BEGIN_SAMPLED(s) do {} while (0)
+#define SELFPROF_END(s, slot) do {} while (0)
+#define SELFPROF_TIME(slot, ...) do { __VA_ARGS__; } while (0)
+#define SELFPROF_TIME_SAMPLED(slot, ...) do { __VA_ARGS__; } while (0)
+#define SELFPROF_RUN_BEGIN(r) do {} while (0)
+#define SELFPROF_RUN_END(r) do {} while (0)
+#endif
+
+#endif
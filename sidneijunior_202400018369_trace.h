@@ -0,0 +1,184 @@
+#ifndef POXIM_TRACE_H
+#define POXIM_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sidneijunior_202400018369_isa.h"
+
+// --- Trace binário (--binary-trace) ---
+// Cabeçalho "PXTR" + versão (8 bytes), seguido de registros. Cada registro começa com
+// um byte de tag (tipo nos bits 0-1, flags acima):
+//   BT_REGS: 32 x uint32 LE, o estado dos registradores no início do trace.
+//   BT_INSN: [pc varint zigzag (pc - pc_esperado)]    se BT_F_JUMP
+//            [instrução uint32 LE]                    se não BT_F_RAW_CACHED (compacta: 16 bits)
+//            [endereço varint zigzag (delta)]         se load/store
+//            [valor varint]                           rd/CSR lido/dado do acesso (bt_fields)
+//   BT_IRQ:  cause varint, epc uint32 LE, tval varint (linha ">interrupt" de raise_exception).
+// pc_esperado é o pc do registro BT_INSN anterior + o tamanho dela (0 no início). As instruções já
+// vistas no mesmo pc não são repetidas: os dois lados mantêm a mesma tabela bt_cache.
+// Só são gravadas as instruções que gerariam uma linha no .out textual.
+
+#define BT_MAGIC        "PXTR"
+#define BT_VERSION      2   // 2: instruções compactas (RV32C); a versão 1 é lida igual
+#define BT_HEADER_SIZE  8
+
+enum { BT_INSN = 0, BT_IRQ = 1, BT_REGS = 2 };
+#define BT_KIND_MASK     0x03
+#define BT_F_JUMP        0x04
+#define BT_F_RAW_CACHED  0x08
+
+#define BT_CACHE_SIZE    65536
+#define bt_cache_slot(pc) (((pc) >> 2) & (BT_CACHE_SIZE - 1))
+
+#define BT_HAS_VALUE 0x1
+#define BT_HAS_ADDR  0x2
+
+// Campos extras gravados para cada tipo de instrução.
+static inline int bt_fields(uint8_t op) {
+    if ((op >= OP_LB && op <= OP_SW) || (op >= OP_LR_W && op <= OP_AMOMAXU_W)) return BT_HAS_ADDR | BT_HAS_VALUE;
+    if ((op >= OP_ADDI && op <= OP_ANDI) || (op >= OP_ADD && op <= OP_REMU) || (op >= OP_CSRRW && op <= OP_CSRRCI)) return BT_HAS_VALUE;
+    return 0;
+}
+
+static inline uint32_t bt_zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t bt_unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static inline uint8_t *bt_put_varint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline uint8_t *bt_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    return p + 4;
+}
+
+// --- Trace textual a partir dos registros ---
+// Usado pelo poxim-trace e pela saída assíncrona da libpoxim: a linha de cada instrução tem os
+// formatos de execute_instruction, com os operandos lidos de uma cópia x dos registradores que
+// bt_update_registers mantém com o valor de rd de cada registro. Cada função escreve no máximo
+// BT_LINE_MAX bytes em buf e devolve quantos escreveu.
+#define BT_LINE_MAX 192
+
+static inline int bt_format_irq(char *buf, uint32_t cause, uint32_t epc, uint32_t tval) {
+    return sprintf(buf, ">interrupt:external                   cause=0x%08x,epc=0x%08x,tval=0x%08x\n", cause, epc, tval);
+}
+
+#define MNEMONIC(name) (c_name ? c_name : (name))
+
+static inline int bt_format_insn(char *buf, const uint32_t *x, uint32_t current_pc, const decoded_insn_t *d, uint32_t value, uint32_t address) {
+    uint32_t rd = d->rd, rs1 = d->rs1, rs2 = d->rs2;
+    int32_t imm = d->imm;
+    char operand_str[40];
+    int n = 0;
+    uint32_t next_pc = current_pc + insn_length(d->raw);
+    const char *c_name = insn_length(d->raw) == 2 ? rvc_name(d) : NULL;
+
+    switch (d->op) {
+        case OP_ADDI: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, MNEMONIC("addi"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_SLLI: sprintf(operand_str, "%s,%s,%u", x_label[rd], x_label[rs1], imm); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x<<%u=0x%08x\n", current_pc, MNEMONIC("slli"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_SLTI: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC("slti"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_SLTIU: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC("sltiu"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_XORI: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x^0x%08x=0x%08x\n", current_pc, MNEMONIC("xori"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_SRLI: sprintf(operand_str, "%s,%s,%u", x_label[rd], x_label[rs1], imm); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x>>%u=0x%08x\n", current_pc, MNEMONIC("srli"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_SRAI: sprintf(operand_str, "%s,%s,%u", x_label[rd], x_label[rs1], imm); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x>>>%u=0x%08x\n", current_pc, MNEMONIC("srai"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_ORI: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x|0x%08x=0x%08x\n", current_pc, MNEMONIC("ori"), operand_str, x_label[rd], x[rs1], imm, value); break;
+        case OP_ANDI: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x&0x%08x=0x%08x\n", current_pc, MNEMONIC("andi"), operand_str, x_label[rd], x[rs1], imm, value); break;
+
+        case OP_ADD: case OP_SLL: case OP_SLT: case OP_SLTU: case OP_XOR: case OP_SRL: case OP_OR: case OP_AND: case OP_SUB: case OP_SRA:
+        case OP_MUL: case OP_MULH: case OP_MULHSU: case OP_MULHU: case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU: {
+            static const char *names[] = { [OP_ADD] = "add", [OP_SLL] = "sll", [OP_SLT] = "slt", [OP_SLTU] = "sltu", [OP_XOR] = "xor", [OP_SRL] = "srl", [OP_OR] = "or", [OP_AND] = "and", [OP_SUB] = "sub", [OP_SRA] = "sra",
+                                           [OP_MUL] = "mul", [OP_MULH] = "mulh", [OP_MULHSU] = "mulhsu", [OP_MULHU] = "mulhu", [OP_DIV] = "div", [OP_DIVU] = "divu", [OP_REM] = "rem", [OP_REMU] = "remu" };
+            static const char *symbols[] = { [OP_ADD] = "+", [OP_XOR] = "^", [OP_OR] = "|", [OP_AND] = "&", [OP_SUB] = "-", [OP_MUL] = "*", [OP_MULH] = "*", [OP_MULHSU] = "*", [OP_MULHU] = "*",
+                                             [OP_DIV] = "/", [OP_DIVU] = "/", [OP_REM] = "%", [OP_REMU] = "%" };
+            sprintf(operand_str, "%s,%s,%s", x_label[rd], x_label[rs1], x_label[rs2]);
+            if (d->op == OP_SLL || d->op == OP_SRL || d->op == OP_SRA)
+                n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x%s%u=0x%08x\n", current_pc, MNEMONIC(names[d->op]), operand_str, x_label[rd], x[rs1], d->op == OP_SLL ? "<<" : d->op == OP_SRL ? ">>" : ">>>", x[rs2] & 0x1F, value);
+            else if (d->op == OP_SLT || d->op == OP_SLTU)
+                n = sprintf(buf, "0x%08x:%-7s %-16s %s=(0x%08x<0x%08x)=%u\n", current_pc, MNEMONIC(names[d->op]), operand_str, x_label[rd], x[rs1], x[rs2], value);
+            else
+                n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x%s0x%08x=0x%08x\n", current_pc, MNEMONIC(names[d->op]), operand_str, x_label[rd], x[rs1], symbols[d->op], x[rs2], value);
+            break;
+        }
+        case OP_JAL:
+            sprintf(operand_str, "%s,0x%05x", x_label[rd], (imm >> 1) & 0xFFFFF); n = sprintf(buf, "0x%08x:%-7s %-16s pc=0x%08x,%s=0x%08x\n", current_pc, MNEMONIC("jal"), operand_str, current_pc + imm, x_label[rd], next_pc);
+            break;
+        case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU: {
+            static const char *names[] = { [OP_BEQ] = "beq", [OP_BNE] = "bne", [OP_BLT] = "blt", [OP_BGE] = "bge", [OP_BLTU] = "bltu", [OP_BGEU] = "bgeu" };
+            static const char *symbols[] = { [OP_BEQ] = "==", [OP_BNE] = "!=", [OP_BLT] = "<", [OP_BGE] = ">=", [OP_BLTU] = "<", [OP_BGEU] = ">=" };
+            int32_t s1 = x[rs1], s2 = x[rs2]; int condition_met = 0;
+            switch (d->op) {
+                case OP_BEQ: condition_met = (s1 == s2); break;
+                case OP_BNE: condition_met = (s1 != s2); break;
+                case OP_BLT: condition_met = (s1 < s2); break;
+                case OP_BGE: condition_met = (s1 >= s2); break;
+                case OP_BLTU: condition_met = (x[rs1] < x[rs2]); break;
+                default: condition_met = (x[rs1] >= x[rs2]); break;
+            }
+            n = sprintf(buf, "0x%08x:%-7s %s,%s,0x%03x   (0x%08x%s0x%08x)=%d->pc=0x%08x\n", current_pc, MNEMONIC(names[d->op]), x_label[rs1], x_label[rs2], (imm >> 1) & 0xFFF, x[rs1], symbols[d->op], x[rs2], condition_met, (condition_met ? (current_pc + imm) : (next_pc)));
+            break;
+        }
+        case OP_LUI: sprintf(operand_str, "%s,0x%05x", x_label[rd], ((uint32_t)imm >> 12)); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, MNEMONIC("lui"), operand_str, x_label[rd], imm); break;
+        case OP_AUIPC: sprintf(operand_str, "%s,0x%05x", x_label[rd], (imm >> 12) & 0xFFFFF); n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x+0x%08x=0x%08x\n", current_pc, MNEMONIC("auipc"), operand_str, x_label[rd], current_pc, imm, current_pc + imm); break;
+        case OP_JALR: sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], (imm & 0xFFF)); n = sprintf(buf, "0x%08x:%-7s %-16s pc=0x%08x+0x%08x,%s=0x%08x\n", current_pc, MNEMONIC("jalr"), operand_str, x[rs1], imm, x_label[rd], next_pc); break;
+        case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU: {
+            static const char *names[] = { [OP_LB] = "lb", [OP_LH] = "lh", [OP_LW] = "lw", [OP_LBU] = "lbu", [OP_LHU] = "lhu" };
+            sprintf(operand_str, "%s,0x%03x(%s)", x_label[rd], (imm & 0xFFF), x_label[rs1]);
+            n = sprintf(buf, "0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC(names[d->op]), operand_str, x_label[rd], address, value);
+            break;
+        }
+        case OP_SB: case OP_SH: case OP_SW:
+            sprintf(operand_str, "%s,0x%03x(%s)", x_label[rs2], (imm & 0xFFF), x_label[rs1]);
+            if (d->op == OP_SB) n = sprintf(buf, "0x%08x:%-7s %-16s mem[0x%08x]=0x%02x\n", current_pc, MNEMONIC("sb"), operand_str, address, value);
+            else if (d->op == OP_SH) n = sprintf(buf, "0x%08x:%-7s %-16s mem[0x%08x]=0x%04x\n", current_pc, MNEMONIC("sh"), operand_str, address, value);
+            else n = sprintf(buf, "0x%08x:%-7s %-16s mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC("sw"), operand_str, address, value);
+            break;
+        case OP_ECALL: n = sprintf(buf, "0x%08x:ecall\n", current_pc); break;
+        case OP_EBREAK: n = sprintf(buf, "0x%08x:%s\n", current_pc, MNEMONIC("ebreak")); break;
+        case OP_MRET: n = sprintf(buf, "0x%08x:mret\n", current_pc); break;
+        case OP_WFI: n = sprintf(buf, "0x%08x:wfi\n", current_pc); break;
+        case OP_CSRRW: case OP_CSRRS: case OP_CSRRC:
+            sprintf(operand_str, "%s,%s,0x%03x", x_label[rd], x_label[rs1], imm);
+            n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, d->op == OP_CSRRW ? "csrrw" : d->op == OP_CSRRS ? "csrrs" : "csrrc", operand_str, x_label[rd], value);
+            break;
+        case OP_CSRRWI: case OP_CSRRSI: case OP_CSRRCI:
+            sprintf(operand_str, "%s,0x%x,0x%03x", x_label[rd], rs1, imm);
+            n = sprintf(buf, "0x%08x:%-7s %-16s %s=0x%08x\n", current_pc, d->op == OP_CSRRWI ? "csrrwi" : d->op == OP_CSRRSI ? "csrrsi" : "csrrci", operand_str, x_label[rd], value);
+            break;
+        case OP_FENCE: n = sprintf(buf, "0x%08x:fence\n", current_pc); break;
+        case OP_FENCE_I: n = sprintf(buf, "0x%08x:fence.i\n", current_pc); break;
+        case OP_LR_W:
+            sprintf(operand_str, "%s,(%s)", x_label[rd], x_label[rs1]);
+            n = sprintf(buf, "0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC("lr.w"), operand_str, x_label[rd], address, value);
+            break;
+        case OP_SC_W:
+            sprintf(operand_str, "%s,%s,(%s)", x_label[rd], x_label[rs2], x_label[rs1]);
+            if (value == 0) n = sprintf(buf, "0x%08x:%-7s %-16s %s=0,mem[0x%08x]=0x%08x\n", current_pc, MNEMONIC("sc.w"), operand_str, x_label[rd], address, x[rs2]);
+            else n = sprintf(buf, "0x%08x:%-7s %-16s %s=1\n", current_pc, MNEMONIC("sc.w"), operand_str, x_label[rd]);
+            break;
+        case OP_AMOSWAP_W: case OP_AMOADD_W: case OP_AMOXOR_W: case OP_AMOAND_W: case OP_AMOOR_W: case OP_AMOMIN_W: case OP_AMOMAX_W: case OP_AMOMINU_W: case OP_AMOMAXU_W:
+            sprintf(operand_str, "%s,%s,(%s)", x_label[rd], x_label[rs2], x_label[rs1]);
+            n = sprintf(buf, "0x%08x:%-7s %-16s %s=mem[0x%08x]=0x%08x,mem[0x%08x]=0x%08x\n", current_pc, op_name[d->op], operand_str, x_label[rd], address, value, address, amo_compute(d->op, value, x[rs2]));
+            break;
+        case OP_UNKNOWN: n = sprintf(buf, "Erro: Opcode 0x%x desconhecido em 0x%08x (Trap)\n", d->raw & 0x7F, current_pc); break;
+        default: break;
+    }
+    return n;
+}
+
+// Efeito da instrução na cópia dos registradores.
+static inline void bt_update_registers(uint32_t *x, uint32_t current_pc, const decoded_insn_t *d, uint32_t value) {
+    if (d->rd == 0) return;
+    switch (d->op) {
+        case OP_JAL: case OP_JALR: x[d->rd] = current_pc + insn_length(d->raw); break;
+        case OP_LUI: x[d->rd] = d->imm; break;
+        case OP_AUIPC: x[d->rd] = current_pc + d->imm; break;
+        case OP_SB: case OP_SH: case OP_SW: case OP_ECALL: case OP_EBREAK: case OP_MRET: case OP_WFI: case OP_FENCE: case OP_FENCE_I: case OP_UNKNOWN: break;
+        default: if (d->op >= OP_BEQ && d->op <= OP_BGEU) break; x[d->rd] = value; break;
+    }
+}
+#undef MNEMONIC
+
+#endif
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Salva um snapshot no ebreak e o restaura: a execução restaurada tem que continuar na instrução
+# seguinte (com ebreak e com c.ebreak). Executar a partir da raiz do repositório:
+#
+#   sh test/sidneijunior_202400018369_snapshot_test.sh ./poximv2
+V2=$(realpath "${1:-./poximv2}")
+TEST=$(dirname "$(realpath "$0")")
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+fail=0
+for prog in snapshot_ebreak snapshot_cebreak; do
+    "$V2" --no-trace --save-snapshot $prog.snap "$TEST/$prog.hex" > /dev/null
+    printf 'A' | cmp -s - terminal.out || { echo "$prog: saída antes do snapshot: $(cat terminal.out)"; fail=1; }
+    "$V2" --no-trace --restore-snapshot $prog.snap > /dev/null
+    printf 'BC' | cmp -s - terminal.out || { echo "$prog: saída restaurada: $(cat terminal.out) (esperado BC)"; fail=1; }
+done
+[ $fail = 0 ] && echo "snapshot no ebreak: OK"
+exit $fail
@@ -0,0 +1,16 @@
+# Como snapshot_ebreak.s, com c.ebreak (instrução de 16 bits).
+.section .text
+.globl _start
+
+.equ UART_BASE, 0x10000000
+
+_start:
+    li t5, UART_BASE
+    li a0, 'A'
+    sb a0, 0(t5)
+    c.ebreak
+    li a0, 'B'
+    sb a0, 0(t5)
+    li a0, 'C'
+    sb a0, 0(t5)
+    c.ebreak
@@ -0,0 +1,17 @@
+# Snapshot no ebreak: imprime A e para; a execução restaurada continua na instrução seguinte
+# e imprime BC. Com c.ebreak (snapshot_cebreak.s) o resultado tem que ser o mesmo.
+.section .text
+.globl _start
+
+.equ UART_BASE, 0x10000000
+
+_start:
+    li t5, UART_BASE
+    li a0, 'A'
+    sb a0, 0(t5)
+    ebreak
+    li a0, 'B'
+    sb a0, 0(t5)
+    li a0, 'C'
+    sb a0, 0(t5)
+    ebreak